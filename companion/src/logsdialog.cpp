@@ -23,6 +23,7 @@
 #include "appdata.h"
 #include "ui_logsdialog.h"
 #include "helpers.h"
+#include "../../radio/src/logs.h"
 #if defined _MSC_VER || !defined __GNUC__
 #include <windows.h>
 #else
@@ -655,6 +656,96 @@ void LogsDialog::on_saveSession_BT_clicked()
   }
 }
 
+static QString binaryLogDegrees(int32_t value)
+{
+  div_t qr = div(value, 1000000);
+  return QString().sprintf("%d.%06d", qr.quot, abs(qr.rem));
+}
+
+static QString binaryLogValue(const LogColumn & column, const int32_t * values)
+{
+  switch (column.type) {
+    case LOG_COLUMN_GPS:
+      if (values[0] && values[1]) {
+        return binaryLogDegrees(values[0]) + " " + binaryLogDegrees(values[1]);
+      }
+      return QString();
+    case LOG_COLUMN_DATETIME:
+      return QString().sprintf("%4d-%02d-%02d %02d:%02d:%02d", values[0] >> 16, (values[0] >> 8) & 0xFF, values[0] & 0xFF, values[1] >> 16, (values[1] >> 8) & 0xFF, values[1] & 0xFF);
+    case LOG_COLUMN_LOGICAL_SWITCHES:
+      return QString().sprintf("0x%08X%08X", (uint32_t)values[0], (uint32_t)values[1]);
+    default:
+      if (column.prec == 0) {
+        return QString::number(values[0]);
+      }
+      else {
+        int divisor = (column.prec == 2 ? 100 : 10);
+        return QString("%1%2.%3").arg(values[0] < 0 ? "-" : "").arg(abs(values[0]) / divisor).arg(abs(values[0]) % divisor, column.prec, 10, QChar('0'));
+      }
+  }
+}
+
+// Converts a binary log (radio/src/logs.h) to the same lines than a CSV log
+QList<QStringList> LogsDialog::binaryLogParse(const QByteArray & data)
+{
+  QList<QStringList> result;
+  int pos = 0;
+
+  while (pos + (int)sizeof(LogFileHeader) <= data.size() && data.mid(pos, 4) == LOGS_BINARY_MAGIC) {
+    LogFileHeader header;
+    memcpy(&header, data.constData() + pos, sizeof(header));
+    if (header.version != LOGS_BINARY_VERSION || !(header.flags & LOG_FLAG_RTC) || pos + header.headerSize > data.size() ||
+        header.recordSize < sizeof(LogRecordHeader) || header.bufferSize < header.recordSize) {
+      break;
+    }
+
+    QVector<LogColumn> columns(header.columnsCount);
+    memcpy(columns.data(), data.constData() + pos + sizeof(header), header.columnsCount * sizeof(LogColumn));
+
+    if (result.isEmpty()) {
+      // the columns of the first session are kept, as in the CSV logs
+      QStringList labels;
+      labels << "Date" << "Time";
+      foreach (const LogColumn & column, columns) {
+        QString label = QString::fromLatin1(column.name, strnlen(column.name, LOG_COLUMN_NAME_LEN));
+        if (column.unitName[0]) {
+          label += QString("(%1)").arg(QString::fromLatin1(column.unitName, strnlen(column.unitName, LOG_COLUMN_UNIT_LEN)));
+        }
+        labels << label;
+      }
+      result.append(labels);
+    }
+
+    pos += header.headerSize;
+    while (pos < data.size() && data.mid(pos, 4) != LOGS_BINARY_MAGIC) {
+      // a buffer of records, padded with 0xFF
+      int bufferEnd = qMin(pos + (int)header.bufferSize, data.size());
+      while (pos + header.recordSize <= bufferEnd) {
+        LogRecordHeader record;
+        memcpy(&record, data.constData() + pos, sizeof(record));
+        if (record.time == LOG_RECORD_PADDING) {
+          // end of the session
+          bufferEnd = (pos + sizeof(LogRecordHeader) + LOGS_BINARY_SECTOR_SIZE - 1) / LOGS_BINARY_SECTOR_SIZE * LOGS_BINARY_SECTOR_SIZE;
+          break;
+        }
+        QDateTime time = QDateTime::fromTime_t(record.time, Qt::UTC);
+        QStringList line;
+        line << time.toString("yyyy-MM-dd") << time.toString("HH:mm:ss") + QString(".%1").arg(record.ms, 3, 10, QChar('0'));
+        const int32_t * values = (const int32_t *)(data.constData() + pos + sizeof(LogRecordHeader));
+        foreach (const LogColumn & column, columns) {
+          line << binaryLogValue(column, values);
+          values += getLogColumnValuesCount(column.type);
+        }
+        result.append(line);
+        pos += header.recordSize;
+      }
+      pos = bufferEnd;
+    }
+  }
+
+  return result;
+}
+
 bool LogsDialog::cvsFileParse()
 {
   QFile file(ui->FileName_LE->text());
@@ -664,6 +755,14 @@ bool LogsDialog::cvsFileParse()
   if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) { // reading HEX TEXT file
     return false;
   }
+  else if (file.peek(4) == LOGS_BINARY_MAGIC) {
+    QFile binaryFile(file.fileName());
+    if (!binaryFile.open(QIODevice::ReadOnly)) {
+      return false;
+    }
+    csvlog = binaryLogParse(binaryFile.readAll());
+    logFilename = QFileInfo(file.fileName()).baseName();
+  }
   else {
     csvlog.clear();
     logFilename.clear();
@@ -702,7 +801,7 @@ bool LogsDialog::cvsFileParse()
   }
 
   int n = csvlog.count();
-  if (n == 1) {
+  if (n <= 1) {
     csvlog.clear();
     return false;
   }
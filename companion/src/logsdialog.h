@@ -103,6 +103,7 @@ private:
   QCPItemStraightLine * cursorLine;
 
   bool cvsFileParse();
+  QList<QStringList> binaryLogParse(const QByteArray & data);
   QList<QStringList> filterGePoints(const QList<QStringList> & input);
   void exportToGoogleEarth();
   QDateTime getRecordTimeStamp(int index);
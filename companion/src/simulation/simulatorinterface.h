@@ -127,6 +127,9 @@ class SimulatorInterface : public QObject
     virtual uint8_t getSensorInstance(uint16_t id, uint8_t defaultValue = 0) = 0;
     virtual uint16_t getSensorRatio(uint16_t id) = 0;
     virtual const int getCapability(Capability cap) = 0;
+    // Headless simulation in virtual time, instead of start(): the inputs come from the timeline file
+    // and the outputs are written to the output file (see opentxsimulator.cpp). Returns when done.
+    virtual bool runTimeline(const QString & timelineFile, const QString & outputFile, const char * filename = NULL, bool tests = true) = 0;
 
   public slots:
 
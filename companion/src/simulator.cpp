@@ -101,7 +101,7 @@ enum CommandLineParseResult
   CommandLineExitErr
 };
 
-CommandLineParseResult cliOptions(SimulatorOptions * simOptions, int * profileId)
+CommandLineParseResult cliOptions(SimulatorOptions * simOptions, int * profileId, QString * timelineFile, QString * outputFile)
 {
   QCommandLineParser cliOptions;
   bool cliOptsFound = false;
@@ -126,6 +126,15 @@ CommandLineParseResult cliOptions(SimulatorOptions * simOptions, int * profileId
                                     QApplication::translate("SimulatorMain", "Data source type to use (applicable to Horus only). One of:") + " (file|folder|sd)",
                                     QApplication::translate("SimulatorMain", "type"));
 
+  const QCommandLineOption optTimeline(QStringList() << "timeline" << "t",
+                                       QApplication::translate("SimulatorMain", "Run without GUI, as fast as possible, with the inputs from this timeline file (see opentxsimulator.cpp). "
+                                             "The radio data has to be a binary image file or a data folder, the startup checks are skipped."),
+                                       QApplication::translate("SimulatorMain", "file"));
+
+  const QCommandLineOption optOutput(QStringList() << "output" << "o",
+                                     QApplication::translate("SimulatorMain", "CSV file where the outputs are written when running a timeline."),
+                                     QApplication::translate("SimulatorMain", "file"));
+
   cliOptions.addPositionalArgument(QApplication::translate("SimulatorMain", "data-source"),
                                    QApplication::translate("SimulatorMain", "Radio data (.bin/.eeprom/.otx) image file to use OR data folder path (for Horus-style radios).\n"
                                          "NOTE: any existing EEPROM data incompatible with the selected radio type may be overwritten!"),
@@ -135,6 +144,8 @@ CommandLineParseResult cliOptions(SimulatorOptions * simOptions, int * profileId
   cliOptions.addOption(optRadio);
   cliOptions.addOption(optSdDir);
   cliOptions.addOption(optStart);
+  cliOptions.addOption(optTimeline);
+  cliOptions.addOption(optOutput);
 
   QStringList args = QCoreApplication::arguments();
 #ifdef Q_OS_WIN
@@ -222,6 +233,16 @@ CommandLineParseResult cliOptions(SimulatorOptions * simOptions, int * profileId
     cliOptsFound = true;
   }
 
+  if (cliOptions.isSet(optTimeline)) {
+    if (!cliOptions.isSet(optOutput)) {
+      showHelp(cliOptions, QApplication::translate("SimulatorMain", "Error: a timeline needs an output file."));
+      return CommandLineExitErr;
+    }
+    *timelineFile = cliOptions.value(optTimeline);
+    *outputFile = cliOptions.value(optOutput);
+    cliOptsFound = true;
+  }
+
   *profileId = pId;
   if (cliOptsFound)
     return CommandLineFound;
@@ -229,6 +250,40 @@ CommandLineParseResult cliOptions(SimulatorOptions * simOptions, int * profileId
     return CommandLineNone;
 }
 
+int runTimeline(const SimulatorOptions & simOptions, const QString & timelineFile, const QString & outputFile)
+{
+  QByteArray dataFile;
+  if (simOptions.startupDataType == SimulatorOptions::START_WITH_FILE) {
+    if (!simOptions.dataFile.endsWith(".bin", Qt::CaseInsensitive)) {
+      showMessage(QApplication::translate("SimulatorMain", "ERROR: A timeline can only run with a binary image file or a data folder."), QMessageBox::Critical, true);
+      return 1;
+    }
+    dataFile = simOptions.dataFile.toLocal8Bit();
+  }
+
+  SimulatorInterface * simulator = SimulatorLoader::loadSimulator(simOptions.firmwareId);
+  if (!simulator) {
+    showMessage(QApplication::translate("SimulatorMain", "ERROR: Failed to create simulator interface, possibly missing or bad library."), QMessageBox::Critical, true);
+    return 3;
+  }
+
+  if (simOptions.startupDataType == SimulatorOptions::START_WITH_FILE)
+    simulator->setSdPath(simOptions.sdPath);
+  else
+    simulator->setSdPath(simOptions.sdPath, simOptions.dataFolder);
+  simulator->init();
+
+  int result = 0;
+  if (!simulator->runTimeline(timelineFile, outputFile, dataFile.isEmpty() ? NULL : dataFile.constData(), false)) {
+    showMessage(QApplication::translate("SimulatorMain", "ERROR: Timeline %1 failed, see the debug output.").arg(timelineFile), QMessageBox::Critical, true);
+    result = 2;
+  }
+
+  delete simulator;
+  SimulatorLoader::unloadSimulator(simOptions.firmwareId);
+  return result;
+}
+
 int main(int argc, char *argv[])
 {
 
@@ -298,7 +353,8 @@ int main(int argc, char *argv[])
   // Handle startup options
 
   // check for command-line options
-  CommandLineParseResult cliResult = cliOptions(&simOptions, &profileId);
+  QString timelineFile, outputFile;
+  CommandLineParseResult cliResult = cliOptions(&simOptions, &profileId, &timelineFile, &outputFile);
 
   if (cliResult == CommandLineExitOk)
     return finish(0);
@@ -306,7 +362,7 @@ int main(int argc, char *argv[])
     return finish(1);
 
   // Present GUI startup options dialog if necessary
-  if (cliResult == CommandLineNone || profileId == -1 || simOptions.firmwareId.isEmpty() || (simOptions.dataFile.isEmpty() && simOptions.dataFolder.isEmpty())) {
+  if (timelineFile.isEmpty() && (cliResult == CommandLineNone || profileId == -1 || simOptions.firmwareId.isEmpty() || (simOptions.dataFile.isEmpty() && simOptions.dataFolder.isEmpty()))) {
     SimulatorStartupDialog * dlg = new SimulatorStartupDialog(&simOptions, &profileId);
     int ret = dlg->exec();
     delete dlg;
@@ -340,6 +396,10 @@ int main(int argc, char *argv[])
   // Set global firmware environment
   Firmware::setCurrentVariant(Firmware::getFirmwareForId(simOptions.firmwareId));
 
+  if (!timelineFile.isEmpty()) {
+    return finish(runTimeline(simOptions, timelineFile, outputFile));
+  }
+
   int result = 0;
   SimulatorMainWindow * mainWindow = new SimulatorMainWindow(NULL, simOptions.firmwareId, SIMULATOR_FLAGS_STANDALONE);
   if ((result = mainWindow->getExitStatus(&resultMsg))) {
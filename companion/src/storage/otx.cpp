@@ -21,8 +21,29 @@
 #include "otx.h"
 #include "miniz.c"
 #include <QFile>
+#include <QSaveFile>
+#include <climits>
 
-#define MZ_ALLOCATION_SIZE    (32*1024)
+size_t OtxFormat::zipRead(void * opaque, mz_uint64 offset, void * buffer, size_t size)
+{
+  QFileDevice * file = (QFileDevice *)opaque;
+  if ((mz_uint64)file->pos() != offset && !file->seek(offset)) {
+    return 0;
+  }
+  qint64 len = file->read((char *)buffer, size);
+  return len < 0 ? 0 : len;
+}
+
+size_t OtxFormat::zipWrite(void * opaque, mz_uint64 offset, const void * buffer, size_t size)
+{
+  // miniz goes back to the local headers once the file data is compressed
+  QFileDevice * file = (QFileDevice *)opaque;
+  if ((mz_uint64)file->pos() != offset && !file->seek(offset)) {
+    return 0;
+  }
+  qint64 len = file->write((const char *)buffer, size);
+  return len < 0 ? 0 : len;
+}
 
 bool OtxFormat::load(RadioData & radioData)
 {
@@ -33,13 +54,13 @@ bool OtxFormat::load(RadioData & radioData)
     return false;
   }
 
-  QByteArray archiveContents = file.readAll();
-
-  qDebug() << "File" << filename << "read, size:" << archiveContents.size();
+  qDebug() << "File" << filename << "opened, size:" << file.size();
 
-  // open zip file
+  // open zip file, only its central directory is read here
   memset(&zip_archive, 0, sizeof(zip_archive));
-  if (!mz_zip_reader_init_mem(&zip_archive, archiveContents.data(), archiveContents.size(), 0)) {
+  zip_archive.m_pRead = zipRead;
+  zip_archive.m_pIO_opaque = &file;
+  if (!mz_zip_reader_init(&zip_archive, file.size(), 0)) {
     qDebug() << tr("Error opening OTX archive %1").arg(filename);
     return false;
   }
@@ -53,55 +74,62 @@ bool OtxFormat::write(const RadioData & radioData)
 {
   qDebug() << "Saving to archive" << filename;
 
+  // the previous file is only replaced once the whole archive has been written
+  QSaveFile file(filename);
+  if (!file.open(QIODevice::WriteOnly)) {
+    setError(tr("Error creating OTX file %1:\n%2.").arg(filename).arg(file.errorString()));
+    return false;
+  }
+
   memset(&zip_archive, 0, sizeof(zip_archive));
-  if (!mz_zip_writer_init_heap(&zip_archive, 0, MZ_ALLOCATION_SIZE)) {
+  zip_archive.m_pWrite = zipWrite;
+  zip_archive.m_pIO_opaque = &file;
+  if (!mz_zip_writer_init(&zip_archive, 0)) {
     setError(tr("Error initializing OTX archive writer"));
     return false;
   }
 
   bool result = CategorizedStorageFormat::write(radioData);
   if (result) {
-    // finalize archive and get contents
-    char * archiveContents;
-    size_t archiveSize;
-    if (mz_zip_writer_finalize_heap_archive(&zip_archive, (void **)&archiveContents, &archiveSize)) {
-      qDebug() << "Archive size" << archiveSize;
-      // write contents to file
-      QFile file(filename);
-      if (file.open(QIODevice::WriteOnly)) {
-        qint64 len = file.write(archiveContents, archiveSize);
-        if (len != (qint64)archiveSize) {
-          setError(tr("Error writing file %1:\n%2.").arg(filename).arg(file.errorString()));
-          result = false;
-        }
-      }
-      else {
-        setError(tr("Error creating OTX file %1:\n%2.").arg(filename).arg(file.errorString()));
-        result = false;
-      }
-    }
-    else {
+    if (!mz_zip_writer_finalize_archive(&zip_archive)) {
       setError(tr("Error creating OTX archive"));
       result = false;
     }
+    else {
+      qDebug() << "Archive size" << zip_archive.m_archive_size;
+    }
   }
 
   mz_zip_writer_end(&zip_archive);
+
+  if (result && !file.commit()) {
+    setError(tr("Error writing file %1:\n%2.").arg(filename).arg(file.errorString()));
+    result = false;
+  }
+
   return result;
 }
 
 bool OtxFormat::loadFile(QByteArray & filedata, const QString & filename)
 {
-  size_t size;
-  void * data = mz_zip_reader_extract_file_to_heap(&zip_archive, qPrintable(filename), &size, 0);
-  if (!data) {
+  int index = mz_zip_reader_locate_file(&zip_archive, qPrintable(filename), NULL, 0);
+  if (index < 0) {
+    return false;
+  }
+
+  // extract straight into the destination buffer
+  mz_zip_archive_file_stat stat;
+  if (!mz_zip_reader_file_stat(&zip_archive, index, &stat) || stat.m_uncomp_size > INT_MAX) {
+    return false;
+  }
+
+  filedata.resize(stat.m_uncomp_size);
+  if (!mz_zip_reader_extract_to_mem(&zip_archive, index, filedata.data(), filedata.size(), 0)) {
+    filedata.clear();
     return false;
   }
 
-  qDebug() << QString("Extracted file %1, size=%2").arg(filename).arg(size);
-  filedata.clear();
-  filedata.append((char *)data, size);
-  mz_free(data);
+  qDebug() << QString("Extracted file %1, size=%2").arg(filename).arg(filedata.size());
   return true;
 }
 
@@ -47,6 +47,10 @@ class OtxFormat : public CategorizedStorageFormat
     virtual bool loadFile(QByteArray & fileData, const QString & fileName);
     virtual bool writeFile(const QByteArray & fileData, const QString & fileName);
 
+    // the archive is read and written through the file, it is never held in memory as a whole
+    static size_t zipRead(void * opaque, mz_uint64 offset, void * buffer, size_t size);
+    static size_t zipWrite(void * opaque, mz_uint64 offset, const void * buffer, size_t size);
+
     mz_zip_archive zip_archive;
 };
 
@@ -19,6 +19,7 @@
  */
 
 #include "opentx.h"
+#include "audio_mix.h"
 #include <math.h>
 
 extern OS_MutexID audioMutex;
@@ -492,7 +493,9 @@ AudioQueue::AudioQueue()
   backgroundContext(),
   priorityContext(),
   varioContext(),
-  fragmentsFifo()
+  fragmentsFifo(),
+  commandsFifos(),
+  commandsSeq(0)
 {
 }
 
@@ -528,10 +531,8 @@ void audioTask(void * pdata)
 }
 #endif
 
-inline void mixSample(audio_data_t * result, int sample, unsigned int fade)
-{
-  *result = limit(AUDIO_DATA_MIN, *result + ((sample >> fade) >> (16-AUDIO_BITS_PER_SAMPLE)), AUDIO_DATA_MAX);
-}
+// the samples of a context, before they are added to the audio buffer (only the audio task mixes)
+static int16_t mixSamples[AUDIO_BUFFER_SIZE];
 
 #if defined(SDCARD)
 
@@ -598,31 +599,20 @@ int WavContext::mixBuffer(AudioBuffer *buffer, int volume, unsigned int fade)
         fragment.clear();
       }
 
-      audio_data_t * samples = buffer->data;
+      uint32_t count = 0;
+      unsigned int shift = fade + 2 - volume + AUDIO_SAMPLE_SHIFT;
       if (state.codec == CODEC_ID_PCM_S16LE) {
-        read /= 2;
-        for (uint32_t i=0; i<read; i++) {
-          for (uint8_t j=0; j<state.resampleRatio; j++) {
-            mixSample(samples++, ((int16_t *)wavBuffer)[i], fade+2-volume);
-          }
-        }
+        count = audioResamplePcm16(mixSamples, (int16_t *)wavBuffer, read / 2, state.resampleRatio, shift);
       }
       else if (state.codec == CODEC_ID_PCM_ALAW) {
-        for (uint32_t i=0; i<read; i++) {
-          for (uint8_t j=0; j<state.resampleRatio; j++) {
-            mixSample(samples++, alawTable[wavBuffer[i]], fade+2-volume);
-          }
-        }
+        count = audioResampleTable(mixSamples, wavBuffer, alawTable, read, state.resampleRatio, shift);
       }
       else if (state.codec == CODEC_ID_PCM_MULAW) {
-        for (uint32_t i=0; i<read; i++) {
-          for (uint8_t j=0; j<state.resampleRatio; j++) {
-            mixSample(samples++, ulawTable[wavBuffer[i]], fade+2-volume);
-          }
-        }
+        count = audioResampleTable(mixSamples, wavBuffer, ulawTable, read, state.resampleRatio, shift);
       }
 
-      return samples - buffer->data;
+      audioMixBlock(buffer->data, mixSamples, count);
+      return count;
     }
   }
 
@@ -639,13 +629,11 @@ int WavContext::mixBuffer(AudioBuffer *buffer, int volume, unsigned int fade)
 #endif
 
 const unsigned int toneVolumes[] = { 10, 8, 6, 4, 2 };
-inline float evalVolumeRatio(int freq, int volume)
+// 16.16 multiplier, the low frequencies are louder
+inline int32_t evalToneVolume(int freq, int volume)
 {
-  float result = toneVolumes[2+volume];
-  if (freq < 330) {
-    result = (result * freq * freq) / (330 * 330);
-  }
-  return result;
+  uint64_t divisor = toneVolumes[2+volume] * (freq < 330 ? freq * freq : 330 * 330);
+  return ((uint64_t)65536 * 330 * 330 + divisor / 2) / divisor;
 }
 
 int ToneContext::mixBuffer(AudioBuffer * buffer, int volume, unsigned int fade)
@@ -656,7 +644,7 @@ int ToneContext::mixBuffer(AudioBuffer * buffer, int volume, unsigned int fade)
   int remainingDuration = fragment.tone.duration - state.duration;
   if (remainingDuration > 0) {
     int points;
-    float toneIdx = state.idx;
+    uint32_t toneIdx = state.idx;
 
     if (fragment.tone.reset) {
       fragment.tone.reset = 0;
@@ -666,8 +654,8 @@ int ToneContext::mixBuffer(AudioBuffer * buffer, int volume, unsigned int fade)
 
     if (fragment.tone.freq != state.freq) {
       state.freq = fragment.tone.freq;
-      state.step = limit<float>(1, float(fragment.tone.freq) * (float(DIM(sineValues))/float(AUDIO_SAMPLE_RATE)), 512);
-      state.volume = 1.0f / evalVolumeRatio(fragment.tone.freq, volume);
+      state.step = limit<uint32_t>(1 << 16, ((uint64_t)fragment.tone.freq * DIM(sineValues) << 16) / AUDIO_SAMPLE_RATE, 512 << 16);
+      state.volume = evalToneVolume(fragment.tone.freq, volume);
     }
 
     if (fragment.tone.freqIncr) {
@@ -695,21 +683,17 @@ int ToneContext::mixBuffer(AudioBuffer * buffer, int volume, unsigned int fade)
     else {
       duration = remainingDuration;
       points = (duration * AUDIO_BUFFER_SIZE) / AUDIO_BUFFER_DURATION;
-      unsigned int end = toneIdx + (state.step * points);
+      // the tone ends at the end of a sine period
+      uint32_t end = (toneIdx + (uint64_t)state.step * points) >> 16;
       if (end > DIM(sineValues))
         end -= (end % DIM(sineValues));
       else
         end = DIM(sineValues);
-      points = (float(end) - toneIdx) / state.step;
+      points = (((uint64_t)end << 16) - toneIdx) / state.step;
     }
 
-    for (int i=0; i<points; i++) {
-      int16_t sample = sineValues[int(toneIdx)] * state.volume;
-      mixSample(&buffer->data[i], sample, fade);
-      toneIdx += state.step;
-      if ((unsigned int)toneIdx >= DIM(sineValues))
-        toneIdx -= DIM(sineValues);
-    }
+    toneIdx = audioSynthTone(mixSamples, points, toneIdx, state.step, state.volume, fade + AUDIO_SAMPLE_SHIFT);
+    audioMixBlock(buffer->data, mixSamples, points);
 
     if (remainingDuration > AUDIO_BUFFER_DURATION) {
       state.duration += AUDIO_BUFFER_DURATION;
@@ -735,6 +719,8 @@ int ToneContext::mixBuffer(AudioBuffer * buffer, int volume, unsigned int fade)
 
 void AudioQueue::wakeup()
 {
+  processCommands();
+
   DEBUG_TIMER_START(debugTimerAudioConsume);
   audioConsumeCurrentBuffer();
   DEBUG_TIMER_STOP(debugTimerAudioConsume);
@@ -759,9 +745,7 @@ void AudioQueue::wakeup()
 
     // mix the normal context (tones and wavs)
     if (normalContext.isEmpty() && !fragmentsFifo.empty()) {
-      CoEnterMutexSection(audioMutex);
       normalContext.setFragment(fragmentsFifo.get());
-      CoLeaveMutexSection(audioMutex);
     }
     result = normalContext.mixBuffer(buffer, g_eeGeneral.beepVolume, g_eeGeneral.wavVolume, fade);
     if (result > 0) {
@@ -825,41 +809,156 @@ void AudioQueue::pause(uint16_t len)
 
 bool AudioQueue::isPlaying(uint8_t id)
 {
-  return normalContext.hasPromptId(id) ||
-         (isFunctionActive(FUNCTION_BACKGND_MUSIC) && backgroundContext.hasPromptId(id)) ||
-         fragmentsFifo.hasPromptId(id);
+  if (normalContext.hasPromptId(id) ||
+      (isFunctionActive(FUNCTION_BACKGND_MUSIC) && backgroundContext.hasPromptId(id)) ||
+      fragmentsFifo.hasPromptId(id)) {
+    return true;
+  }
+
+  for (uint8_t i=0; i<AUDIO_PRODUCERS_COUNT; i++) {
+    if (commandsFifos[i].hasPromptId(id)) {
+      return true;
+    }
+  }
+
+  return false;
 }
 
-void AudioQueue::playTone(uint16_t freq, uint16_t len, uint16_t pause, uint8_t flags, int8_t freqIncr)
+bool AudioQueue::isEmpty() const
+{
+  return fragmentsFifo.empty() && !hasPendingCommands();
+}
+
+bool AudioQueue::hasPendingCommands() const
+{
+  for (uint8_t i=0; i<AUDIO_PRODUCERS_COUNT; i++) {
+    if (!commandsFifos[i].empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The mixer, menus and telemetry tasks are the only producers of their fifo,
+// they never wait for the audio task nor for each other, nor mask the interrupts
+void AudioQueue::pushCommand(const AudioCommand & command)
 {
 #if defined(SIMU) && !defined(SIMU_AUDIO)
   return;
 #endif
 
-  CoEnterMutexSection(audioMutex);
+  AudioCommand stamped = command;
+  uint32_t seq;
+  do {
+    seq = commandsSeq;
+  } while (!audioCompareAndSwap(&commandsSeq, seq, seq + 1));
+  stamped.seq = seq;
 
-  freq = limit<uint16_t>(BEEP_MIN_FREQ, freq, BEEP_MAX_FREQ);
+  OS_TID task = CoGetCurTaskID();
 
-  if (flags & PLAY_BACKGROUND) {
-    varioContext.setFragment(freq, len, pause, 0, 0, (flags & PLAY_NOW));
+  if (task == mixerTaskId) {
+    commandsFifos[AUDIO_PRODUCER_MIXER].push(stamped);
+  }
+  else if (task == menusTaskId) {
+    commandsFifos[AUDIO_PRODUCER_MENUS].push(stamped);
+  }
+#if defined(TELEMETRY_FRSKY) || defined(TELEMETRY_MAVLINK)
+  else if (task == telemetryTaskId) {
+    commandsFifos[AUDIO_PRODUCER_TELEMETRY].push(stamped);
   }
+#endif
   else {
-    // adjust frequency and length according to the user preferences
-    freq += g_eeGeneral.speakerPitch * 15;
-    len = getToneLength(len);
+    commandsFifos[AUDIO_PRODUCER_OTHERS].pushShared(stamped);
+  }
+}
 
-    if (flags & PLAY_NOW) {
+// Only called from the audio task, which is the only one to touch the contexts
+void AudioQueue::processCommand(const AudioCommand & command)
+{
+  const AudioFragment & fragment = command.fragment;
+
+  switch (command.type) {
+    case AUDIO_COMMAND_PLAY:
+      fragmentsFifo.push(fragment);
+      break;
+
+    case AUDIO_COMMAND_PLAY_NOW:
       if (priorityContext.isFree()) {
         priorityContext.clear();
-        priorityContext.setFragment(freq, len, pause, flags & 0x0f, freqIncr, false);
+        priorityContext.setFragment(fragment.tone.freq, fragment.tone.duration, fragment.tone.pause, fragment.repeat, fragment.tone.freqIncr, false);
+      }
+      break;
+
+    case AUDIO_COMMAND_PLAY_BACKGROUND:
+      if (fragment.type == FRAGMENT_TONE) {
+        varioContext.setFragment(fragment.tone.freq, fragment.tone.duration, fragment.tone.pause, 0, 0, fragment.tone.reset);
+      }
+      else {
+        backgroundContext.clear();
+        backgroundContext.setFragment(fragment.file, 0, fragment.id);
+      }
+      break;
+
+    case AUDIO_COMMAND_STOP:
+      fragmentsFifo.removePromptById(fragment.id);
+      backgroundContext.stop(fragment.id);
+      break;
+
+    case AUDIO_COMMAND_STOP_ALL:
+      priorityContext.clear();
+      normalContext.clear();
+      // no break
+
+    case AUDIO_COMMAND_FLUSH:
+      fragmentsFifo.clear();
+      varioContext.clear();
+      backgroundContext.clear();
+      break;
+  }
+}
+
+// The fifos are merged in the order the commands were stamped, i.e. a flush
+// only removes what was played before it, whatever the producers (the order
+// of two commands pushed at the same time by two tasks is not defined anyway)
+void AudioQueue::processCommands()
+{
+  while (1) {
+    AudioCommandFifo * next = NULL;
+    const AudioCommand * nextCommand = NULL;
+    for (uint8_t i=0; i<AUDIO_PRODUCERS_COUNT; i++) {
+      const AudioCommand * command = commandsFifos[i].front();
+      // less than 128 commands are queued, the wrap around of seq is handled
+      if (command && (!nextCommand || int8_t(command->seq - nextCommand->seq) < 0)) {
+        next = &commandsFifos[i];
+        nextCommand = command;
       }
     }
-    else {
-      fragmentsFifo.push(AudioFragment(freq, len, pause, flags & 0x0f, freqIncr, false));
+    if (!next) {
+      break;
     }
+    processCommand(*nextCommand);
+    next->pop();
+  }
+}
+
+void AudioQueue::playTone(uint16_t freq, uint16_t len, uint16_t pause, uint8_t flags, int8_t freqIncr)
+{
+#if defined(SIMU) && !defined(SIMU_AUDIO)
+  return;
+#endif
+
+  freq = limit<uint16_t>(BEEP_MIN_FREQ, freq, BEEP_MAX_FREQ);
+
+  if (flags & PLAY_BACKGROUND) {
+    pushCommand(AudioCommand(AUDIO_COMMAND_PLAY_BACKGROUND, AudioFragment(freq, len, pause, 0, 0, (flags & PLAY_NOW))));
   }
+  else {
+    // adjust frequency and length according to the user preferences
+    freq += g_eeGeneral.speakerPitch * 15;
+    len = getToneLength(len);
 
-  CoLeaveMutexSection(audioMutex);
+    pushCommand(AudioCommand((flags & PLAY_NOW) ? AUDIO_COMMAND_PLAY_NOW : AUDIO_COMMAND_PLAY, AudioFragment(freq, len, pause, flags & 0x0f, freqIncr, false)));
+  }
 }
 
 #if defined(SDCARD)
@@ -887,17 +986,12 @@ void AudioQueue::playFile(const char * filename, uint8_t flags, uint8_t id)
     return;
   }
 
-  CoEnterMutexSection(audioMutex);
-
   if (flags & PLAY_BACKGROUND) {
-    backgroundContext.clear();
-    backgroundContext.setFragment(filename, 0, id);
+    pushCommand(AudioCommand(AUDIO_COMMAND_PLAY_BACKGROUND, AudioFragment(filename, 0, id)));
   }
   else {
-    fragmentsFifo.push(AudioFragment(filename, flags & 0x0f, id));
+    pushCommand(AudioCommand(AUDIO_COMMAND_PLAY, AudioFragment(filename, flags & 0x0f, id)));
   }
-
-  CoLeaveMutexSection(audioMutex);
 }
 
 void AudioQueue::stopPlay(uint8_t id)
@@ -910,12 +1004,9 @@ void AudioQueue::stopPlay(uint8_t id)
   return;
 #endif
 
-  CoEnterMutexSection(audioMutex);
-
-  fragmentsFifo.removePromptById(id);
-  backgroundContext.stop(id);
-
-  CoLeaveMutexSection(audioMutex);
+  AudioFragment fragment;
+  fragment.id = id;
+  pushCommand(AudioCommand(AUDIO_COMMAND_STOP, fragment));
 }
 
 void AudioQueue::stopSD()
@@ -923,26 +1014,25 @@ void AudioQueue::stopSD()
   sdAvailableSystemAudioFiles.reset();
   stopAll();
   playTone(0, 0, 100, PLAY_NOW);        // insert a 100ms pause
+
+#if !defined(SIMU)
+  // the audio task has to close its files before the SD card goes away
+  for (uint8_t i=0; i<10 && _started && hasPendingCommands(); i++) {
+    CoTickDelay(1);
+  }
+#endif
 }
 
 #endif
 
 void AudioQueue::stopAll()
 {
-  flush();
-  CoEnterMutexSection(audioMutex);
-  priorityContext.clear();
-  normalContext.clear();
-  CoLeaveMutexSection(audioMutex);
+  pushCommand(AudioCommand(AUDIO_COMMAND_STOP_ALL));
 }
 
 void AudioQueue::flush()
 {
-  CoEnterMutexSection(audioMutex);
-  fragmentsFifo.clear();
-  varioContext.clear();
-  backgroundContext.clear();
-  CoLeaveMutexSection(audioMutex);
+  pushCommand(AudioCommand(AUDIO_COMMAND_FLUSH));
 }
 
 void audioPlay(unsigned int index, uint8_t id)
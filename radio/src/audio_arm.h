@@ -192,9 +192,9 @@ class ToneContext {
     AudioFragment fragment;
 
     struct {
-      float step;
-      float idx;
-      float  volume;
+      uint32_t step;            // 16.16 fixed point, see audio_mix.h
+      uint32_t idx;             // 16.16 fixed point
+      int32_t  volume;          // 16.16 fixed point
       uint16_t freq;
       uint16_t duration;
       uint16_t pause;
@@ -474,6 +474,141 @@ class AudioFragmentFifo
 
 };
 
+enum AudioCommandTypes {
+  AUDIO_COMMAND_PLAY,                   // the fragment is queued
+  AUDIO_COMMAND_PLAY_NOW,               // the tone is played in the priority context, unless it is busy
+  AUDIO_COMMAND_PLAY_BACKGROUND,        // the tone goes to the vario context, the file to the background context
+  AUDIO_COMMAND_STOP,                   // the prompts with the fragment id are stopped
+  AUDIO_COMMAND_STOP_ALL,
+  AUDIO_COMMAND_FLUSH,
+};
+
+struct AudioCommand {
+  uint8_t type;
+  uint8_t seq;                          // the order of the commands of all the producers
+  AudioFragment fragment;
+
+  AudioCommand() {};
+
+  AudioCommand(uint8_t type):
+    type(type),
+    fragment()
+  {};
+
+  AudioCommand(uint8_t type, const AudioFragment & fragment):
+    type(type),
+    fragment(fragment)
+  {};
+};
+
+// Each producer has its own commands fifo, only the audio task reads them
+enum AudioProducers {
+  AUDIO_PRODUCER_MIXER,
+  AUDIO_PRODUCER_MENUS,
+  AUDIO_PRODUCER_TELEMETRY,
+  AUDIO_PRODUCER_OTHERS,                // the other tasks share this one
+  AUDIO_PRODUCERS_COUNT
+};
+
+// Compare and swap with LDREX / STREX, the producers never mask the interrupts
+inline bool audioCompareAndSwap(volatile uint32_t * ptr, uint32_t expected, uint32_t value)
+{
+#if defined(SIMU)
+  return __sync_bool_compare_and_swap(ptr, expected, value);
+#else
+  if (__LDREXW((uint32_t *)ptr) != expected) {
+    __CLREX();
+    return false;
+  }
+  return __STREXW(value, (uint32_t *)ptr) == 0;
+#endif
+}
+
+class AudioCommandFifo
+{
+#if defined(CLI)
+  friend void printAudioVars();
+#endif
+  private:
+    volatile uint32_t ridx;
+    volatile uint32_t widx;
+    AudioCommand commands[AUDIO_QUEUE_LENGTH];
+    volatile uint8_t ready[AUDIO_QUEUE_LENGTH];   // the command of the slot is written
+
+    static uint32_t nextIdx(uint32_t idx)
+    {
+      return (idx + 1) & (AUDIO_QUEUE_LENGTH - 1);
+    }
+
+    void publish(uint32_t idx, const AudioCommand & command)
+    {
+      commands[idx] = command;
+      __DMB();
+      ready[idx] = 1;
+    }
+
+  public:
+    AudioCommandFifo() : ridx(0), widx(0), commands(), ready() {};
+
+    bool hasPromptId(uint8_t id) const
+    {
+      uint32_t i = ridx;
+      while (i != widx && ready[i]) {
+        const AudioCommand & command = commands[i];
+        if ((command.type == AUDIO_COMMAND_PLAY || (command.type == AUDIO_COMMAND_PLAY_BACKGROUND && command.fragment.type == FRAGMENT_FILE)) && command.fragment.id == id) return true;
+        i = nextIdx(i);
+      }
+      return false;
+    }
+
+    bool empty() const
+    {
+      return ridx == widx;
+    }
+
+    bool full() const
+    {
+      return ridx == nextIdx(widx);
+    }
+
+    // producer side, only one producer: the slot is taken, then the command is written
+    void push(const AudioCommand & command)
+    {
+      uint32_t idx = widx;
+      if (nextIdx(idx) != ridx) {
+        widx = nextIdx(idx);
+        publish(idx, command);
+      }
+    }
+
+    // producer side, several producers: each one claims its slot with a compare and swap
+    void pushShared(const AudioCommand & command)
+    {
+      uint32_t idx;
+      do {
+        idx = widx;
+        if (nextIdx(idx) == ridx) {
+          return; // full
+        }
+      } while (!audioCompareAndSwap(&widx, idx, nextIdx(idx)));
+      publish(idx, command);
+    }
+
+    // consumer side: the command stays in the fifo until pop() is called
+    const AudioCommand * front() const
+    {
+      return (empty() || !ready[ridx]) ? 0 : &commands[ridx];
+    }
+
+    void pop()
+    {
+      // the command is read before its slot is given back to the producers
+      __DMB();
+      ready[ridx] = 0;
+      ridx = nextIdx(ridx);
+    }
+};
+
 class AudioQueue {
 
 #if defined(SIMU_AUDIO)
@@ -493,7 +628,7 @@ class AudioQueue {
     void pause(uint16_t tLen);
     void stopSD();
     bool isPlaying(uint8_t id);
-    bool isEmpty() const { return fragmentsFifo.empty(); };
+    bool isEmpty() const;
     void wakeup();
     bool started() const { return _started; };
 
@@ -506,6 +641,13 @@ class AudioQueue {
     ToneContext  priorityContext;
     ToneContext  varioContext;
     AudioFragmentFifo fragmentsFifo;
+    AudioCommandFifo commandsFifos[AUDIO_PRODUCERS_COUNT];
+    volatile uint32_t commandsSeq;
+
+    void pushCommand(const AudioCommand & command);
+    void processCommand(const AudioCommand & command);
+    void processCommands();
+    bool hasPendingCommands() const;
 };
 
 extern uint8_t currentSpeakerVolume;
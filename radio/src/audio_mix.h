@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _AUDIO_MIX_H_
+#define _AUDIO_MIX_H_
+
+// Audio mixing kernels, used by the audio contexts (audio_arm.cpp)
+//
+// A context first writes its samples in a block of int16_t, already shifted
+// to the resolution of the audio buffer. The block is then added to the
+// buffer with saturation, 2 samples per instruction with the DSP
+// instructions of the Cortex-M4, 8 with SSE2 or NEON in the simulator.
+// All of them give exactly the same result as audioMixBlockGeneric().
+//
+// The tones are synthesized in fixed point: the phase is a 16.16 index in
+// sineValues[] and the volume a 16.16 multiplier. Compared to the former
+// float synthesis, a sample is within 1 LSB of the exact value at the same
+// index, and the index is never more than 1/100 away from the exact phase
+// during a buffer (tests/audio.cpp).
+
+#define AUDIO_SINE_VALUES              1024
+#define AUDIO_SINE_PHASE_MASK          ((AUDIO_SINE_VALUES << 16) - 1)
+#define AUDIO_SAMPLE_SHIFT             (16-AUDIO_BITS_PER_SAMPLE)
+
+extern const int16_t sineValues[AUDIO_SINE_VALUES];
+
+inline audio_data_t audioSaturate(int32_t value)
+{
+  return limit<int32_t>(AUDIO_DATA_MIN, value, AUDIO_DATA_MAX);
+}
+
+inline void audioMixBlockGeneric(audio_data_t * data, const int16_t * samples, uint32_t count)
+{
+  for (uint32_t i=0; i<count; i++) {
+    data[i] = audioSaturate(data[i] + samples[i]);
+  }
+}
+
+inline void audioMixBlock(audio_data_t * data, const int16_t * samples, uint32_t count)
+{
+  uint32_t i = 0;
+
+#if defined(__ARM_FEATURE_DSP) && !defined(SIMU)
+  // the buffers may be only half word aligned, memcpy() gives plain (unaligned) LDR / STR
+  for (; i+2<=count; i+=2) {
+    uint32_t a, b;
+    memcpy(&a, &data[i], sizeof(a));
+    memcpy(&b, &samples[i], sizeof(b));
+#if defined(PCBX12S)
+    a = __QADD16(a, b);
+#else
+    // the sum of a 12 bits sample and a shifted sample always fits in 16 bits
+    a = __USAT16(__SADD16(a, b), AUDIO_BITS_PER_SAMPLE);
+#endif
+    memcpy(&data[i], &a, sizeof(a));
+  }
+#elif defined(SIMU) && defined(__SSE2__)
+  // the unsigned buffer samples are moved to the signed range to use the saturated add
+  const __m128i offset = _mm_set1_epi16(AUDIO_DATA_SILENCE);
+  for (; i+8<=count; i+=8) {
+    __m128i a = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&data[i]), offset);
+    __m128i b = _mm_loadu_si128((const __m128i *)&samples[i]);
+    _mm_storeu_si128((__m128i *)&data[i], _mm_xor_si128(_mm_adds_epi16(a, b), offset));
+  }
+#elif defined(SIMU) && defined(__ARM_NEON)
+  const int16x8_t offset = vdupq_n_s16(AUDIO_DATA_SILENCE);
+  for (; i+8<=count; i+=8) {
+    int16x8_t a = veorq_s16(vreinterpretq_s16_u16(vld1q_u16(&data[i])), offset);
+    int16x8_t b = vld1q_s16(&samples[i]);
+    vst1q_u16(&data[i], vreinterpretq_u16_s16(veorq_s16(vqaddq_s16(a, b), offset)));
+  }
+#endif
+
+  audioMixBlockGeneric(&data[i], &samples[i], count - i);
+}
+
+// Returns the phase after the last sample
+inline uint32_t audioSynthTone(int16_t * samples, uint32_t count, uint32_t phase, uint32_t step, int32_t volume, unsigned int shift)
+{
+  for (uint32_t i=0; i<count; i++) {
+    int32_t sample = (int32_t)(((int64_t)sineValues[phase >> 16] * volume + 0x8000) >> 16);
+    samples[i] = limit<int32_t>(INT16_MIN, sample, INT16_MAX) >> shift;
+    phase = (phase + step) & AUDIO_SINE_PHASE_MASK;
+  }
+  return phase;
+}
+
+// Each sample of the file is repeated ratio times, returns the number of samples written
+inline uint32_t audioResamplePcm16(int16_t * samples, const int16_t * input, uint32_t count, uint8_t ratio, unsigned int shift)
+{
+  int16_t * result = samples;
+  for (uint32_t i=0; i<count; i++) {
+    int16_t sample = input[i] >> shift;
+    for (uint8_t j=0; j<ratio; j++) {
+      *result++ = sample;
+    }
+  }
+  return result - samples;
+}
+
+// Same for the A-law / u-law files, decoded with their table
+inline uint32_t audioResampleTable(int16_t * samples, const uint8_t * input, const int16_t * table, uint32_t count, uint8_t ratio, unsigned int shift)
+{
+  int16_t * result = samples;
+  for (uint32_t i=0; i<count; i++) {
+    int16_t sample = table[input[i]] >> shift;
+    for (uint8_t j=0; j<ratio; j++) {
+      *result++ = sample;
+    }
+  }
+  return result - samples;
+}
+
+#endif // _AUDIO_MIX_H_
@@ -23,76 +23,185 @@
 
 #include "debug.h"
 
-template <int SIZE_SLOT, int NUM_BINS> class BinAllocator {
-private:
-  PACK(struct Bin {
-    char data[SIZE_SLOT];
-    bool Used;
-  });
-  struct Bin Bins[NUM_BINS];
-  int NoUsedBins;
-public:
-  BinAllocator() : NoUsedBins(0) {
-    memclear(Bins, sizeof(Bins));
-  }
-  bool free(void * ptr) {
-    for (size_t n = 0; n < NUM_BINS; ++n) {
-      if (ptr == Bins[n].data) {
-        Bins[n].Used = false;
-        --NoUsedBins;
-        // TRACE("\tBinAllocator<%d> free %lu ------", SIZE_SLOT, n);
-        return true;
+// Lua heap allocator
+//
+// The small blocks, which are most of the Lua allocations (strings, tables,
+// closures, upvalues, hash nodes), are taken from a static arena divided in
+// size classes. Each class has a free list: malloc() and free() are O(1), the
+// class of a block is found from its address. When its class is full a block
+// is taken from the next classes, and after them from libc malloc(), as are
+// the blocks bigger than the largest class. The slots are 8 bytes aligned.
+
+struct BinClass {
+  uint16_t size;                 // slot size in bytes, multiple of 8
+  uint16_t count;                // number of slots
+};
+
+// tuned on the allocations of the Lua scripts and widgets
+#if defined(SIMU)
+constexpr BinClass binClasses[] = { {16, 400}, {24, 300}, {32, 200}, {48, 120}, {64, 60}, {96, 30} };
+#else
+constexpr BinClass binClasses[] = { {16, 160}, {24, 112}, {32, 72}, {48, 32}, {64, 16}, {96, 8} };
+#endif
+
+constexpr uint32_t getBinArenaSize(unsigned int index=0)
+{
+  return index < DIM(binClasses) ? binClasses[index].size * binClasses[index].count + getBinArenaSize(index+1) : 0;
+}
+
+struct BinClassStats {
+  uint16_t used;                 // slots in use
+  uint16_t peak;                 // max slots in use
+  uint32_t requested;            // bytes requested by the blocks in use
+  uint32_t spilled;              // blocks of this size taken from a larger class
+  uint32_t failed;               // blocks of this size taken from libc
+};
+
+class BinAllocator
+{
+  public:
+    static const uint8_t CLASSES = DIM(binClasses);
+    static const uint32_t ARENA_SIZE = getBinArenaSize();
+    static const uint16_t MAX_SIZE = binClasses[CLASSES-1].size;
+
+    BinAllocator()
+    {
+      reset();
+    }
+
+    void reset()
+    {
+      uint8_t * slot = (uint8_t *)arena;
+      memclear(stats, sizeof(stats));
+      for (uint8_t i=0; i<CLASSES; i++) {
+        // the free lists are in address order
+        freeList[i] = NULL;
+        slot += binClasses[i].size * binClasses[i].count;
+        classEnd[i] = slot;
+        for (uint16_t j=0; j<binClasses[i].count; j++) {
+          slot -= binClasses[i].size;
+          *(void **)slot = freeList[i];
+          freeList[i] = slot;
+        }
+        slot = classEnd[i];
+      }
+      for (uint16_t size=0; size<=MAX_SIZE; size+=8) {
+        uint8_t index = 0;
+        while (binClasses[index].size < size)
+          index++;
+        sizeClass[size/8] = index;
+      }
+    }
+
+    bool isMember(const void * ptr) const
+    {
+      return ptr >= (const void *)arena && ptr < (const void *)classEnd[CLASSES-1];
+    }
+
+    // Returns NULL when the size is too big, or when there is no room left
+    void * malloc(size_t size)
+    {
+      if (size > MAX_SIZE)
+        return NULL;
+      return allocate(getSizeClass(size), CLASSES-1, size);
+    }
+
+    // Returns false when the block isn't ours, size is the requested size of the block
+    bool free(void * ptr, size_t size)
+    {
+      int index = getPointerClass(ptr);
+      if (index < 0)
+        return false;
+      *(void **)ptr = freeList[index];
+      freeList[index] = ptr;
+      stats[index].used--;
+      stats[index].requested -= size;
+      return true;
+    }
+
+    // ptr has to be NULL or one of our blocks. Returns NULL when there is no
+    // room for the new size, the block is then left unchanged
+    void * realloc(void * ptr, size_t osize, size_t nsize)
+    {
+      if (!ptr)
+        return malloc(nsize);
+
+      int current = getPointerClass(ptr);
+      if (nsize <= binClasses[current].size) {
+        uint8_t index = getSizeClass(nsize);
+        void * result = (index < current ? allocate(index, current-1, nsize) : NULL);
+        if (!result) {
+          // still in the same slot
+          stats[current].requested += nsize - osize;
+          return ptr;
+        }
+        memcpy(result, ptr, nsize);
+        free(ptr, osize);
+        return result;
+      }
+
+      void * result = malloc(nsize);
+      if (result) {
+        memcpy(result, ptr, osize);
+        free(ptr, osize);
       }
+      return result;
+    }
+
+    const BinClassStats & getStats(uint8_t index) const
+    {
+      return stats[index];
     }
-    return false;
-  }
-  bool is_member(void * ptr) {
-    return (ptr >= Bins[0].data && ptr <= Bins[NUM_BINS-1].data);
-  }
-  void * malloc(size_t size) {
-    if (size > SIZE_SLOT) {
-      // TRACE("BinAllocator<%d> malloc [%lu] size > SIZE_SLOT", SIZE_SLOT, size);
-      return 0;
+
+  private:
+    uint64_t arena[ARENA_SIZE / sizeof(uint64_t)];
+    uint8_t * classEnd[CLASSES];
+    void * freeList[CLASSES];
+    uint8_t sizeClass[MAX_SIZE / 8 + 1];
+    BinClassStats stats[CLASSES];
+
+    uint8_t getSizeClass(size_t size) const
+    {
+      return sizeClass[(size + 7) / 8];
     }
-    if (NoUsedBins >= NUM_BINS) {
-      // TRACE("BinAllocator<%d> malloc [%lu] no free slots", SIZE_SLOT, size);
-      return 0;
+
+    int getPointerClass(const void * ptr) const
+    {
+      if (!isMember(ptr))
+        return -1;
+      uint8_t index = 0;
+      while ((const uint8_t *)ptr >= classEnd[index])
+        index++;
+      return index;
     }
-    for (size_t n = 0; n < NUM_BINS; ++n) {
-      if (!Bins[n].Used) {
-        Bins[n].Used = true;
-        ++NoUsedBins;
-        // TRACE("\tBinAllocator<%d> malloc %lu[%lu]", SIZE_SLOT, n, size);
-        return Bins[n].data;
+
+    // Takes a slot in the first class with room between first and last
+    void * allocate(uint8_t first, uint8_t last, size_t size)
+    {
+      for (uint8_t index=first; index<=last; index++) {
+        void * result = freeList[index];
+        if (result) {
+          freeList[index] = *(void **)result;
+          BinClassStats & classStats = stats[index];
+          if (++classStats.used > classStats.peak)
+            classStats.peak = classStats.used;
+          classStats.requested += size;
+          if (index != first)
+            stats[first].spilled++;
+          return result;
+        }
       }
+      if (last == CLASSES-1)
+        stats[first].failed++;
+      return NULL;
     }
-    // TRACE("BinAllocator<%d> malloc [%lu] no free slots", SIZE_SLOT , size);
-    return 0;
-  }
-  size_t size(void * ptr) {
-    return is_member(ptr) ? SIZE_SLOT : 0;
-  }
-  bool can_fit(void * ptr, size_t size) {
-    return is_member(ptr) && size <= SIZE_SLOT;  //todo is_member check is redundant
-  }
-  unsigned int capacity() { return NUM_BINS; }
-  unsigned int size() { return NoUsedBins; }
 };
 
-#if defined(SIMU)
-typedef BinAllocator<39,300> BinAllocator_slots1;
-typedef BinAllocator<79,100> BinAllocator_slots2;
-#else
-typedef BinAllocator<29,200> BinAllocator_slots1;
-typedef BinAllocator<91,50> BinAllocator_slots2;
-#endif
-
-#if defined(USE_BIN_ALLOCATOR)
-extern BinAllocator_slots1 slots1;
-extern BinAllocator_slots2 slots2;
+// also built in the host tests of the radios with Lua
+extern BinAllocator binAllocator;
+extern uint32_t binAllocatorLibcBytes;
 
 // wrapper for our BinAllocator for Lua
 void *bin_l_alloc (void *ud, void *ptr, size_t osize, size_t nsize);
-#endif   //#if defined(USE_BIN_ALLOCATOR)
 
 #endif // _BIN_ALLOCATOR_H_
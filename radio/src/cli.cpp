@@ -19,6 +19,7 @@
  */
 
 #include "opentx.h"
+#include "bin_allocator.h"
 #include "diskio.h"
 #include <ctype.h>
 #include <malloc.h>
@@ -680,6 +681,12 @@ int cliStackInfo(const char ** argv)
   serialPrint("[MENUS] %d available / %d", menusStack.available(), menusStack.size());
   serialPrint("[MIXER] %d available / %d", mixerStack.available(), mixerStack.size());
   serialPrint("[AUDIO] %d available / %d", audioStack.available(), audioStack.size());
+#if defined(TELEMETRY_FRSKY) || defined(TELEMETRY_MAVLINK)
+  serialPrint("[TELEMETRY] %d available / %d", telemetryStack.available(), telemetryStack.size());
+#endif
+#if defined(STORAGE_TASK)
+  serialPrint("[STORAGE] %d available / %d", storageStack.available(), storageStack.size());
+#endif
 #if IS_TOUCH_ENABLED()
   serialPrint("[TOUCH] %d available / %d", TouchManager::taskStack().available(), TouchManager::taskStack().size());
 #endif
@@ -732,10 +739,46 @@ int cliMemoryInfo(const char ** argv)
   serialPrint("------------");
   serialPrint("\tTotal   %u", s + w + e);
 #endif
+#if defined(USE_BIN_ALLOCATOR)
+  serialPrint("\nLua allocator: slot used/peak/count, requested bytes, spilled, libc");
+  for (uint8_t i=0; i<BinAllocator::CLASSES; i++) {
+    const BinClassStats & stats = binAllocator.getStats(i);
+    serialPrint("\t%3d: %d/%d/%d, %u/%u, %u, %u", binClasses[i].size, stats.used, stats.peak, binClasses[i].count,
+                stats.requested, stats.used * binClasses[i].size, stats.spilled, stats.failed);
+  }
+  serialPrint("\tlibc    %u", binAllocatorLibcBytes);
+#endif
 #endif
   return 0;
 }
 
+#if defined(LUA_PROFILER)
+static void cliPrintLine(const char * line)
+{
+  serialPrint("%s", line);
+}
+
+int cliLuaProfiler(const char ** argv)
+{
+  if (!argv[1] || argv[1][0] == '\0') {
+    luaProfilerReport(cliPrintLine);
+  }
+  else if (!strcmp(argv[1], "reset")) {
+    luaProfilerReset();
+  }
+  else if (!strcmp(argv[1], "functions") && argv[2] && !strcmp(argv[2], "on")) {
+    luaProfileFunctions = true;
+  }
+  else if (!strcmp(argv[1], "functions") && argv[2] && !strcmp(argv[2], "off")) {
+    luaProfileFunctions = false;
+  }
+  else {
+    serialPrint("%s: Invalid argument \"%s\"", argv[0], argv[1]);
+  }
+  return 0;
+}
+#endif
+
 int cliReboot(const char ** argv)
 {
 #if !defined(SIMU)
@@ -836,6 +879,11 @@ void printTaskSwitchLog()
     else if (audioTaskId == n) {
       serialPrint("%d: audio", n);
     }
+#if defined(TELEMETRY_FRSKY) || defined(TELEMETRY_MAVLINK)
+    else if (telemetryTaskId == n) {
+      serialPrint("%d: telemetry", n);
+    }
+#endif
 #if IS_TOUCH_ENABLED()
     else if (TouchManager::taskId() == n) {
       serialPrint("%d: touch", n);
@@ -920,6 +968,9 @@ void printAudioVars()
   }
 
   serialPrint("FragmentFifo:  ridx: %d, widx: %d", audioQueue.fragmentsFifo.ridx, audioQueue.fragmentsFifo.widx);
+  for (int n = 0; n < AUDIO_PRODUCERS_COUNT; n++) {
+    serialPrint("CommandFifo[%d]:  ridx: %d, widx: %d", n, audioQueue.commandsFifos[n].ridx, audioQueue.commandsFifos[n].widx);
+  }
   serialPrint("audioQueue:  readIdx: %d, writeIdx: %d, full: %d", audioQueue.buffersFifo.readIdx, audioQueue.buffersFifo.writeIdx, audioQueue.buffersFifo.bufferFull);
 
   serialPrint("normalContext: %u", (uint32_t)audioQueue.normalContext.fragment.type);
@@ -1054,6 +1105,7 @@ int cliDisplay(const char ** argv)
     DiskCacheStats stats = diskCache.getStats();
     uint32_t hitRate = diskCache.getHitRate();
     serialPrint("Disk Cache stats: w:%u r: %u, h: %u(%0.1f%%), m: %u", stats.noWrites, (stats.noHits + stats.noMisses), stats.noHits, hitRate*0.1f, stats.noMisses);
+    serialPrint("                  evictions: %u, read ahead: %u, write back: %u", stats.noEvictions, stats.noReadAheads, stats.noWriteBacks);
   }
 #endif
   else if (toLongLongInt(argv, 1, &address) > 0) {
@@ -1339,6 +1391,9 @@ const CliCommand cliCommands[] = {
   { "set", cliSet, "<what> <value>" },
   { "stackinfo", cliStackInfo, "" },
   { "meminfo", cliMemoryInfo, "" },
+#if defined(LUA_PROFILER)
+  { "luaprof", cliLuaProfiler, "[reset | functions on|off]" },
+#endif
   { "test", cliTest, "new | std::exception | graphics | memspd" },
   { "trace", cliTrace, "on | off" },
   { "help", cliHelp, "[<command>]" },
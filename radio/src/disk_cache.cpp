@@ -34,15 +34,32 @@
 
 DiskCache diskCache;
 
+#if DISK_CACHE_BLOCK_SECTORS > 32
+  #error "DISK_CACHE_BLOCK_SECTORS can't be more than 32"
+#endif
+
+static inline uint32_t sectorsMask(DWORD offset, UINT count)
+{
+  return (count >= 32 ? 0xFFFFFFFF : (((uint32_t)1 << count) - 1)) << offset;
+}
+
+static inline DWORD blockStart(DWORD sector)
+{
+  return sector - (sector % DISK_CACHE_BLOCK_SECTORS);
+}
+
 DiskCacheBlock::DiskCacheBlock():
+  lastUse(0),
   startSector(0),
-  endSector(0) 
+  validSectors(0),
+  dirtySectors(0)
 {
 }
 
 bool DiskCacheBlock::read(BYTE * buff, DWORD sector, UINT count)
 {
-  if (sector >= startSector && (sector+count) <= endSector) {
+  uint32_t mask = sectorsMask(sector - startSector, count);
+  if ((validSectors & mask) == mask) {
     TRACE_DISK_CACHE("\tcache read(%u, %u) from %p", (uint32_t)sector, (uint32_t)count, this);
     memcpy(buff, data + ((sector - startSector) * BLOCK_SIZE), count * BLOCK_SIZE);
     return true;
@@ -50,115 +67,331 @@ bool DiskCacheBlock::read(BYTE * buff, DWORD sector, UINT count)
   return false;
 }
 
-DRESULT DiskCacheBlock::fill(BYTE drv, BYTE * buff, DWORD sector, UINT count)
+void DiskCacheBlock::write(const BYTE * buff, DWORD sector, UINT count, bool dirty)
+{
+  uint32_t mask = sectorsMask(sector - startSector, count);
+  memcpy(data + ((sector - startSector) * BLOCK_SIZE), buff, count * BLOCK_SIZE);
+  validSectors |= mask;
+  if (dirty)
+    dirtySectors |= mask;
+  else
+    dirtySectors &= ~mask;
+}
+
+DRESULT DiskCacheBlock::fill(BYTE drv, DWORD sector)
 {
   DRESULT res = __disk_read(drv, data, sector, DISK_CACHE_BLOCK_SECTORS);
   if (res != RES_OK) {
+    free();
     return res;
   }
   startSector = sector;
-  endSector = sector + DISK_CACHE_BLOCK_SECTORS;
-  memcpy(buff, data, count * BLOCK_SIZE);
-  TRACE_DISK_CACHE("\tcache %p FILLED from read(%u, %u)", this, (uint32_t)sector, (uint32_t)count);
+  validSectors = sectorsMask(0, DISK_CACHE_BLOCK_SECTORS);
+  dirtySectors = 0;
+  TRACE_DISK_CACHE("\tcache %p FILLED from read(%u)", this, (uint32_t)sector);
   return RES_OK;
 }
 
-void DiskCacheBlock::free(DWORD sector, UINT count) 
+// Writes the dirty sectors, one disk write for each run of consecutive sectors
+DRESULT DiskCacheBlock::flush(BYTE drv, uint32_t & writes)
 {
-  if (sector < endSector && (sector+count) > startSector) {
-    TRACE_DISK_CACHE("\tINVALIDATING disk cache block %p (%u)", this, startSector);
-    endSector = 0;
+  uint8_t i = 0;
+  while (dirtySectors) {
+    while (!(dirtySectors & (1u << i))) i++;
+    uint8_t count = 0;
+    while (i+count < DISK_CACHE_BLOCK_SECTORS && (dirtySectors & (1u << (i+count)))) count++;
+    TRACE_DISK_CACHE("\tcache %p WRITE BACK(%u, %u)", this, (uint32_t)startSector+i, (uint32_t)count);
+    DRESULT res = __disk_write(drv, data + i*BLOCK_SIZE, startSector + i, count);
+    if (res != RES_OK) {
+      return res;
+    }
+    ++writes;
+    dirtySectors &= ~sectorsMask(i, count);
+    i += count;
   }
+  return RES_OK;
+}
+
+void DiskCacheBlock::reset(DWORD sector)
+{
+  startSector = sector;
+  validSectors = 0;
+  dirtySectors = 0;
 }
 
 void DiskCacheBlock::free()
 {
-  endSector = 0;
+  validSectors = 0;
+  dirtySectors = 0;
 }
 
 bool DiskCacheBlock::empty() const
 {
-  return (endSector == 0);
+  return (validSectors == 0);
+}
+
+bool DiskCacheBlock::dirty() const
+{
+  return (dirtySectors != 0);
+}
+
+bool DiskCacheBlock::contains(DWORD sector) const
+{
+  return !empty() && sector >= startSector && sector < startSector + DISK_CACHE_BLOCK_SECTORS;
+}
+
+DWORD DiskCacheBlock::getStartSector() const
+{
+  return startSector;
 }
 
 DiskCache::DiskCache():
-  lastBlock(0)
+  useCounter(0)
 {
-  stats.noHits = 0;
-  stats.noMisses = 0;
-  stats.noWrites = 0;
+  memclear(&stats, sizeof(stats));
+  memclear(streams, sizeof(streams));
   blocks = new DiskCacheBlock[DISK_CACHE_BLOCKS_NUM];
 }
 
+// Drops everything, the dirty blocks must have been flushed before
 void DiskCache::clear()
 {
-  lastBlock = 0;
-  stats.noHits = 0;
-  stats.noMisses = 0;
-  stats.noWrites = 0;
+  useCounter = 0;
+  memclear(&stats, sizeof(stats));
+  memclear(streams, sizeof(streams));
   for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
     blocks[n].free();
   }
 }
 
-DRESULT DiskCache::read(BYTE drv, BYTE * buff, DWORD sector, UINT count)
+bool DiskCache::isCacheable(DWORD sector, UINT count) const
 {
-  // TODO: check if not caching first sectors would improve anything
-  // if (sector < 1000) {
-  //   ++stats.noMisses;
-  //   return __disk_read(drv, buff, sector, count);  
-  // }
+  // reads or writes bigger than a cache block go directly to the disk,
+  // as well as the last sectors of the disk which can't fill a whole block
+  return count <= DISK_CACHE_BLOCK_SECTORS && blockStart(sector + count - 1) + DISK_CACHE_BLOCK_SECTORS <= sdGetNoSectors();
+}
 
-  // if read is bigger than cache block, then read it directly without using cache
-  if (count > DISK_CACHE_BLOCK_SECTORS) {
-    TRACE_DISK_CACHE("\t\t big read(%u, %u)",  (uint32_t)sector, (uint32_t)count);
-    return __disk_read(drv, buff, sector, count);
-  }
-  
-  // if block + cache block size is beyond the end of the disk, then read it directly without using cache
-  if (sector+DISK_CACHE_BLOCK_SECTORS >= sdGetNoSectors()) {
-    TRACE_DISK_CACHE("\t\t cache would be beyond end of disk %u (%u)", (uint32_t)sector, sdGetNoSectors());
-    return __disk_read(drv, buff, sector, count);
+DiskCacheBlock * DiskCache::findBlock(DWORD sector)
+{
+  for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
+    if (blocks[n].contains(sector)) {
+      return &blocks[n];
+    }
   }
+  return NULL;
+}
+
+DRESULT DiskCache::flushBlock(BYTE drv, DiskCacheBlock * block)
+{
+  return block->flush(drv, stats.noWriteBacks);
+}
 
+// Least recently used block, written back first if needed
+DiskCacheBlock * DiskCache::getFreeBlock(BYTE drv)
+{
+  DiskCacheBlock * result = NULL;
   for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
-    if (blocks[n].read(buff, sector, count)) {
-      ++stats.noHits;
-      return RES_OK;
+    if (blocks[n].empty()) {
+      return &blocks[n];
+    }
+    if (!result || blocks[n].lastUse < result->lastUse) {
+      result = &blocks[n];
     }
   }
 
-  ++stats.noMisses;
+  TRACE_DISK_CACHE("\t\t evicting block %p (%u)", result, (uint32_t)result->getStartSector());
+  if (flushBlock(drv, result) != RES_OK) {
+    return NULL;
+  }
+  ++stats.noEvictions;
+  result->free();
+  return result;
+}
 
-  // find free block
+DRESULT DiskCache::flushOldestDirtyBlock(BYTE drv)
+{
+  DiskCacheBlock * oldest = NULL;
+  uint8_t count = 0;
   for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
-    if (blocks[n].empty()) {
-      TRACE_DISK_CACHE("\t\t using free block");
-      return blocks[n].fill(drv, buff, sector, count);
+    if (blocks[n].dirty()) {
+      ++count;
+      if (!oldest || blocks[n].lastUse < oldest->lastUse) {
+        oldest = &blocks[n];
+      }
     }
   }
+  if (count > DISK_CACHE_MAX_DIRTY_BLOCKS) {
+    return flushBlock(drv, oldest);
+  }
+  return RES_OK;
+}
 
-  // use next block (round robin)
-  // TODO: use better strategy to select which used block gets used here
-  if (++lastBlock >= DISK_CACHE_BLOCKS_NUM) {
-    lastBlock = 0;
+// Loads the whole block which starts at sector, block may already hold some of its sectors
+DRESULT DiskCache::loadBlock(BYTE drv, DiskCacheBlock * & block, DWORD sector)
+{
+  if (block) {
+    // the sectors written in the meantime have to be on the disk before the block is read again
+    DRESULT res = flushBlock(drv, block);
+    if (res != RES_OK) {
+      return res;
+    }
+  }
+  else {
+    block = getFreeBlock(drv);
+    if (!block) {
+      return RES_ERROR;
+    }
+  }
+  block->lastUse = ++useCounter;
+  return block->fill(drv, sector);
+}
+
+// Follows the sequential readers: the read-ahead window of a reader grows
+// while it keeps reading the next sectors, and is reset when it seeks
+uint8_t DiskCache::getReadAhead(DWORD sector, UINT count)
+{
+  DiskCacheStream * stream = NULL;
+  for (int n=0; n<DISK_CACHE_STREAMS_NUM; ++n) {
+    if (streams[n].nextSector == sector && streams[n].lastUse) {
+      stream = &streams[n];
+      stream->readAhead = (stream->readAhead ? min<uint8_t>(stream->readAhead * 2, DISK_CACHE_MAX_READ_AHEAD) : 1);
+      break;
+    }
+    if (!stream || streams[n].lastUse < stream->lastUse) {
+      stream = &streams[n];
+    }
+  }
+  if (stream->nextSector != sector) {
+    stream->readAhead = 0;
+  }
+  stream->nextSector = sector + count;
+  stream->lastUse = ++useCounter;
+  return stream->readAhead;
+}
+
+void DiskCache::readAhead(BYTE drv, DWORD sector, uint8_t count)
+{
+  for (uint8_t i=0; i<count; i++) {
+    sector += DISK_CACHE_BLOCK_SECTORS;
+    if (!isCacheable(sector, DISK_CACHE_BLOCK_SECTORS))
+      break;
+    DiskCacheBlock * block = findBlock(sector);
+    if (!block) {
+      TRACE_DISK_CACHE("\t\t read ahead(%u)", (uint32_t)sector);
+      if (loadBlock(drv, block, sector) != RES_OK)
+        break;
+      ++stats.noReadAheads;
+    }
+  }
+}
+
+DRESULT DiskCache::read(BYTE drv, BYTE * buff, DWORD sector, UINT count)
+{
+  if (!isCacheable(sector, count)) {
+    TRACE_DISK_CACHE("\t\t direct read(%u, %u)",  (uint32_t)sector, (uint32_t)count);
+    // the cached sectors not yet written have to be on the disk first
+    for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
+      DWORD start = blocks[n].getStartSector();
+      if (blocks[n].dirty() && start < sector + count && start + DISK_CACHE_BLOCK_SECTORS > sector) {
+        DRESULT res = flushBlock(drv, &blocks[n]);
+        if (res != RES_OK) {
+          return res;
+        }
+      }
+    }
+    return __disk_read(drv, buff, sector, count);
+  }
+
+  uint8_t window = getReadAhead(sector, count);
+  bool miss = false;
+
+  while (count > 0) {
+    DWORD start = blockStart(sector);
+    UINT n = min<UINT>(count, start + DISK_CACHE_BLOCK_SECTORS - sector);
+    DiskCacheBlock * block = findBlock(start);
+    if (block && block->read(buff, sector, n)) {
+      ++stats.noHits;
+    }
+    else {
+      ++stats.noMisses;
+      miss = true;
+      DRESULT res = loadBlock(drv, block, start);
+      if (res != RES_OK) {
+        return res;
+      }
+      block->read(buff, sector, n);
+    }
+    block->lastUse = ++useCounter;
+    buff += n * BLOCK_SIZE;
+    sector += n;
+    count -= n;
+  }
+
+  if (miss && window) {
+    readAhead(drv, blockStart(sector - 1), window);
   }
-  
-  return blocks[lastBlock].fill(drv, buff, sector, count);
+
+  return RES_OK;
 }
 
-DRESULT DiskCache::write(BYTE drv, const BYTE* buff, DWORD sector, UINT count)
+DRESULT DiskCache::write(BYTE drv, const BYTE * buff, DWORD sector, UINT count)
 {
   ++stats.noWrites;
-  for(int n=0; n < DISK_CACHE_BLOCKS_NUM; ++n) {
-    blocks[n].free(sector, count);
+
+  if (!isCacheable(sector, count)) {
+    TRACE_DISK_CACHE("\t\t direct write(%u, %u)",  (uint32_t)sector, (uint32_t)count);
+    DRESULT res = __disk_write(drv, buff, sector, count);
+    if (res != RES_OK) {
+      return res;
+    }
+    // the cached copies of these sectors are updated, they are now on the disk
+    for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
+      if (blocks[n].empty())
+        continue;
+      DWORD start = max<DWORD>(sector, blocks[n].getStartSector());
+      DWORD end = min<DWORD>(sector + count, blocks[n].getStartSector() + DISK_CACHE_BLOCK_SECTORS);
+      if (start < end) {
+        blocks[n].write(buff + (start - sector) * BLOCK_SIZE, start, end - start, false);
+      }
+    }
+    return RES_OK;
   }
-  return __disk_write(drv, buff, sector, count);  
+
+  while (count > 0) {
+    DWORD start = blockStart(sector);
+    UINT n = min<UINT>(count, start + DISK_CACHE_BLOCK_SECTORS - sector);
+    DiskCacheBlock * block = findBlock(start);
+    if (!block) {
+      block = getFreeBlock(drv);
+      if (!block) {
+        return RES_ERROR;
+      }
+      block->reset(start);
+    }
+    block->write(buff, sector, n, true);
+    block->lastUse = ++useCounter;
+    buff += n * BLOCK_SIZE;
+    sector += n;
+    count -= n;
+  }
+
+  return flushOldestDirtyBlock(drv);
+}
+
+DRESULT DiskCache::flush(BYTE drv)
+{
+  for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
+    DRESULT res = flushBlock(drv, &blocks[n]);
+    if (res != RES_OK) {
+      return res;
+    }
+  }
+  return RES_OK;
 }
 
-const DiskCacheStats & DiskCache::getStats() const 
-{ 
-  return stats; 
+const DiskCacheStats & DiskCache::getStats() const
+{
+  return stats;
 }
 
 int DiskCache::getHitRate() const
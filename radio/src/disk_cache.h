@@ -25,25 +25,39 @@
 #include "sdio_sd.h"
 
 // tunable parameters
-#define DISK_CACHE_BLOCKS_NUM      32   // no cache blocks
-#define DISK_CACHE_BLOCK_SECTORS   16   // no sectors
+#define DISK_CACHE_BLOCKS_NUM         32   // no cache blocks
+#define DISK_CACHE_BLOCK_SECTORS      16   // no sectors (32 max)
+#define DISK_CACHE_MAX_READ_AHEAD     4    // no blocks read in advance on sequential reads
+#define DISK_CACHE_STREAMS_NUM        4    // no sequential readers followed at the same time
+#define DISK_CACHE_MAX_DIRTY_BLOCKS   8    // no blocks waiting to be written
 
 #define DISK_CACHE_BLOCK_SIZE   (DISK_CACHE_BLOCK_SECTORS * BLOCK_SIZE)
 
+// Blocks are aligned on DISK_CACHE_BLOCK_SECTORS. Writes are kept in the
+// block (dirty sectors) and written back when the block is evicted, when too
+// many blocks are dirty, or on flush() (FatFS sync, SD unmount)
 class DiskCacheBlock
 {
 public:
   DiskCacheBlock();
   bool read(BYTE* buff, DWORD sector, UINT count);
-  DRESULT fill(BYTE drv, BYTE* buff, DWORD sector, UINT count);
-  void free(DWORD sector, UINT count);
+  void write(const BYTE* buff, DWORD sector, UINT count, bool dirty);
+  DRESULT fill(BYTE drv, DWORD sector);
+  DRESULT flush(BYTE drv, uint32_t & writes);
+  void reset(DWORD sector);
   void free();
   bool empty() const;
+  bool dirty() const;
+  bool contains(DWORD sector) const;
+  DWORD getStartSector() const;
+
+  uint32_t lastUse;
 
 private:
   uint8_t data[DISK_CACHE_BLOCK_SIZE];
   DWORD startSector;
-  DWORD endSector;
+  uint32_t validSectors;
+  uint32_t dirtySectors;
 };
 
 struct DiskCacheStats
@@ -51,6 +65,17 @@ struct DiskCacheStats
   uint32_t noHits;
   uint32_t noMisses;
   uint32_t noWrites;
+  uint32_t noEvictions;
+  uint32_t noReadAheads;    // blocks read in advance
+  uint32_t noWriteBacks;    // disk writes done by the write-back
+};
+
+// A sequential reader (WAV file, bitmap...) and its read-ahead window
+struct DiskCacheStream
+{
+  DWORD nextSector;
+  uint8_t readAhead;
+  uint32_t lastUse;
 };
 
 class DiskCache
@@ -59,14 +84,25 @@ class DiskCache
     DiskCache();
     DRESULT read(BYTE drv, BYTE* buff, DWORD sector, UINT count);
     DRESULT write(BYTE drv, const BYTE* buff, DWORD sector, UINT count);
+    DRESULT flush(BYTE drv);
     const DiskCacheStats & getStats() const;
     int getHitRate() const;
     void clear();
 
   private:
     DiskCacheStats stats;
-    uint32_t lastBlock;
+    uint32_t useCounter;
     DiskCacheBlock * blocks;
+    DiskCacheStream streams[DISK_CACHE_STREAMS_NUM];
+
+    DiskCacheBlock * findBlock(DWORD sector);
+    DiskCacheBlock * getFreeBlock(BYTE drv);
+    DRESULT loadBlock(BYTE drv, DiskCacheBlock * & block, DWORD sector);
+    DRESULT flushBlock(BYTE drv, DiskCacheBlock * block);
+    DRESULT flushOldestDirtyBlock(BYTE drv);
+    uint8_t getReadAhead(DWORD sector, UINT count);
+    void readAhead(BYTE drv, DWORD sector, uint8_t count);
+    bool isCacheable(DWORD sector, UINT count) const;
 };
 
 extern DiskCache diskCache;
@@ -73,6 +73,25 @@ class DMAFifo
       return fifo;
     }
 
+    // Restart the transfer at the beginning of the buffer, so that the next
+    // frame can be decoded in place. Returns the number of bytes received
+    // since the previous restart (modulo N)
+    uint32_t restart(uint32_t flags)
+    {
+#if defined(SIMU)
+      return 0;
+#else
+      stream->CR &= ~DMA_SxCR_EN;
+      while (stream->CR & DMA_SxCR_EN);
+      uint32_t count = N - stream->NDTR;
+      DMA_ClearFlag(stream, flags);
+      stream->NDTR = N;
+      stream->CR |= DMA_SxCR_EN;
+      ridx = 0;
+      return count;
+#endif
+    }
+
   protected:
     uint8_t fifo[N];
     DMA_Stream_TypeDef * stream;
@@ -34,6 +34,10 @@ extern const uint8_t * const fontsTable[1];
 extern BitmapBuffer * fontCache[2];
 void loadFontCache();
 
+#if !defined(BOOT)
+const uint8_t * getFontAtlas(const uint8_t * font);
+#endif
+
 #else
 
 extern const pm_uchar font_5x7[];
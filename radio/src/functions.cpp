@@ -366,7 +366,7 @@ void evalFunctions()
             if (CFN_PARAM(cfn)>=FUNC_RESET_PARAM_FIRST_TELEM) {
               uint8_t item = CFN_PARAM(cfn)-FUNC_RESET_PARAM_FIRST_TELEM;
               if (item < MAX_TELEMETRY_SENSORS) {
-                telemetryItems[item].clear();
+                requestTelemetryItemReset(item);
               }
             }
 #endif
@@ -571,7 +571,11 @@ void evalFunctions()
           case FUNC_LOGS:
             if (CFN_PARAM(cfn)) {
               newActiveFunctions |= (1 << FUNCTION_LOGS);
-              logDelay = CFN_PARAM(cfn);
+#if defined(LOGS_BINARY)
+              logDelay = (CFN_PARAM(cfn) == LOGS_FAST_PARAM) ? LOGS_FAST_DELAY : CFN_PARAM(cfn) * 10;
+#else
+              logDelay = CFN_PARAM(cfn) * 10;
+#endif
             }
             break;
 #endif
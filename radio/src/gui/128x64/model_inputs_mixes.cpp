@@ -28,7 +28,7 @@ int expoFn(int x)
   ExpoData *ed = expoAddress(s_currIdx);
   int16_t anas[NUM_INPUTS] = {0};
   anas[ed->chn] = x;
-  applyExpos(anas, e_perout_mode_inactive_flight_mode);
+  applyExposPreview(anas, e_perout_mode_inactive_flight_mode);
   return anas[ed->chn];
 }
 
@@ -607,8 +607,10 @@ void menuRadioSetup(event_t event)
         }
         else if (reusableBuffer.generalSettings.stickMode != g_eeGeneral.stickMode) {
           pausePulses();
+          pauseMixerCalculations();
           g_eeGeneral.stickMode = reusableBuffer.generalSettings.stickMode;
           checkTHR();
+          resumeMixerCalculations();
           resumePulses();
           clearKeyEvents();
         }
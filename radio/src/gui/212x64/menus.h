@@ -56,6 +56,9 @@ void menuStatisticsView(event_t event);
 void menuStatisticsDebug(event_t event);
 void menuStatisticsDebug2(event_t event);
 void menuAboutView(event_t event);
+#if defined(LUA_PROFILER)
+void menuStatisticsLua(event_t event);
+#endif
 #if defined(DEBUG_TRACE_BUFFER)
 void menuTraceBuffer(event_t event);
 #endif
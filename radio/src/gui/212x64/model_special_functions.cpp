@@ -324,6 +324,14 @@ void menuSpecialFunctions(event_t event, CustomFunctionData * functions, CustomF
             }
           }
           else if (func == FUNC_LOGS) {
+#if defined(LOGS_BINARY)
+            val_min = LOGS_FAST_PARAM;
+            if (val_displayed == LOGS_FAST_PARAM) {
+              lcdDrawNumber(MODEL_SPECIAL_FUNC_3RD_COLUMN, y, LOGS_FAST_DELAY, attr|PREC2|LEFT);
+              lcdDrawChar(lcdLastRightPos, y, 's');
+            }
+            else
+#endif
             if (val_displayed) {
               lcdDrawNumber(MODEL_SPECIAL_FUNC_3RD_COLUMN, y, val_displayed, attr|PREC1|LEFT);
               lcdDrawChar(lcdLastRightPos, y, 's');
@@ -41,6 +41,8 @@ void menuStatisticsView(event_t event)
       killEvents(event);
 #if defined(DEBUG_TRACE_BUFFER)
       chainMenu(menuTraceBuffer);
+#elif defined(LUA_PROFILER)
+      chainMenu(menuStatisticsLua);
 #else
       chainMenu(menuStatisticsDebug2);
 #endif
@@ -209,7 +211,9 @@ void menuStatisticsDebug2(event_t event)
 
     case EVT_KEY_FIRST(KEY_UP):
     case EVT_KEY_BREAK(KEY_PAGE):
-#if defined(DEBUG_TRACE_BUFFER)
+#if defined(LUA_PROFILER)
+      chainMenu(menuStatisticsLua);
+#elif defined(DEBUG_TRACE_BUFFER)
       chainMenu(menuTraceBuffer);
 #else
       chainMenu(menuStatisticsView);
@@ -241,6 +245,90 @@ void menuStatisticsDebug2(event_t event)
   lcdInvertLastLine();
 }
 
+#if defined(LUA_PROFILER)
+#define MENU_LUA_AVG_POS      (17*FW)
+#define MENU_LUA_MAX_POS      (23*FW)
+#define MENU_LUA_INSTR_POS    (29*FW)
+#define MENU_LUA_ROWS         (LCD_LINES-3)
+
+void menuStatisticsLua(event_t event)
+{
+  TITLE("LUA PROFILER");
+
+  switch(event)
+  {
+    case EVT_KEY_FIRST(KEY_UP):
+    case EVT_KEY_BREAK(KEY_PAGE):
+#if defined(DEBUG_TRACE_BUFFER)
+      chainMenu(menuTraceBuffer);
+#else
+      chainMenu(menuStatisticsView);
+#endif
+      return;
+
+    case EVT_KEY_FIRST(KEY_DOWN):
+    case EVT_KEY_LONG(KEY_PAGE):
+      killEvents(event);
+      chainMenu(menuStatisticsDebug2);
+      break;
+
+    case EVT_KEY_FIRST(KEY_EXIT):
+      chainMenu(menuMainView);
+      break;
+
+    case EVT_KEY_BREAK(KEY_ENTER):
+      luaProfileFunctions = !luaProfileFunctions;
+      break;
+
+    case EVT_KEY_LONG(KEY_ENTER):
+      luaProfilerReset();
+      killEvents(event);
+      break;
+
+    case EVT_KEY_BREAK(KEY_MENU):
+      // full report, with the functions, to the debug output
+      luaProfilerTrace();
+      break;
+  }
+
+  if (luaProfileFunctions) {
+    lcdDrawText(LCD_W, 0, "FUNC", RIGHT|INVERS);
+  }
+
+  lcdDrawText(0, FH+1, "Script", SMLSIZE);
+  lcdDrawText(MENU_LUA_AVG_POS, FH+1, "Avg", SMLSIZE|RIGHT);
+  lcdDrawText(MENU_LUA_MAX_POS, FH+1, "Max", SMLSIZE|RIGHT);
+  lcdDrawText(MENU_LUA_INSTR_POS, FH+1, "Instr", SMLSIZE|RIGHT);
+  lcdDrawText(LCD_W, FH+1, "Alloc", SMLSIZE|RIGHT);
+
+  // the scripts which used the most CPU time, per run values
+  uint32_t shown = 0;
+  for (uint8_t row=0; row<MENU_LUA_ROWS; row++) {
+    uint8_t best = LUA_PROFILER_NONE;
+    for (uint8_t i=0; i<luaScriptProfilesCount; i++) {
+      if (!(shown & (1 << i)) && luaScriptProfiles[i].runs && (best == LUA_PROFILER_NONE || luaScriptProfiles[i].time > luaScriptProfiles[best].time)) {
+        best = i;
+      }
+    }
+    if (best == LUA_PROFILER_NONE) {
+      break;
+    }
+    shown |= (1 << best);
+    const LuaScriptProfile & profile = luaScriptProfiles[best];
+    coord_t y = (row+2)*FH+1;
+    lcdDrawChar(0, y, profile.kind);
+    lcdDrawText(FW+FW/2, y, profile.name);
+    lcdDrawNumber(MENU_LUA_AVG_POS, y, profile.time / profile.runs, RIGHT);
+    lcdDrawNumber(MENU_LUA_MAX_POS, y, profile.maxTime, RIGHT);
+    lcdDrawNumber(MENU_LUA_INSTR_POS, y, profile.instructions / profile.runs, RIGHT);
+    lcdDrawNumber(LCD_W, y, profile.allocated / profile.runs, RIGHT);
+  }
+
+  lcdDrawText(3*FW, 7*FH+1, STR_MENUTORESET);
+  lcdInvertLastLine();
+}
+#endif
+
 #if defined(DEBUG_TRACE_BUFFER)
 void menuTraceBuffer(event_t event)
 {
@@ -254,7 +342,11 @@ void menuTraceBuffer(event_t event)
     case EVT_KEY_FIRST(KEY_DOWN):
     case EVT_KEY_LONG(KEY_PAGE):
       killEvents(event);
+#if defined(LUA_PROFILER)
+      chainMenu(menuStatisticsLua);
+#else
       chainMenu(menuStatisticsDebug2);
+#endif
       break;
 
     case EVT_KEY_FIRST(KEY_UP):
@@ -305,12 +305,32 @@ uint8_t BitmapBuffer::drawCharWithCache(coord_t x, coord_t y, const BitmapBuffer
   return width;
 }
 
+void BitmapBuffer::drawFontAtlas(coord_t x, coord_t y, const uint8_t * atlas, const uint8_t * font, LcdFlags flags, coord_t offset, coord_t width)
+{
+  coord_t fontw = *((uint16_t *)font);
+  coord_t fonth = *(((uint16_t *)font)+1);
+
+  if (!data || x < 0 || x >= this->width || y < 0 || y >= this->height) {
+    // partially visible glyphs
+    drawBitmapPattern(x, y, font, flags, offset, width);
+    return;
+  }
+
+  if (x+width > this->width) {
+    width = this->width-x;
+  }
+
+  coord_t h = (y+fonth > this->height) ? this->height-y : fonth;
+  DMACopyAlphaMask(data, this->width, this->height, x, y, atlas, fontw, fonth, offset, 0, width, h, lcdColorTable[COLOR_IDX(flags)]);
+}
+
 void BitmapBuffer::drawSizedText(coord_t x, coord_t y, const char * s, uint8_t len, LcdFlags flags)
 {
 #define INCREMENT_POS(delta) \
   do { if (flags & VERTICAL) y -= delta; else x += delta; } while(0)
 
-  int width = getTextWidth(s, len, flags);
+  // the width is only needed for the alignment and the inverted background
+  int width = (flags & (RIGHT | CENTERED | INVERS)) ? getTextWidth(s, len, flags) : 0;
   int height = getFontHeight(flags);
   uint32_t fontindex = FONTINDEX(flags);
   const pm_uchar * font = fontsTable[fontindex];
@@ -376,6 +396,25 @@ void BitmapBuffer::drawSizedText(coord_t x, coord_t y, const char * s, uint8_t l
     }
   }
 
+#if !defined(BOOT)
+  // glyphs without cache are blended from the font atlas, in one DMA transfer per run of
+  // glyphs which are contiguous both in the font and on the screen
+  const uint8_t * atlas = (fontcache || (flags & VERTICAL)) ? NULL : getFontAtlas(font);
+#else
+  const uint8_t * atlas = NULL;
+#endif
+  coord_t runX = 0, runY = 0, runOffset = 0, runWidth = 0;
+#define FLUSH_RUN() \
+  do { \
+    if (runWidth > 0) { \
+      if (fontcache) \
+        drawBitmap(runX, runY, fontcache, runOffset, 0, runWidth); \
+      else \
+        drawFontAtlas(runX, runY, atlas, font, flags, runOffset, runWidth); \
+      runWidth = 0; \
+    } \
+  } while(0)
+
   bool setpos = false;
   const coord_t orig_pos = pos;
   while (len--) {
@@ -393,7 +432,22 @@ void BitmapBuffer::drawSizedText(coord_t x, coord_t y, const char * s, uint8_t l
     }
     else if (c >= 0x20) {
       uint8_t width;
-      if (fontcache)
+      if ((fontcache || atlas) && !(flags & VERTICAL)) {
+        int index = getMappedChar(c);
+        coord_t offset = fontspecs[index];
+        width = fontspecs[index+1] - offset;
+        if (runWidth > 0 && runX >= 0 && offset == runOffset + runWidth && x-1 == runX + runWidth && y == runY) {
+          runWidth += width;
+        }
+        else if (width > 0) {
+          FLUSH_RUN();
+          runX = x-1;
+          runY = y;
+          runOffset = offset;
+          runWidth = width;
+        }
+      }
+      else if (fontcache)
         width = drawCharWithCache(x-1, y, fontcache, fontspecs, getMappedChar(c), flags);
       else
         width = drawCharWithoutCache(x-1, y, font, fontspecs, getMappedChar(c), flags);
@@ -417,6 +471,8 @@ void BitmapBuffer::drawSizedText(coord_t x, coord_t y, const char * s, uint8_t l
     }
     s++;
   }
+  FLUSH_RUN();
+#undef FLUSH_RUN
   lcdNextPos = pos;
 }
 
@@ -245,6 +245,8 @@ class BitmapBuffer: public BitmapBufferBase<uint16_t>
 
     uint8_t drawCharWithCache(coord_t x, coord_t y, const BitmapBuffer * font, const uint16_t * spec, int index, LcdFlags flags);
 
+    void drawFontAtlas(coord_t x, coord_t y, const uint8_t * atlas, const uint8_t * font, LcdFlags flags, coord_t offset, coord_t width);
+
     void drawText(coord_t x, coord_t y, const char * s, LcdFlags flags)
     {
       drawSizedText(x, y, s, 255, flags);
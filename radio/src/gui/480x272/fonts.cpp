@@ -117,3 +117,58 @@ void loadFontCache()
   fontCache[0] = createFontCache(fontsTable[0], TEXT_COLOR, TEXT_BGCOLOR);
   fontCache[1] = createFontCache(fontsTable[0], TEXT_INVERTED_COLOR, TEXT_INVERTED_BGCOLOR);
 }
+
+#if !defined(BOOT)
+struct FontAtlas {
+  const uint8_t * font;
+  uint8_t * mask;
+};
+
+static FontAtlas fontAtlases[8];
+
+/*
+  @fn getFontAtlas(const uint8_t * font)
+
+  The glyphs of a font as an 8 bits alpha mask, in the frame buffer orientation,
+  so that they can be blended in any color by DMACopyAlphaMask(). Built on first use.
+
+  @retval the mask, or NULL if there is not enough memory
+*/
+const uint8_t * getFontAtlas(const uint8_t * font)
+{
+  FontAtlas * atlas = NULL;
+  for (unsigned int i=0; i<DIM(fontAtlases); i++) {
+    if (fontAtlases[i].font == font) {
+      return fontAtlases[i].mask;
+    }
+    else if (!atlas && !fontAtlases[i].font) {
+      atlas = &fontAtlases[i];
+    }
+  }
+
+  if (!atlas) {
+    return NULL;
+  }
+
+  coord_t width = *((uint16_t *)font);
+  coord_t height = *(((uint16_t *)font)+1);
+
+  atlas->font = font;
+  atlas->mask = (uint8_t *)malloc(width * height);
+  if (atlas->mask) {
+    const uint8_t * q = font + 4;
+    for (int i=0; i<width*height; i++) {
+#if defined(PCBX10) && !defined(SIMU)
+      atlas->mask[width*height-1-i] = q[i] * 0xFF / OPACITY_MAX;
+#else
+      atlas->mask[i] = q[i] * 0xFF / OPACITY_MAX;
+#endif
+    }
+  }
+  else {
+    TRACE_ERROR("getFontAtlas(): not enough memory");
+  }
+
+  return atlas->mask;
+}
+#endif
@@ -20,6 +20,65 @@
 
 #include "opentx.h"
 
+// the screen as drawn by the layout below the widgets, shared by all the custom screens
+static BitmapBuffer * backdrop = NULL;
+
+void Layout::refresh()
+{
+  if (storeBackdrop) {
+    backdrop->drawBitmap(0, 0, lcd);
+  }
+  WidgetsContainer<MAX_LAYOUT_ZONES, MAX_LAYOUT_OPTIONS>::refresh();
+}
+
+void Layout::paint()
+{
+  if (!backdrop) {
+    backdrop = new BitmapBuffer(BMP_RGB565, LCD_W, LCD_H);
+    if (backdrop && !backdrop->getData()) {
+      delete backdrop;
+      backdrop = NULL;
+    }
+  }
+
+  uint32_t hash = getDecorationsHash();
+  if (!backdrop || hash != decorationsHash || lcdRefreshCount != lastRefreshCount + 1) {
+    // a menu was drawn in the frame buffers since our last frame
+    fullFrames = LCD_FRAME_BUFFERS;
+  }
+  decorationsHash = hash;
+  lastRefreshCount = lcdRefreshCount;
+
+  if (fullFrames > 0) {
+    fullFrames--;
+    storeBackdrop = (backdrop != NULL);
+    refresh();
+    storeBackdrop = false;
+    // start the damage tracking from what has just been drawn
+    for (int i=0; widgets && i<MAX_LAYOUT_ZONES; i++) {
+      if (widgets[i]) {
+        widgets[i]->isDirty();
+      }
+    }
+    return;
+  }
+
+  if (hasTopbar()) {
+    // the top bar background may be transparent
+    lcd->drawBitmap(0, 0, backdrop, 0, 0, LCD_W, MENU_HEADER_HEIGHT);
+    drawTopBar();
+  }
+
+  for (int i=0; widgets && i<MAX_LAYOUT_ZONES; i++) {
+    Widget * widget = widgets[i];
+    if (widget && widget->isDirty()) {
+      const Zone & zone = widget->getZone();
+      lcd->drawBitmap(zone.x, zone.y, backdrop, zone.x, zone.y, zone.w, zone.h);
+      widget->refresh();
+    }
+  }
+}
+
 std::list<const LayoutFactory *> & getRegisteredLayouts()
 {
   static std::list<const LayoutFactory *> layouts;
@@ -68,3 +127,12 @@ void loadCustomScreens()
 
   topbar->load();
 }
+
+void invalidateCustomScreens()
+{
+  for (unsigned int i=0; i<MAX_CUSTOM_SCREENS; i++) {
+    if (customScreens[i]) {
+      customScreens[i]->invalidate();
+    }
+  }
+}
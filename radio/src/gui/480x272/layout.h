@@ -37,7 +37,11 @@ class Layout: public WidgetsContainer<MAX_LAYOUT_ZONES, MAX_LAYOUT_OPTIONS>
   public:
     Layout(const LayoutFactory * factory, PersistentData * persistentData):
       WidgetsContainer<MAX_LAYOUT_ZONES, MAX_LAYOUT_OPTIONS>(persistentData),
-      factory(factory)
+      factory(factory),
+      decorationsHash(0),
+      lastRefreshCount(0),
+      fullFrames(LCD_FRAME_BUFFERS),
+      storeBackdrop(false)
     {
     }
 
@@ -50,8 +54,36 @@ class Layout: public WidgetsContainer<MAX_LAYOUT_ZONES, MAX_LAYOUT_OPTIONS>
     {
     }
 
+    // layouts draw the background, the top bar and their decorations, then call Layout::refresh() for the widgets
+    virtual void refresh();
+
+    // refresh() for the main view, only the dirty widgets are redrawn when possible
+    void paint();
+
+    // the next frames are fully redrawn, something else was drawn in the frame buffers
+    void invalidate()
+    {
+      fullFrames = LCD_FRAME_BUFFERS;
+    }
+
   protected:
     const LayoutFactory * factory;
+    uint32_t decorationsHash;
+    uint32_t lastRefreshCount;
+    uint8_t fullFrames;
+    bool storeBackdrop;
+
+    // the top bar is the first option of all layouts
+    virtual bool hasTopbar() const
+    {
+      return persistentData->options[0].boolValue;
+    }
+
+    // hash of everything the layout draws over the background, a change means a full redraw
+    virtual uint32_t getDecorationsHash() const
+    {
+      return 0;
+    }
 };
 
 void registerLayout(const LayoutFactory * factory);
@@ -120,6 +152,7 @@ class BaseLayoutFactory: public LayoutFactory
 
 Layout * loadLayout(const char * name, Layout::PersistentData * persistentData);
 void loadCustomScreens();
+void invalidateCustomScreens();
 
 std::list<const LayoutFactory *> & getRegisteredLayouts();
 
@@ -66,6 +66,12 @@ class Layout1x1: public Layout
     }
 
     virtual void refresh();
+
+  protected:
+    virtual uint32_t getDecorationsHash() const
+    {
+      return persistentData->options[1].boolValue ? getMainViewDecorationsHash(true, true, true) : 0;
+    }
 };
 
 void Layout1x1::refresh()
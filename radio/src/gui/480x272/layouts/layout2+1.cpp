@@ -66,6 +66,12 @@ class Layout2P1: public Layout
     }
 
     virtual void refresh();
+
+  protected:
+    virtual uint32_t getDecorationsHash() const
+    {
+      return getMainViewDecorationsHash(persistentData->options[1].boolValue, persistentData->options[2].boolValue, persistentData->options[3].boolValue);
+    }
 };
 
 void Layout2P1::refresh()
@@ -73,6 +73,12 @@ class Layout2x4: public Layout
     }
 
     virtual void refresh();
+
+  protected:
+    virtual uint32_t getDecorationsHash() const
+    {
+      return getMainViewDecorationsHash(persistentData->options[1].boolValue, persistentData->options[2].boolValue, persistentData->options[3].boolValue);
+    }
 };
 
 void Layout2x4::refresh()
@@ -30,6 +30,7 @@ display_t displayBuf[DISPLAY_BUFFER_SIZE];
 uint16_t lcdColorTable[LCD_COLOR_COUNT];
 
 coord_t lcdNextPos;
+uint32_t lcdRefreshCount = 0;
 
 uint8_t getMappedChar(uint8_t c)
 {
@@ -465,6 +466,38 @@ void DMACopyAlphaBitmap(uint16_t * dest, uint16_t destw, uint16_t desth, uint16_
   }
 }
 
+void DMACopyAlphaMask(uint16_t * dest, uint16_t destw, uint16_t desth, uint16_t x, uint16_t y, const uint8_t * src, uint16_t srcw, uint16_t srch, uint16_t srcx, uint16_t srcy, uint16_t w, uint16_t h, uint16_t color)
+{
+#if defined(PCBX10) && !defined(SIMU)
+  x = destw - (x + w);
+  y = desth - (y + h);
+  srcx = srcw - (srcx + w);
+  srcy = srch - (srcy + h);
+#endif
+
+  RGB_SPLIT(color, red, green, blue);
+
+  for (coord_t line=0; line<h; line++) {
+    uint16_t * p = dest + (y+line)*destw + x;
+    const uint8_t * q = src + (srcy+line)*srcw + srcx;
+    for (coord_t col=0; col<w; col++) {
+      uint8_t opacity = *q * OPACITY_MAX / 0xFF;
+      if (opacity == OPACITY_MAX) {
+        *p = color;
+      }
+      else if (opacity != 0) {
+        uint8_t bgWeight = OPACITY_MAX - opacity;
+        RGB_SPLIT(*p, bgRed, bgGreen, bgBlue);
+        uint16_t r = (bgRed * bgWeight + red * opacity) / OPACITY_MAX;
+        uint16_t g = (bgGreen * bgWeight + green * opacity) / OPACITY_MAX;
+        uint16_t b = (bgBlue * bgWeight + blue * opacity) / OPACITY_MAX;
+        *p = RGB_JOIN(r, g, b);
+      }
+      p++; q++;
+    }
+  }
+}
+
 void DMABitmapConvert(uint16_t * dest, const uint8_t * src, uint16_t w, uint16_t h, uint32_t format)
 {
   if (format == DMA2D_ARGB4444) {
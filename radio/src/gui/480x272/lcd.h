@@ -113,6 +113,15 @@ extern display_t displayBuf[DISPLAY_BUFFER_SIZE];
 #define displayBuf                     lcd->getData()
 #endif
 
+// frame buffers drawn in turn, an incremental redraw has to replay the changes of the previous frames
+#if defined(SIMU)
+  #define LCD_FRAME_BUFFERS            1
+#else
+  #define LCD_FRAME_BUFFERS            2
+#endif
+
+extern uint32_t lcdRefreshCount;  // incremented by lcdRefresh() on each frame
+
 #define DISPLAY_END                    (displayBuf + DISPLAY_BUFFER_SIZE)
 #define ASSERT_IN_DISPLAY(p)           assert((p) >= displayBuf && (p) < DISPLAY_END)
 
@@ -151,6 +151,9 @@ const uint8_t STATS_ICONS[] = {
   ICON_STATS_THROTTLE_GRAPH,
   ICON_STATS_DEBUG,
   ICON_STATS_ANALOGS,
+#if defined(LUA_PROFILER)
+  ICON_STATS_DEBUG,
+#endif
 #if defined(DEBUG_TRACE_BUFFER)
   ICON_STATS_TIMERS
 #endif
@@ -208,6 +211,9 @@ enum MenuRadioIndexes
   e_StatsGraph,
   e_StatsDebug,
   e_StatsAnalogs,
+#if defined(LUA_PROFILER)
+  e_StatsLua,
+#endif
 #if defined(DEBUG_TRACE_BUFFER)
   e_StatsTraces,
 #endif
@@ -216,12 +222,16 @@ enum MenuRadioIndexes
 bool menuStatsGraph(event_t event);
 bool menuStatsDebug(event_t event);
 bool menuStatsAnalogs(event_t event);
+bool menuStatsLua(event_t event);
 bool menuStatsTraces(event_t event);
 
 static const MenuHandlerFunc menuTabStats[] PROGMEM = {
   menuStatsGraph,
   menuStatsDebug,
   menuStatsAnalogs,
+#if defined(LUA_PROFILER)
+  menuStatsLua,
+#endif
 #if defined(DEBUG_TRACE_BUFFER)
   menuStatsTraces,
 #endif
@@ -487,8 +487,10 @@ bool menuRadioSetup(event_t event)
         }
         else if (reusableBuffer.generalSettings.stickMode != g_eeGeneral.stickMode) {
           pausePulses();
+          pauseMixerCalculations();
           g_eeGeneral.stickMode = reusableBuffer.generalSettings.stickMode;
           checkTHR();
+          resumeMixerCalculations();
           resumePulses();
           clearKeyEvents();
         }
@@ -28,6 +28,7 @@
 #define TRIM_H_Y                       (LCD_H-37)
 #define TRIM_LEN                       80
 #define POTS_LINE_Y                    (LCD_H-20)
+#define SLIDER_STEP                    (2*RESX/160)  // one pixel on the 160 pixels sliders
 
 Layout * customScreens[MAX_CUSTOM_SCREENS] = { 0, 0, 0, 0, 0 };
 Topbar * topbar;
@@ -86,6 +87,36 @@ void drawTrims(uint8_t flightMode)
   }
 }
 
+// what the flight mode name, the pots and the trims drawn by the layouts depend on
+uint32_t getMainViewDecorationsHash(bool flightMode, bool pots, bool trims)
+{
+  int32_t state[10];
+  memclear(state, sizeof(state));
+
+  if (flightMode) {
+    state[0] = MathUtil::hash(g_model.flightModeData[mixerCurrentFlightMode].name, sizeof(g_model.flightModeData[mixerCurrentFlightMode].name));
+  }
+
+  if (pots) {
+    state[1] = calibratedAnalogs[CALIBRATED_POT1] / SLIDER_STEP;
+    state[2] = potsPos[1] & 0x0f;
+#if defined(PCBHORUS)
+    state[3] = calibratedAnalogs[CALIBRATED_POT3] / SLIDER_STEP;
+    state[4] = calibratedAnalogs[CALIBRATED_SLIDER_REAR_LEFT] / SLIDER_STEP;
+    state[5] = calibratedAnalogs[CALIBRATED_SLIDER_REAR_RIGHT] / SLIDER_STEP;
+#endif
+  }
+
+  if (trims) {
+    for (uint8_t i=0; i<4; i++) {
+      bool displayed = (trimsDisplayTimer > 0 && (trimsDisplayMask & (1<<i)));
+      state[6+i] = getTrimValue(mixerCurrentFlightMode, i) * 2 + displayed;
+    }
+  }
+
+  return MathUtil::hash(state, sizeof(state));
+}
+
 void onMainViewMenu(const char *result)
 {
   if (result == STR_MODEL_SELECT) {
@@ -211,7 +242,7 @@ bool menuMainView(event_t event)
   for (uint8_t i=0; i<MAX_CUSTOM_SCREENS; i++) {
     if (customScreens[i]) {
       if (i == g_model.view)
-        customScreens[i]->refresh();
+        customScreens[i]->paint();
       else
         customScreens[i]->background();
     }
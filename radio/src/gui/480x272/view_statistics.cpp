@@ -121,12 +121,26 @@ bool menuStatsDebug(event_t event)
   lcdDrawNumber(lcdNextPos+5, MENU_CONTENT_TOP+2*FH, mixerStack.available(), LEFT);
   lcdDrawText(lcdNextPos+20, MENU_CONTENT_TOP+2*FH+1, "[Audio]", HEADER_COLOR|SMLSIZE);
   lcdDrawNumber(lcdNextPos+5, MENU_CONTENT_TOP+2*FH, audioStack.available(), LEFT);
+  lcdDrawText(lcdNextPos+20, MENU_CONTENT_TOP+2*FH+1, "[Tele]", HEADER_COLOR|SMLSIZE);
+  lcdDrawNumber(lcdNextPos+5, MENU_CONTENT_TOP+2*FH, telemetryStack.available(), LEFT);
+#if defined(STORAGE_TASK)
+  lcdDrawText(lcdNextPos+20, MENU_CONTENT_TOP+2*FH+1, "[Stor]", HEADER_COLOR|SMLSIZE);
+  lcdDrawNumber(lcdNextPos+5, MENU_CONTENT_TOP+2*FH, storageStack.available(), LEFT);
+#endif
 
   int line = 3;
 
 #if defined(DISK_CACHE)
   lcdDrawText(MENUS_MARGIN_LEFT, MENU_CONTENT_TOP+line*FH, "SD cache hits");
   lcdDrawNumber(MENU_STATS_COLUMN1, MENU_CONTENT_TOP+line*FH, diskCache.getHitRate(), PREC1|LEFT, 0, NULL, "%");
+  lcdDrawText(lcdNextPos+20, MENU_CONTENT_TOP+line*FH+1, "[M]", HEADER_COLOR|SMLSIZE);
+  lcdDrawNumber(lcdNextPos+5, MENU_CONTENT_TOP+line*FH, diskCache.getStats().noMisses, LEFT);
+  lcdDrawText(lcdNextPos+20, MENU_CONTENT_TOP+line*FH+1, "[E]", HEADER_COLOR|SMLSIZE);
+  lcdDrawNumber(lcdNextPos+5, MENU_CONTENT_TOP+line*FH, diskCache.getStats().noEvictions, LEFT);
+  lcdDrawText(lcdNextPos+20, MENU_CONTENT_TOP+line*FH+1, "[RA]", HEADER_COLOR|SMLSIZE);
+  lcdDrawNumber(lcdNextPos+5, MENU_CONTENT_TOP+line*FH, diskCache.getStats().noReadAheads, LEFT);
+  lcdDrawText(lcdNextPos+20, MENU_CONTENT_TOP+line*FH+1, "[WB]", HEADER_COLOR|SMLSIZE);
+  lcdDrawNumber(lcdNextPos+5, MENU_CONTENT_TOP+line*FH, diskCache.getStats().noWriteBacks, LEFT);
   ++line;
 #endif
 
@@ -190,6 +204,69 @@ bool menuStatsAnalogs(event_t event)
   return true;
 }
 
+#if defined(LUA_PROFILER)
+#define STATS_LUA_NAME_POS             MENUS_MARGIN_LEFT + 20
+#define STATS_LUA_AVG_POS              MENUS_MARGIN_LEFT + 21*10
+#define STATS_LUA_MAX_POS              MENUS_MARGIN_LEFT + 27*10
+#define STATS_LUA_INSTR_POS            MENUS_MARGIN_LEFT + 33*10
+#define STATS_LUA_ALLOC_POS            MENUS_MARGIN_LEFT + 39*10
+#define STATS_LUA_FREED_POS            LCD_W - MENUS_MARGIN_LEFT
+
+bool menuStatsLua(event_t event)
+{
+  switch(event)
+  {
+    case EVT_KEY_BREAK(KEY_ENTER):
+      luaProfileFunctions = !luaProfileFunctions;
+      break;
+
+    case EVT_KEY_LONG(KEY_ENTER):
+      luaProfilerReset();
+      killEvents(event);
+      break;
+  }
+
+  SIMPLE_MENU("", STATS_ICONS, menuTabStats, e_StatsLua, 1);
+
+  lcdDrawText(MENUS_MARGIN_LEFT, MENU_TITLE_TOP+2, "Script", MENU_TITLE_COLOR);
+  lcdDrawText(STATS_LUA_AVG_POS, MENU_TITLE_TOP+2, "Avg us", MENU_TITLE_COLOR|RIGHT);
+  lcdDrawText(STATS_LUA_MAX_POS, MENU_TITLE_TOP+2, "Max us", MENU_TITLE_COLOR|RIGHT);
+  lcdDrawText(STATS_LUA_INSTR_POS, MENU_TITLE_TOP+2, "Instr", MENU_TITLE_COLOR|RIGHT);
+  lcdDrawText(STATS_LUA_ALLOC_POS, MENU_TITLE_TOP+2, "Alloc", MENU_TITLE_COLOR|RIGHT);
+  lcdDrawText(STATS_LUA_FREED_POS, MENU_TITLE_TOP+2, "Freed", MENU_TITLE_COLOR|RIGHT);
+
+  // the scripts which used the most CPU time, per run values
+  uint32_t shown = 0;
+  for (uint8_t i=0; i<NUM_BODY_LINES; i++) {
+    uint8_t best = LUA_PROFILER_NONE;
+    for (uint8_t j=0; j<luaScriptProfilesCount; j++) {
+      if (!(shown & (1 << j)) && luaScriptProfiles[j].runs && (best == LUA_PROFILER_NONE || luaScriptProfiles[j].time > luaScriptProfiles[best].time)) {
+        best = j;
+      }
+    }
+    if (best == LUA_PROFILER_NONE) {
+      break;
+    }
+    shown |= (1 << best);
+    const LuaScriptProfile & profile = luaScriptProfiles[best];
+    coord_t y = MENU_CONTENT_TOP + i * FH;
+    lcdDrawChar(MENUS_MARGIN_LEFT, y, profile.kind, HEADER_COLOR);
+    lcdDrawText(STATS_LUA_NAME_POS, y, profile.name);
+    lcdDrawNumber(STATS_LUA_AVG_POS, y, profile.time / profile.runs, RIGHT);
+    lcdDrawNumber(STATS_LUA_MAX_POS, y, profile.maxTime, RIGHT);
+    lcdDrawNumber(STATS_LUA_INSTR_POS, y, profile.instructions / profile.runs, RIGHT);
+    lcdDrawNumber(STATS_LUA_ALLOC_POS, y, profile.allocated / profile.runs, RIGHT);
+    lcdDrawNumber(STATS_LUA_FREED_POS, y, profile.freed / profile.runs, RIGHT);
+  }
+
+  if (luaProfileFunctions) {
+    // the functions are only reported by the 'luaprof' CLI command
+    lcdDrawText(MENUS_MARGIN_LEFT, MENU_FOOTER_TOP, "Functions", MENU_TITLE_COLOR);
+  }
+  lcdDrawText(LCD_W/2, MENU_FOOTER_TOP, STR_MENUTORESET, MENU_TITLE_COLOR | CENTERED);
+  return true;
+}
+#endif
 
 #if defined(DEBUG_TRACE_BUFFER)
 #define STATS_TRACES_INDEX_POS         MENUS_MARGIN_LEFT
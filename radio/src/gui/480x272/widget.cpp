@@ -20,6 +20,23 @@
 
 #include "opentx.h"
 
+void Widget::invalidate()
+{
+  dirtyFrames = LCD_FRAME_BUFFERS;
+}
+
+bool Widget::isDirty()
+{
+  if (hasChanged()) {
+    invalidate();
+  }
+  if (dirtyFrames > 0) {
+    dirtyFrames--;
+    return true;
+  }
+  return false;
+}
+
 std::list<const WidgetFactory *> & getRegisteredWidgets()
 {
   static std::list<const WidgetFactory *> widgets;
@@ -37,8 +37,11 @@ class Widget
     Widget(const WidgetFactory * factory, const Zone & zone, PersistentData * persistentData):
       factory(factory),
       zone(zone),
-      persistentData(persistentData)
+      persistentData(persistentData),
+      refreshHash(0),
+      dirtyFrames(0)
     {
+      invalidate();
     }
 
     virtual ~Widget()
@@ -72,10 +75,38 @@ class Widget
     {
     }
 
+    inline const Zone & getZone() const
+    {
+      return zone;
+    }
+
+    // the zone has to be redrawn on the next frames, see Layout::paint()
+    void invalidate();
+
+    // true if the zone has to be redrawn on this frame, called once per frame
+    bool isDirty();
+
   protected:
     const WidgetFactory * factory;
     Zone zone;
     PersistentData * persistentData;
+    uint32_t refreshHash;
+    uint8_t dirtyFrames;
+
+    // true if refresh() would draw something different than the last time,
+    // widgets which can't tell are redrawn on each frame
+    virtual bool hasChanged()
+    {
+      return true;
+    }
+
+    // hasChanged() helper, hash is computed from everything refresh() depends on
+    bool hasHashChanged(uint32_t hash)
+    {
+      bool result = (hash != refreshHash);
+      refreshHash = hash;
+      return result;
+    }
 };
 
 void registerWidget(const WidgetFactory * factory);
@@ -77,5 +77,6 @@ void drawShutdownAnimation(uint32_t index, const char * message);
 void drawTopBar();
 void drawMainPots();
 void drawTrims(uint8_t flightMode);
+uint32_t getMainViewDecorationsHash(bool flightMode, bool pots, bool trims);
 
 #endif // _WIDGETS_H_
@@ -31,6 +31,13 @@ class GaugeWidget: public Widget
     virtual void refresh();
 
     static const ZoneOption options[];
+
+  protected:
+    virtual bool hasChanged()
+    {
+      getvalue_t value = getValue(persistentData->options[0].unsignedValue);
+      return hasHashChanged(MathUtil::hash(&value, sizeof(value)));
+    }
 };
 
 const ZoneOption GaugeWidget::options[] = {
@@ -33,6 +33,12 @@ class TextWidget: public Widget
     virtual void refresh();
 
     static const ZoneOption options[];
+
+  protected:
+    virtual bool hasChanged()
+    {
+      return false;
+    }
 };
 
 const ZoneOption TextWidget::options[] = {
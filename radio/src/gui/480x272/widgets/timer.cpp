@@ -31,6 +31,13 @@ class TimerWidget: public Widget
     virtual void refresh();
 
     static const ZoneOption options[];
+
+  protected:
+    virtual bool hasChanged()
+    {
+      const TimerState & timerState = timersStates[persistentData->options[0].unsignedValue];
+      return hasHashChanged(MathUtil::hash(&timerState.val, sizeof(timerState.val)));
+    }
 };
 
 const ZoneOption TimerWidget::options[] = {
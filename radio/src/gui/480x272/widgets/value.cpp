@@ -31,6 +31,9 @@ class ValueWidget: public Widget
     virtual void refresh();
 
     static const ZoneOption options[];
+
+  protected:
+    virtual bool hasChanged();
 };
 
 const ZoneOption ValueWidget::options[] = {
@@ -40,6 +43,23 @@ const ZoneOption ValueWidget::options[] = {
   { NULL, ZoneOption::Bool }
 };
 
+bool ValueWidget::hasChanged()
+{
+  mixsrc_t field = persistentData->options[0].unsignedValue;
+  int32_t state[2 + sizeof(TelemetryItem::text)/sizeof(int32_t)];
+  memclear(state, sizeof(state));
+  state[0] = getValue(field);
+
+  if (field >= MIXSRC_FIRST_TELEM) {
+    // GPS, date/time and text sensors are not displayed from their value only
+    TelemetryItem & telemetryItem = telemetryItems[(field-MIXSRC_FIRST_TELEM)/3];
+    state[1] = telemetryItem.isAvailable() + 2 * telemetryItem.isOld();
+    memcpy(&state[2], telemetryItem.text, sizeof(telemetryItem.text));
+  }
+
+  return hasHashChanged(MathUtil::hash(state, sizeof(state)));
+}
+
 void ValueWidget::refresh()
 {
   const int NUMBERS_PADDING = 4;
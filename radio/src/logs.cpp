@@ -20,12 +20,17 @@
 
 #include "opentx.h"
 #include "ff.h"
+#include "logs.h"
 
 FIL g_oLogFile __DMA;
 const pm_char * g_logError = NULL;
-uint8_t logDelay;
+uint16_t logDelay; // 10ms units
 
+#if defined(LOGS_BINARY)
+FRESULT writeBinaryHeader();
+#else
 void writeHeader();
+#endif
 
 #if defined(PCBTARANIS) || defined(PCBHORUS) || defined(PCBI8) || defined(PCBMT6S)
   #define GET_2POS_STATE(sw) (switchState(SW_ ## sw ## 0) ? -1 : 1)
@@ -104,18 +109,34 @@ const pm_char * logsOpen()
     return SDCARD_ERROR(result);
   }
 
+#if defined(LOGS_BINARY)
+  result = writeBinaryHeader();
+  if (result != FR_OK) {
+    f_close(&g_oLogFile);
+    g_oLogFile.obj.fs = 0;
+    return SDCARD_ERROR(result);
+  }
+#else
   if (f_size(&g_oLogFile) == 0) {
     writeHeader();
   }
+#endif
 
   return NULL;
 }
 
 tmr10ms_t lastLogTime = 0;
 
+#if defined(LOGS_BINARY)
+FRESULT logsFlush(bool close);
+#endif
+
 void logsClose()
 {
   if (sdMounted()) {
+#if defined(LOGS_BINARY)
+    logsFlush(true);
+#endif
     if (f_close(&g_oLogFile) != FR_OK) {
       // close failed, forget file
       g_oLogFile.obj.fs = 0;
@@ -212,13 +233,341 @@ uint32_t getLogicalSwitchesStates(uint8_t first)
   return result;
 }
 
+#if defined(LOGS_BINARY)
+#define LOGS_BINARY_BUFFER_SIZE    4096   // 8 sectors
+#define LOGS_MAX_COLUMNS           (MAX_TELEMETRY_SENSORS + NUM_STICKS + NUM_POTS + NUM_SLIDERS + NUM_SWITCHES + 2)
+
+#if defined(PCBXLITE)
+  #define LOGS_SWITCHES_NAMES      "SA,SB"
+#elif defined(PCBX7) || defined(PCBI8) || defined(PCBMT6S)
+  #define LOGS_SWITCHES_NAMES      "SA,SB,SC,SD,SF,SH"
+#elif defined(PCBTARANIS) || defined(PCBHORUS)
+  #define LOGS_SWITCHES_NAMES      "SA,SB,SC,SD,SE,SF,SG,SH"
+#else
+  #define LOGS_SWITCHES_NAMES      "THR,RUD,ELE,3POS,AIL,GEA,TRN"
+#endif
+
+// Records are taken by logsRecord() in the mixer task and written by
+// logsWrite() in the menus task: while a buffer is filled, the other one
+// waits to be written. The mixer task has the higher priority, it is never
+// interrupted by the menus task in the middle of a record.
+static uint8_t logsBuffers[2][LOGS_BINARY_BUFFER_SIZE] __DMA;
+static uint16_t logsBufferCount;        // bytes used in the buffer being filled
+static uint8_t logsBufferIndex;         // the buffer being filled
+static volatile bool logsBufferFull;    // the other buffer waits to be written
+static volatile bool logsRecording;
+
+static LogColumn logsColumns[LOGS_MAX_COLUMNS];
+static uint8_t logsColumnsCount;
+static uint16_t logsRecordSize;
+
+static LogColumn * addLogColumn(uint8_t type, uint8_t source, uint8_t index, uint8_t prec)
+{
+  LogColumn * column = &logsColumns[logsColumnsCount++];
+  memclear(column, sizeof(LogColumn));
+  column->type = type;
+  column->source = source;
+  column->index = index;
+  column->prec = prec;
+  return column;
+}
+
+static void setLogColumnName(LogColumn * column, const char * name, uint8_t len)
+{
+  for (uint8_t i=0; i<len && i<LOG_COLUMN_NAME_LEN && name[i]; i++) {
+    column->name[i] = name[i];
+  }
+}
+
+// The same columns, in the same order, as the CSV logs
+static void buildLogColumns()
+{
+  logsColumnsCount = 0;
+
+#if defined(TELEMETRY_FRSKY)
+  for (int i=0; i<MAX_TELEMETRY_SENSORS; i++) {
+    if (isTelemetryFieldAvailable(i)) {
+      TelemetrySensor & sensor = g_model.telemetrySensors[i];
+      if (sensor.logs) {
+        uint8_t type = (sensor.unit == UNIT_GPS ? LOG_COLUMN_GPS : (sensor.unit == UNIT_DATETIME ? LOG_COLUMN_DATETIME : LOG_COLUMN_VALUE));
+        LogColumn * column = addLogColumn(type, LOG_SOURCE_SENSOR, i, sensor.prec);
+        column->id = sensor.id;
+        column->instance = sensor.instance;
+        column->unit = sensor.unit;
+        zchar2str(column->name, sensor.label, TELEM_LABEL_LEN);
+        uint8_t unit = sensor.unit;
+        if (unit == UNIT_CELLS) unit = UNIT_VOLTS;
+        if (UNIT_RAW < unit && unit < UNIT_FIRST_VIRTUAL) {
+          strncpy(column->unitName, STR_VTELEMUNIT+1+3*unit, 3);
+        }
+      }
+    }
+  }
+#endif
+
+  for (uint8_t i=0; i<NUM_STICKS+NUM_POTS+NUM_SLIDERS; i++) {
+    LogColumn * column = addLogColumn(LOG_COLUMN_VALUE, LOG_SOURCE_ANALOG, i, 0);
+    setLogColumnName(column, STR_VSRCRAW + (i+1) * STR_VSRCRAW[0] + 2, STR_VSRCRAW[0]-1);
+  }
+
+  const char * names = LOGS_SWITCHES_NAMES;
+  for (uint8_t i=0; *names; i++) {
+    const char * end = strchr(names, ',');
+    uint8_t len = (end ? end - names : strlen(names));
+    LogColumn * column = addLogColumn(LOG_COLUMN_VALUE, LOG_SOURCE_SWITCH, i, 0);
+    setLogColumnName(column, names, len);
+    names += (end ? len + 1 : len);
+  }
+
+#if defined(PCBTARANIS) || defined(PCBHORUS) || defined(PCBI8) || defined(PCBMT6S)
+  setLogColumnName(addLogColumn(LOG_COLUMN_LOGICAL_SWITCHES, LOG_SOURCE_LOGICAL_SWITCHES, 0, 0), "LSW", 3);
+#endif
+
+  LogColumn * column = addLogColumn(LOG_COLUMN_VALUE, LOG_SOURCE_TX_VOLTAGE, 0, 1);
+  setLogColumnName(column, "TxBat", 5);
+  column->unit = UNIT_VOLTS;
+  column->unitName[0] = 'V';
+
+  logsRecordSize = sizeof(LogRecordHeader);
+  for (uint8_t i=0; i<logsColumnsCount; i++) {
+    logsRecordSize += getLogColumnValuesCount(logsColumns[i].type) * sizeof(int32_t);
+  }
+}
+
+static uint16_t alignOnSector(uint16_t size)
+{
+  return (size + LOGS_BINARY_SECTOR_SIZE - 1) & ~(LOGS_BINARY_SECTOR_SIZE - 1);
+}
+
+// Starts a new session at the end of the log file
+FRESULT writeBinaryHeader()
+{
+  UINT written;
+  FRESULT result;
+
+  logsRecording = false;
+
+  uint32_t size = f_size(&g_oLogFile);
+  if (size > 0) {
+    // the previous session may have been interrupted, a padding sector ends it
+    uint16_t padding = LOGS_BINARY_SECTOR_SIZE + (LOGS_BINARY_SECTOR_SIZE - size % LOGS_BINARY_SECTOR_SIZE) % LOGS_BINARY_SECTOR_SIZE;
+    memset(logsBuffers[0], 0xFF, padding);
+    result = f_write(&g_oLogFile, logsBuffers[0], padding, &written);
+    if (result != FR_OK) {
+      return result;
+    }
+  }
+
+  buildLogColumns();
+
+  uint16_t headerSize = alignOnSector(sizeof(LogFileHeader) + logsColumnsCount * sizeof(LogColumn));
+  memclear(logsBuffers[0], headerSize);
+  LogFileHeader * header = (LogFileHeader *)logsBuffers[0];
+  memcpy(header->magic, LOGS_BINARY_MAGIC, sizeof(header->magic));
+  header->version = LOGS_BINARY_VERSION;
+#if defined(RTCLOCK)
+  header->flags = LOG_FLAG_RTC;
+  header->startTime = g_rtcTime;
+#endif
+  header->columnsCount = logsColumnsCount;
+  header->headerSize = headerSize;
+  header->recordSize = logsRecordSize;
+  header->bufferSize = LOGS_BINARY_BUFFER_SIZE;
+  header->interval = logDelay;
+  memcpy(logsBuffers[0] + sizeof(LogFileHeader), logsColumns, logsColumnsCount * sizeof(LogColumn));
+
+  result = f_write(&g_oLogFile, logsBuffers[0], headerSize, &written);
+  if (result != FR_OK) {
+    return result;
+  }
+
+  logsBufferIndex = 0;
+  logsBufferCount = 0;
+  logsBufferFull = false;
+  lastLogTime = 0;
+  logsRecording = true;
+  return FR_OK;
+}
+
+// The switches, in the same order and with the same values as the CSV logs
+static void getSwitchesStates(int32_t * values)
+{
+#if defined(PCBXLITE)
+  *values++ = GET_3POS_STATE(SA);
+  *values++ = GET_3POS_STATE(SB);
+#elif defined(PCBX7)
+  *values++ = GET_3POS_STATE(SA);
+  *values++ = GET_3POS_STATE(SB);
+  *values++ = GET_3POS_STATE(SC);
+  *values++ = GET_3POS_STATE(SD);
+  *values++ = GET_2POS_STATE(SF);
+  *values++ = GET_2POS_STATE(SH);
+#elif defined(PCBTARANIS) || defined(PCBHORUS)
+  *values++ = GET_3POS_STATE(SA);
+  *values++ = GET_3POS_STATE(SB);
+  *values++ = GET_3POS_STATE(SC);
+  *values++ = GET_3POS_STATE(SD);
+  *values++ = GET_3POS_STATE(SE);
+  *values++ = GET_2POS_STATE(SF);
+  *values++ = GET_3POS_STATE(SG);
+  *values++ = GET_2POS_STATE(SH);
+#elif defined(PCBI8) || defined(PCBMT6S)
+  *values++ = GET_3POS_STATE(SA);
+  *values++ = GET_3POS_STATE(SB);
+  *values++ = GET_3POS_STATE(SC);
+  *values++ = GET_3POS_STATE(SD);
+  *values++ = GET_2POS_STATE(SE);
+  *values++ = GET_2POS_STATE(SF);
+#else
+  *values++ = GET_2POS_STATE(THR);
+  *values++ = GET_2POS_STATE(RUD);
+  *values++ = GET_2POS_STATE(ELE);
+  *values++ = GET_3POS_STATE(ID);
+  *values++ = GET_2POS_STATE(AIL);
+  *values++ = GET_2POS_STATE(GEA);
+  *values++ = GET_2POS_STATE(TRN);
+#endif
+}
+
+// Called from the mixer task, copies the values in the buffer being filled
+void logsRecord()
+{
+  if (!logsRecording)
+    return;
+
+  tmr10ms_t tmr10ms = get_tmr10ms();
+  if (lastLogTime != 0 && (tmr10ms_t)(tmr10ms - lastLogTime) < (tmr10ms_t)logDelay)
+    return;
+  lastLogTime = tmr10ms;
+
+  if (logsBufferCount + logsRecordSize > LOGS_BINARY_BUFFER_SIZE) {
+    if (logsBufferFull) {
+      // the previous buffer is not yet written, the record is lost
+      return;
+    }
+    memset(&logsBuffers[logsBufferIndex][logsBufferCount], 0xFF, LOGS_BINARY_BUFFER_SIZE - logsBufferCount);
+    logsBufferIndex ^= 1;
+    logsBufferCount = 0;
+    logsBufferFull = true;
+  }
+
+  uint8_t * record = &logsBuffers[logsBufferIndex][logsBufferCount];
+  LogRecordHeader * header = (LogRecordHeader *)record;
+#if defined(RTCLOCK)
+  header->time = g_rtcTime;
+  header->ms = g_ms100 * 10;
+#else
+  header->time = tmr10ms;
+  header->ms = 0;
+#endif
+  header->spare = 0;
+
+  int32_t switches[NUM_SWITCHES];
+  getSwitchesStates(switches);
+
+  int32_t * values = (int32_t *)(record + sizeof(LogRecordHeader));
+  for (uint8_t i=0; i<logsColumnsCount; i++) {
+    const LogColumn & column = logsColumns[i];
+    switch (column.source) {
+#if defined(TELEMETRY_FRSKY)
+      case LOG_SOURCE_SENSOR:
+      {
+        // a mixer run may preempt the telemetry task in the middle of an update
+        TelemetryValue telemetryItem = getPublishedTelemetryValue(column.index);
+        if (column.type == LOG_COLUMN_GPS) {
+          *values++ = telemetryItem.gps.latitude;
+          *values++ = telemetryItem.gps.longitude;
+        }
+        else if (column.type == LOG_COLUMN_DATETIME) {
+          *values++ = (telemetryItem.datetime.year << 16) | (telemetryItem.datetime.month << 8) | telemetryItem.datetime.day;
+          *values++ = (telemetryItem.datetime.hour << 16) | (telemetryItem.datetime.min << 8) | telemetryItem.datetime.sec;
+        }
+        else {
+          *values++ = telemetryItem.value;
+        }
+        break;
+      }
+#endif
+      case LOG_SOURCE_ANALOG:
+        *values++ = calibratedAnalogs[column.index];
+        break;
+      case LOG_SOURCE_SWITCH:
+        *values++ = switches[column.index];
+        break;
+      case LOG_SOURCE_LOGICAL_SWITCHES:
+        *values++ = getLogicalSwitchesStates(32);
+        *values++ = getLogicalSwitchesStates(0);
+        break;
+      case LOG_SOURCE_TX_VOLTAGE:
+        *values++ = g_vbat100mV;
+        break;
+    }
+  }
+
+  logsBufferCount += logsRecordSize;
+}
+
+// Called from the menus task, writes the full buffer, or everything when the logs are closed
+FRESULT logsFlush(bool close)
+{
+  UINT written;
+
+  if (!g_oLogFile.obj.fs)
+    return FR_OK;
+
+  if (close) {
+    logsRecording = false;
+  }
+
+  if (logsBufferFull) {
+    FRESULT result = f_write(&g_oLogFile, logsBuffers[logsBufferIndex ^ 1], LOGS_BINARY_BUFFER_SIZE, &written);
+    logsBufferFull = false;
+    if (result != FR_OK) {
+      return result;
+    }
+  }
+
+  if (close && logsBufferCount > 0) {
+    // the session ends with a padding record, up to the next sector
+    uint16_t size = LOGS_BINARY_BUFFER_SIZE;
+    if (logsBufferCount + logsRecordSize <= LOGS_BINARY_BUFFER_SIZE) {
+      size = alignOnSector(logsBufferCount + sizeof(LogRecordHeader));
+    }
+    memset(&logsBuffers[logsBufferIndex][logsBufferCount], 0xFF, size - logsBufferCount);
+    logsBufferCount = 0;
+    return f_write(&g_oLogFile, logsBuffers[logsBufferIndex], size, &written);
+  }
+
+  return FR_OK;
+}
+#endif
+
 void logsWrite()
 {
   static const pm_char * error_displayed = NULL;
 
   if (isFunctionActive(FUNCTION_LOGS) && logDelay > 0) {
+#if defined(LOGS_BINARY)
+    // the records are taken by logsRecord() in the mixer task, only the full buffers are written here
+    if (!g_oLogFile.obj.fs) {
+      const pm_char * result = logsOpen();
+      if (result != NULL) {
+        if (result != error_displayed) {
+          error_displayed = result;
+          POPUP_WARNING(result);
+        }
+        return;
+      }
+    }
+
+    if (logsFlush(false) != FR_OK && !error_displayed) {
+      error_displayed = STR_SDCARD_ERROR;
+      POPUP_WARNING(STR_SDCARD_ERROR);
+      logsClose();
+    }
+#else
     tmr10ms_t tmr10ms = get_tmr10ms();
-    if (lastLogTime == 0 || (tmr10ms_t)(tmr10ms - lastLogTime) >= (tmr10ms_t)logDelay*10) {
+    if (lastLogTime == 0 || (tmr10ms_t)(tmr10ms - lastLogTime) >= (tmr10ms_t)logDelay) {
       lastLogTime = tmr10ms;
 
       if (!g_oLogFile.obj.fs) {
@@ -400,6 +749,7 @@ void logsWrite()
         logsClose();
       }
     }
+#endif
   }
   else {
     error_displayed = NULL;
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _LOGS_H_
+#define _LOGS_H_
+
+#include "definitions.h"
+
+// Binary logs file format (LOGS_BINARY), shared with Companion and radio/util/log2csv.py
+//
+// A file is made of sessions, one each time the logs are started. A session
+// starts on a sector boundary with a LogFileHeader followed by its columns,
+// padded to headerSize. Then come the buffers (bufferSize bytes each) of
+// fixed size records: a LogRecordHeader followed by one int32_t per column
+// value. A record never crosses a buffer boundary, the end of a buffer is
+// padded with 0xFF. A record which time is LOG_RECORD_PADDING ends the
+// session: the next session (or the end of the file) is found on the next
+// sector boundary after it.
+
+#define LOGS_BINARY_MAGIC          "OTXL"
+#define LOGS_BINARY_VERSION        1
+#define LOGS_BINARY_SECTOR_SIZE    512
+
+#define LOG_FLAG_RTC               0x01  // the records time is the RTC time, otherwise the 10ms timer
+
+#define LOG_RECORD_PADDING         0xFFFFFFFF
+
+#define LOG_COLUMN_NAME_LEN        8
+#define LOG_COLUMN_UNIT_LEN        4
+
+enum LogColumnType {
+  LOG_COLUMN_VALUE,              // 1 value, displayed with prec decimals
+  LOG_COLUMN_GPS,                // 2 values: latitude, longitude (1/1000000 deg)
+  LOG_COLUMN_DATETIME,           // 2 values: year<<16 | month<<8 | day, hour<<16 | min<<8 | sec
+  LOG_COLUMN_LOGICAL_SWITCHES,   // 2 values: L33-L64 and L1-L32 states
+};
+
+enum LogColumnSource {
+  LOG_SOURCE_SENSOR,             // index is the sensor index, id and instance are the sensor ones
+  LOG_SOURCE_ANALOG,             // index is the stick / pot / slider index
+  LOG_SOURCE_SWITCH,             // index is the switch index
+  LOG_SOURCE_LOGICAL_SWITCHES,
+  LOG_SOURCE_TX_VOLTAGE,
+};
+
+PACK(struct LogFileHeader {
+  char magic[4];
+  uint8_t version;
+  uint8_t flags;
+  uint8_t columnsCount;
+  uint8_t spare;
+  uint16_t headerSize;           // header and columns, a multiple of the sector size
+  uint16_t recordSize;
+  uint16_t bufferSize;           // a multiple of the sector size
+  uint16_t interval;             // 10ms
+  uint32_t startTime;            // RTC time
+});
+
+PACK(struct LogColumn {
+  uint8_t type;
+  uint8_t source;
+  uint8_t index;
+  uint8_t prec;
+  uint16_t id;
+  uint8_t instance;
+  uint8_t unit;                  // UNIT_xxx of the sensors
+  char name[LOG_COLUMN_NAME_LEN];
+  char unitName[LOG_COLUMN_UNIT_LEN];
+});
+
+PACK(struct LogRecordHeader {
+  uint32_t time;                 // RTC time, or 10ms timer
+  uint16_t ms;                   // ms in the RTC second
+  uint16_t spare;
+});
+
+inline uint8_t getLogColumnValuesCount(uint8_t type)
+{
+  return type == LOG_COLUMN_VALUE ? 1 : 2;
+}
+
+#endif // _LOGS_H_
@@ -1102,6 +1102,7 @@ static int luaSetTelemetryValue(lua_State * L)
       telemetrySensor.subId = subId;
       telemetrySensor.instance = instance;
       telemetrySensor.init(zname, unit, prec);
+      storageDirty(EE_MODEL);
       lua_pushboolean(L, true);
     } else {
       lua_pushboolean(L, false);
@@ -404,6 +404,7 @@ static int luaModelInsertInput(lua_State *L)
         expo->swtch = luaL_checkinteger(L, -1);
       }
     }
+    storageDirty(EE_MODEL);
   }
 
   return 0;
@@ -445,6 +446,7 @@ Delete all Inputs
 static int luaModelDeleteInputs(lua_State *L)
 {
   clearInputs();
+  storageDirty(EE_MODEL);
   return 0;
 }
 
@@ -645,6 +647,7 @@ static int luaModelInsertMix(lua_State *L)
         mix->speedDown = luaL_checkinteger(L, -1);
       }
     }
+    storageDirty(EE_MODEL);
   }
 
   return 0;
@@ -686,6 +689,7 @@ Remove all mixers
 static int luaModelDeleteMixes(lua_State *L)
 {
   memset(g_model.mixData, 0, sizeof(g_model.mixData));
+  storageDirty(EE_MODEL);
   return 0;
 }
 
@@ -0,0 +1,380 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/** @file Lua bytecode cache: index of the .luac files known to be built from their current .lua source. */
+
+#include <ctype.h>
+#include "opentx.h"
+#include "lua_api.h"
+#include "stamp.h"
+
+#if defined(LUA_COMPILER)
+
+extern "C" {
+  #include <lundump.h>
+}
+
+#define LUA_CACHE_MAGIC                0x4341554C  // "LUAC"
+#define LUA_CACHE_HASH_INIT            2166136261u
+#define LUA_CACHE_HASH_PRIME           16777619u
+
+PACK(struct LuaCacheHeader {
+  uint32_t magic;
+  uint32_t abi;
+  uint16_t count;
+  uint16_t crc;      // entries checksum
+});
+
+static LuaCacheEntry cacheEntries[LUA_CACHE_MAX_ENTRIES];  // from the least to the most recently used
+static uint8_t cacheCount = 0;
+static bool cacheLoaded = false;
+static bool cacheBulk = false;  // index saved once at the end of luaCacheCompileAll()
+
+// FNV-1a
+uint32_t luaCacheHash(uint32_t hash, const void * data, uint32_t len)
+{
+  const uint8_t * p = (const uint8_t *)data;
+  while (len--) {
+    hash = (hash ^ *p++) * LUA_CACHE_HASH_PRIME;
+  }
+  return hash;
+}
+
+uint32_t luaCacheAbi()
+{
+  // the bytecode header holds the Lua version, format, endianness and type sizes,
+  // the firmware version is added so that an update also invalidates the whole cache
+  lu_byte header[LUAC_HEADERSIZE];
+  luaU_header(header);
+  // and the entries size, for the index written before a change of their layout
+  uint8_t entrySize = sizeof(LuaCacheEntry);
+  uint32_t hash = luaCacheHash(LUA_CACHE_HASH_INIT, header, sizeof(header));
+  hash = luaCacheHash(hash, &entrySize, sizeof(entrySize));
+  return luaCacheHash(hash, VERSION, sizeof(VERSION) - 1);
+}
+
+static uint32_t hashPath(const char * filename)
+{
+  // FAT file names are case insensitive
+  uint32_t hash = LUA_CACHE_HASH_INIT;
+  for (const char * c = filename; *c; c++) {
+    uint8_t chr = toupper(*c);
+    hash = luaCacheHash(hash, &chr, 1);
+  }
+  return hash;
+}
+
+static bool hashFile(const char * filename, uint32_t & hash)
+{
+  FIL file;
+  uint8_t buffer[128];
+  UINT read;
+
+  if (f_open(&file, filename, FA_OPEN_EXISTING | FA_READ) != FR_OK) {
+    return false;
+  }
+
+  bool result = true;
+  hash = LUA_CACHE_HASH_INIT;
+  do {
+    if (f_read(&file, buffer, sizeof(buffer), &read) != FR_OK) {
+      result = false;
+      break;
+    }
+    hash = luaCacheHash(hash, buffer, read);
+  } while (read == sizeof(buffer));
+
+  f_close(&file);
+  return result;
+}
+
+static inline uint32_t getSourceTime(const FILINFO * finfo)
+{
+  return ((uint32_t)finfo->fdate << 16) + finfo->ftime;
+}
+
+static LuaCacheEntry * findEntry(uint32_t pathHash)
+{
+  for (uint8_t i=0; i<cacheCount; i++) {
+    if (cacheEntries[i].pathHash == pathHash) {
+      return &cacheEntries[i];
+    }
+  }
+  return NULL;
+}
+
+// moves the entry at the end of the list, the most recently used
+static LuaCacheEntry * useEntry(LuaCacheEntry * entry)
+{
+  LuaCacheEntry * last = &cacheEntries[cacheCount - 1];
+  if (entry != last) {
+    LuaCacheEntry tmp = *entry;
+    memmove(entry, entry + 1, (last - entry) * sizeof(LuaCacheEntry));
+    *last = tmp;
+  }
+  return last;
+}
+
+void luaCacheReset()
+{
+  cacheCount = 0;
+  cacheLoaded = false;
+}
+
+/*
+  @fn luaCacheLoad()
+
+  Read the cache index from the SD card, once per session.
+
+  @retval true if the index was already loaded or is valid for this firmware,
+   false if it is missing, corrupted or written by another firmware (all entries are then discarded)
+*/
+bool luaCacheLoad()
+{
+  if (cacheLoaded) {
+    return true;
+  }
+
+  cacheLoaded = true;
+  cacheCount = 0;
+
+  FIL file;
+  LuaCacheHeader header;
+  UINT read;
+
+  if (f_open(&file, LUA_CACHE_PATH, FA_OPEN_EXISTING | FA_READ) != FR_OK) {
+    TRACE("luaCacheLoad(): no index");
+    return false;
+  }
+
+  bool result = (f_read(&file, &header, sizeof(header), &read) == FR_OK && read == sizeof(header) &&
+                 header.magic == LUA_CACHE_MAGIC && header.abi == luaCacheAbi() && header.count <= LUA_CACHE_MAX_ENTRIES &&
+                 f_read(&file, cacheEntries, header.count * sizeof(LuaCacheEntry), &read) == FR_OK &&
+                 read == header.count * sizeof(LuaCacheEntry) &&
+                 crc16((const uint8_t *)cacheEntries, read) == header.crc);
+  f_close(&file);
+
+  if (result) {
+    cacheCount = header.count;
+    TRACE("luaCacheLoad(): %d entries", cacheCount);
+  }
+  else {
+    TRACE("luaCacheLoad(): index discarded");
+  }
+
+  return result;
+}
+
+void luaCacheSave()
+{
+  FIL file;
+  LuaCacheHeader header;
+  UINT written;
+
+  header.magic = LUA_CACHE_MAGIC;
+  header.abi = luaCacheAbi();
+  header.count = cacheCount;
+  header.crc = crc16((const uint8_t *)cacheEntries, cacheCount * sizeof(LuaCacheEntry));
+
+  if (f_open(&file, LUA_CACHE_PATH, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+    TRACE_ERROR("luaCacheSave(): Error: Could not open index file.");
+    return;
+  }
+  f_write(&file, &header, sizeof(header), &written);
+  f_write(&file, cacheEntries, cacheCount * sizeof(LuaCacheEntry), &written);
+  f_close(&file);
+}
+
+/*
+  @fn luaCacheCheck(const char * filename, const FILINFO * finfo, bool strip)
+
+  @param filename Full path of the .lua source file.
+  @param finfo Result of f_stat() on the source file.
+  @param strip The debug info is not wanted in the .luac file (no "d" mode flag).
+
+  @retval true if the .luac file was compiled by this firmware from the current source content,
+   with the same debug info. A source with a new timestamp but the same content (copied back,
+   restored...) is hashed once and its entry updated, without compilation.
+   The entry becomes the most recently used one, the new order is saved with the next change of the index.
+*/
+bool luaCacheCheck(const char * filename, const FILINFO * finfo, bool strip)
+{
+  luaCacheLoad();
+
+  LuaCacheEntry * entry = findEntry(hashPath(filename));
+  if (!entry || entry->sourceSize != finfo->fsize || entry->strip != strip) {
+    return false;
+  }
+
+  if (entry->sourceTime != getSourceTime(finfo)) {
+    uint32_t sourceHash;
+    if (!hashFile(filename, sourceHash) || sourceHash != entry->sourceHash) {
+      return false;
+    }
+    entry->sourceTime = getSourceTime(finfo);
+    useEntry(entry);
+    if (!cacheBulk) {
+      luaCacheSave();
+    }
+  }
+  else {
+    useEntry(entry);
+  }
+
+  return true;
+}
+
+/*
+  @fn luaCacheRecord(const char * filename, const FILINFO * finfo, bool strip)
+
+  Record that the .luac file has just been compiled from the given .lua source file,
+  stripped of its debug info or not. When the index is full the least recently used entry is dropped.
+*/
+void luaCacheRecord(const char * filename, const FILINFO * finfo, bool strip)
+{
+  uint32_t sourceHash;
+  if (!hashFile(filename, sourceHash)) {
+    return;
+  }
+
+  luaCacheLoad();
+
+  uint32_t pathHash = hashPath(filename);
+  LuaCacheEntry * entry = findEntry(pathHash);
+  if (!entry) {
+    if (cacheCount == LUA_CACHE_MAX_ENTRIES) {
+      memmove(&cacheEntries[0], &cacheEntries[1], (LUA_CACHE_MAX_ENTRIES - 1) * sizeof(LuaCacheEntry));
+      cacheCount--;
+    }
+    entry = &cacheEntries[cacheCount++];
+    entry->pathHash = pathHash;
+  }
+  else {
+    entry = useEntry(entry);
+  }
+  entry->sourceHash = sourceHash;
+  entry->sourceSize = finfo->fsize;
+  entry->sourceTime = getSourceTime(finfo);
+  entry->strip = strip;
+
+  if (!cacheBulk) {
+    luaCacheSave();
+  }
+}
+
+// shared by all recursion levels, to spare the stack
+static char compilePath[LEN_FILE_PATH_MAX + _MAX_LFN + 1];
+static FILINFO compileInfo;
+static bool compileStrip;  // same debug info as the scripts loaded later with LUA_SCRIPT_LOAD_MODE
+static uint16_t compileDone;
+static uint16_t compileTotal;
+
+// without L the scripts are only counted, for the progress bar
+static uint16_t luaCacheCompileDirectory(lua_State * L, uint8_t depth)
+{
+  DIR dir;
+  uint16_t count = 0;
+
+  if (f_opendir(&dir, compilePath) != FR_OK) {
+    return 0;
+  }
+
+  uint16_t pathLen = strlen(compilePath);
+  for (;;) {
+    if (f_readdir(&dir, &compileInfo) != FR_OK || compileInfo.fname[0] == 0) break;  // Break on error or end of dir
+    uint16_t len = strlen(compileInfo.fname);
+    if (compileInfo.fname[0] == '.' || pathLen + len + 1 >= (int)sizeof(compilePath)) continue;
+    compilePath[pathLen] = '/';
+    strcpy(&compilePath[pathLen + 1], compileInfo.fname);
+    if (compileInfo.fattrib & AM_DIR) {
+      if (depth < LUA_CACHE_MAX_DEPTH) {
+        count += luaCacheCompileDirectory(L, depth + 1);
+      }
+    }
+    else if (len > sizeof(SCRIPT_EXT) - 1 && !strcasecmp(&compileInfo.fname[len - sizeof(SCRIPT_EXT) + 1], SCRIPT_EXT)) {
+      if (!L) {
+        count++;
+      }
+      else if (f_stat(compilePath, &compileInfo) == FR_OK && !luaCacheCheck(compilePath, &compileInfo, compileStrip)) {
+#if defined(GUI)
+        drawProgressBar(compilePath, compileDone, compileTotal);
+#endif
+        int top = lua_gettop(L);
+        if (luaLoadScriptFileToState(L, compilePath, compileStrip ? "tc" : "tcd") == SCRIPT_OK) {
+          count++;
+        }
+        lua_settop(L, top);
+        lua_gc(L, LUA_GCCOLLECT, 0);
+      }
+      compileDone++;
+    }
+    compilePath[pathLen] = '\0';
+  }
+
+  f_closedir(&dir);
+  return count;
+}
+
+/*
+  @fn luaCacheCompileAll(lua_State * L)
+
+  Compile all the Lua scripts on the SD card which are not in the cache yet, so that the first model
+  load after a firmware update or a new SD card does not pay for the compilation. A progress bar
+  is displayed meanwhile, the scripts are counted first.
+
+  @retval number of compiled scripts
+*/
+uint16_t luaCacheCompileAll(lua_State * L)
+{
+#if defined(COLORLCD)
+  static const char * const directories[] = { SCRIPTS_PATH, WIDGETS_PATH, THEMES_PATH };
+#else
+  static const char * const directories[] = { SCRIPTS_PATH };
+#endif
+
+  uint16_t count = 0;
+  cacheBulk = true;
+  compileStrip = !strchr(LUA_SCRIPT_LOAD_MODE, 'd');
+
+  compileTotal = 0;
+  for (uint8_t i=0; i<DIM(directories); i++) {
+    strcpy(compilePath, directories[i]);
+    compileTotal += luaCacheCompileDirectory(NULL, 0);
+  }
+  compileDone = 0;
+
+  PROTECT_LUA() {
+    for (uint8_t i=0; i<DIM(directories); i++) {
+      strcpy(compilePath, directories[i]);
+      count += luaCacheCompileDirectory(L, 0);
+    }
+  }
+  else {
+    TRACE_ERROR("luaCacheCompileAll(): Error compiling %s", compilePath);
+  }
+  UNPROTECT_LUA();
+
+  cacheBulk = false;
+  luaCacheSave();
+  TRACE("luaCacheCompileAll(): %d scripts compiled", count);
+  return count;
+}
+
+#endif // defined(LUA_COMPILER)
@@ -50,6 +50,9 @@ struct our_longjmp * global_lj = 0;
 #if defined(COLORLCD)
 uint32_t luaExtraMemoryUsage = 0;
 #endif
+#if defined(LUA_PROFILER)
+static char standaloneScriptName[LUA_PROFILER_NAME_LEN];
+#endif
 
 #if defined(LUA_ALLOCATOR_TRACER)
 
@@ -97,6 +100,10 @@ int custom_lua_atpanic(lua_State * L)
 
 void luaHook(lua_State * L, lua_Debug *ar)
 {
+#if defined(LUA_PROFILER)
+  luaProfilerHook(L, ar);
+#endif
+
   if (ar->event == LUA_HOOKCOUNT) {
     instructionsPercent++;
 #if defined(DEBUG)
@@ -140,9 +147,9 @@ void luaSetInstructionsLimit(lua_State * L, int count)
 {
   instructionsPercent = 0;
 #if defined(LUA_ALLOCATOR_TRACER)
-  lua_sethook(L, luaHook, LUA_MASKCOUNT|LUA_MASKLINE, count);
+  lua_sethook(L, luaHook, LUA_MASKCOUNT|LUA_MASKLINE|LUA_PROFILER_HOOK_MASK(), count);
 #else
-  lua_sethook(L, luaHook, LUA_MASKCOUNT, count);
+  lua_sethook(L, luaHook, LUA_MASKCOUNT|LUA_PROFILER_HOOK_MASK(), count);
 #endif
 }
 
@@ -311,6 +318,92 @@ void luaDoGc(lua_State * L, bool full)
   }
 }
 
+struct LuaGcState {
+  uint32_t memUsed;   // after the previous idle GC
+  uint8_t cycles;     // GC cycles to complete before all known garbage is collected
+};
+
+#if defined(COLORLCD)
+static LuaGcState luaGcStates[2];  // lsScripts, lsWidgets
+#else
+static LuaGcState luaGcStates[1];  // lsScripts
+#endif
+
+static uint16_t luaDoGcSteps(lua_State * L, LuaGcState & state, uint16_t start)
+{
+  uint32_t memUsed = luaGetMemUsed(L);
+  uint32_t allocated = (memUsed > state.memUsed ? memUsed - state.memUsed : 0);
+  state.memUsed = memUsed;
+
+  if (allocated > 0) {
+    // objects allocated during a cycle may only be collected by the next one
+    uint8_t cycles = (G(L)->gcstate == GCSpause ? 1 : 2);
+    if (cycles > state.cycles) {
+      state.cycles = cycles;
+    }
+  }
+  else if (state.cycles == 0) {
+    // no new garbage since the end of the last cycle
+    return 0;
+  }
+
+  // the more the scripts allocate, the more time is given to the collector
+  uint32_t budget = LUA_GC_MIN_BUDGET + allocated * LUA_GC_BUDGET_PER_KB / 1024;
+  if (budget > LUA_GC_FRAME_BUDGET) {
+    budget = LUA_GC_FRAME_BUDGET;
+  }
+  uint16_t elapsed = getTmr2MHz() - start;
+  if (elapsed >= budget) {
+    return 0;
+  }
+  budget -= elapsed;
+  start += elapsed;
+
+  uint16_t steps = 0;
+  PROTECT_LUA() {
+    do {
+      steps++;
+      // a single basic step, which is cheap and gives a fine time granularity
+      if (lua_gc(L, LUA_GCSTEP, 0)) {
+        state.cycles--;
+      }
+    } while (state.cycles > 0 && (uint16_t)(getTmr2MHz() - start) < budget);
+    state.memUsed = luaGetMemUsed(L);
+  }
+  else {
+    // we disable Lua for the rest of the session
+    if (L == lsScripts) luaDisable();
+#if defined(COLORLCD)
+    if (L == lsWidgets) lsWidgets = 0;
+#endif
+  }
+  UNPROTECT_LUA();
+
+  return steps;
+}
+
+uint16_t luaDoGcIdle()
+{
+  uint16_t start = getTmr2MHz();
+  uint16_t steps = 0;
+
+  if (lsScripts && luaState != INTERPRETER_PANIC) {
+    LUA_PROFILER_START(LUA_PROFILE_GC, "scripts");
+    steps += luaDoGcSteps(lsScripts, luaGcStates[0], start);
+    LUA_PROFILER_STOP();
+  }
+
+#if defined(COLORLCD)
+  if (lsWidgets) {
+    LUA_PROFILER_START(LUA_PROFILE_GC, "widgets");
+    steps += luaDoGcSteps(lsWidgets, luaGcStates[1], start);
+    LUA_PROFILER_STOP();
+  }
+#endif
+
+  return steps;
+}
+
 void luaFree(lua_State * L, ScriptInternalData & sid)
 {
   PROTECT_LUA() {
@@ -352,21 +445,24 @@ static int luaDumpWriter(lua_State * L, const void* p, size_t size, void* u)
   @param stripDebug This is passed directly to luaU_dump()
     1 = remove debug info from bytecode (smaller but errors are less informative)
     0 = keep debug info
+  @retval true if the whole bytecode was written
 */
-static void luaDumpState(lua_State * L, const char * filename, const FILINFO * finfo, int stripDebug)
+static bool luaDumpState(lua_State * L, const char * filename, const FILINFO * finfo, int stripDebug)
 {
   FIL D;
   if (f_open(&D, filename, FA_WRITE | FA_CREATE_ALWAYS) == FR_OK) {
     lua_lock(L);
-    luaU_dump(L, getproto(L->top - 1), luaDumpWriter, &D, stripDebug);
+    int error = luaU_dump(L, getproto(L->top - 1), luaDumpWriter, &D, stripDebug);
     lua_unlock(L);
-    if (f_close(&D) == FR_OK) {
+    if (f_close(&D) == FR_OK && !error) {
       if (finfo != NULL)
         f_utime(filename, finfo);  // set the file mod time
       TRACE("luaDumpState(%s): Saved bytecode to file.", filename);
+      return true;
     }
   } else
     TRACE_ERROR("luaDumpState(%s): Error: Could not open output file.", filename);
+  return false;
 }
 #endif  // LUA_COMPILER
 
@@ -386,6 +482,8 @@ static void luaDumpState(lua_State * L, const char * filename, const FILINFO * f
     "t" only text.
     "T" (default on simulator) prefer text but load binary if that is the only version available.
     "bt" (default on radio) either binary or text, whichever is newer (binary preferred when timestamps are equal).
+      When the text version exists, the bytecode cache (see cache.cpp) decides instead of the timestamps: the binary
+      version is loaded only if it was compiled by this firmware from the current source content.
     Add "x" to avoid automatic compilation of source file to .luac version.
       Eg: "tx", "bx", or "btx".
     Add "c" to force compilation of source file to .luac version (even if existing version is newer than source file).
@@ -421,7 +519,7 @@ int luaLoadScriptFileToState(lua_State * L, const char * filename, const char *
   uint8_t extlen;
   char filenameFull[LEN_FILE_PATH_MAX + _MAX_LFN + 1] = "\0";
   FILINFO fnoLuaS, fnoLuaC;
-  FRESULT frLuaS, frLuaC;
+  FRESULT frLuaS, frLuaC = FR_NO_FILE;
 
   bool scriptNeedsCompile = false;
   uint8_t loadFileType = 0;  // 1=text, 2=binary
@@ -439,16 +537,32 @@ int luaLoadScriptFileToState(lua_State * L, const char * filename, const char *
   }
   strncat(filenameFull, filename, fnamelen);
 
-  // check if binary version exists
-  strcpy(filenameFull + fnamelen, SCRIPT_BIN_EXT);
-  frLuaC = f_stat(filenameFull, &fnoLuaC);
-
   // check if text version exists
   strcpy(filenameFull + fnamelen, SCRIPT_EXT);
   frLuaS = f_stat(filenameFull, &fnoLuaS);
 
+  if (frLuaS == FR_OK && strchr(lmode, 'b') && !strpbrk(lmode, "xc")) {
+    // the bytecode cache decides, no need to look for the binary version
+    if (luaCacheCheck(filenameFull, &fnoLuaS, !strchr(lmode, 'd'))) {
+      loadFileType = 2;
+    }
+    else {
+      loadFileType = 1;
+      scriptNeedsCompile = true;
+    }
+  }
+  else {
+    // check if binary version exists
+    strcpy(filenameFull + fnamelen, SCRIPT_BIN_EXT);
+    frLuaC = f_stat(filenameFull, &fnoLuaC);
+    strcpy(filenameFull + fnamelen, SCRIPT_EXT);
+  }
+
   // decide which version to load, text or binary
-  if (frLuaC != FR_OK && frLuaS == FR_OK) {
+  if (loadFileType) {
+    // already decided by the bytecode cache
+  }
+  else if (frLuaC != FR_OK && frLuaS == FR_OK) {
     // only text version exists
     loadFileType = 1;
     scriptNeedsCompile = true;
@@ -509,17 +623,22 @@ int luaLoadScriptFileToState(lua_State * L, const char * filename, const char *
   lstatus = luaL_loadfilex(L, filenameFull, NULL);
 #if defined(LUA_COMPILER)
   // Check for bytecode encoding problem, eg. compiled for x64. Unfortunately Lua doesn't provide a unique error code for this. See Lua/src/lundump.c.
-  if (lstatus == LUA_ERRSYNTAX && loadFileType == 2 && frLuaS == FR_OK && strstr(lua_tostring(L, -1), "precompiled")) {
+  // The binary version may also have been deleted behind the bytecode cache back.
+  if (loadFileType == 2 && frLuaS == FR_OK && (lstatus == LUA_ERRFILE || (lstatus == LUA_ERRSYNTAX && strstr(lua_tostring(L, -1), "precompiled")))) {
     loadFileType = 1;
     scriptNeedsCompile = true;
     strcpy(filenameFull + fnamelen, SCRIPT_EXT);
     TRACE_ERROR("luaLoadScriptFileToState(%s, %s): Error loading script: %s\n\tRetrying with %s\n", filename, lmode, lua_tostring(L, -1), filenameFull);
+    lua_pop(L, 1);  // error message
     lstatus = luaL_loadfilex(L, filenameFull, NULL);
   }
   if (lstatus == LUA_OK) {
     if (scriptNeedsCompile && loadFileType == 1) {
       strcpy(filenameFull + fnamelen, SCRIPT_BIN_EXT);
-      luaDumpState(L, filenameFull, &fnoLuaS, (strchr(lmode, 'd') ? 0 : 1));
+      if (luaDumpState(L, filenameFull, &fnoLuaS, (strchr(lmode, 'd') ? 0 : 1))) {
+        strcpy(filenameFull + fnamelen, SCRIPT_EXT);
+        luaCacheRecord(filenameFull, &fnoLuaS, !strchr(lmode, 'd'));
+      }
     }
     ret = SCRIPT_OK;
   }
@@ -798,6 +917,11 @@ void luaExec(const char * filename)
 {
   luaInit();
 
+#if defined(LUA_PROFILER)
+  const char * name = strrchr(filename, '/');
+  strncpy(standaloneScriptName, name ? name+1 : filename, LUA_PROFILER_NAME_LEN-1);
+#endif
+
   if (luaState != INTERPRETER_PANIC) {
     standaloneScript.state = SCRIPT_NOFILE;
     int result = luaLoad(lsScripts, filename, standaloneScript);
@@ -820,7 +944,10 @@ void luaDoOneRunStandalone(event_t evt)
     luaSetInstructionsLimit(lsScripts, MANUAL_SCRIPTS_MAX_INSTRUCTIONS);
     lua_rawgeti(lsScripts, LUA_REGISTRYINDEX, standaloneScript.run);
     lua_pushunsigned(lsScripts, evt);
-    if (lua_pcall(lsScripts, 1, 1, 0) == 0) {
+    LUA_PROFILER_START(LUA_PROFILE_STANDALONE, standaloneScriptName);
+    int result = lua_pcall(lsScripts, 1, 1, 0);
+    LUA_PROFILER_STOP();
+    if (result == 0) {
       if (!lua_isnumber(lsScripts, -1)) {
         if (instructionsPercent > 100) {
           TRACE("Script killed");
@@ -900,8 +1027,12 @@ bool luaDoOneRunPermanentScript(event_t evt, int i, uint32_t scriptType)
 
   luaSetInstructionsLimit(lsScripts, PERMANENT_SCRIPTS_MAX_INSTRUCTIONS);
   int inputsCount = 0;
-#if defined(SIMU) || defined(DEBUG)
+#if defined(SIMU) || defined(DEBUG) || defined(LUA_PROFILER)
   const char *filename;
+#endif
+#if defined(LUA_PROFILER)
+  char profileKind;
+  uint8_t filenameLen;
 #endif
   ScriptInputsOutputs * sio = NULL;
 #if SCRIPT_MIX_FIRST > 0
@@ -912,8 +1043,12 @@ bool luaDoOneRunPermanentScript(event_t evt, int i, uint32_t scriptType)
     ScriptData & sd = g_model.scriptsData[sid.reference-SCRIPT_MIX_FIRST];
     sio = &scriptInputsOutputs[sid.reference-SCRIPT_MIX_FIRST];
     inputsCount = sio->inputsCount;
-#if defined(SIMU) || defined(DEBUG)
+#if defined(SIMU) || defined(DEBUG) || defined(LUA_PROFILER)
     filename = sd.file;
+#endif
+#if defined(LUA_PROFILER)
+    profileKind = LUA_PROFILE_MIX;
+    filenameLen = sizeof(sd.file);
 #endif
     lua_rawgeti(lsScripts, LUA_REGISTRYINDEX, sid.run);
     for (int j=0; j<sio->inputsCount; j++) {
@@ -925,8 +1060,12 @@ bool luaDoOneRunPermanentScript(event_t evt, int i, uint32_t scriptType)
   }
   else if ((scriptType & RUN_FUNC_SCRIPT) && (sid.reference >= SCRIPT_FUNC_FIRST && sid.reference <= SCRIPT_GFUNC_LAST)) {
     CustomFunctionData & fn = (sid.reference < SCRIPT_GFUNC_FIRST ? g_model.customFn[sid.reference-SCRIPT_FUNC_FIRST] : g_eeGeneral.customFn[sid.reference-SCRIPT_GFUNC_FIRST]);
-#if defined(SIMU) || defined(DEBUG)
+#if defined(SIMU) || defined(DEBUG) || defined(LUA_PROFILER)
     filename = fn.play.name;
+#endif
+#if defined(LUA_PROFILER)
+    profileKind = LUA_PROFILE_FUNCTION;
+    filenameLen = sizeof(fn.play.name);
 #endif
     if (getSwitch(fn.swtch))
       lua_rawgeti(lsScripts, LUA_REGISTRYINDEX, sid.run);
@@ -937,9 +1076,13 @@ bool luaDoOneRunPermanentScript(event_t evt, int i, uint32_t scriptType)
   }
   else {
 #if defined(PCBTARANIS)
-#if defined(SIMU) || defined(DEBUG)
+#if defined(SIMU) || defined(DEBUG) || defined(LUA_PROFILER)
     TelemetryScriptData & script = g_model.frsky.screens[sid.reference-SCRIPT_TELEMETRY_FIRST].script;
     filename = script.file;
+#endif
+#if defined(LUA_PROFILER)
+    profileKind = LUA_PROFILE_TELEMETRY;
+    filenameLen = sizeof(script.file);
 #endif
     if ((scriptType & RUN_TELEM_FG_SCRIPT) && (menuHandlers[0]==menuViewTelemetryFrsky && sid.reference==SCRIPT_TELEMETRY_FIRST+s_frsky_view)) {
       lua_rawgeti(lsScripts, LUA_REGISTRYINDEX, sid.run);
@@ -957,7 +1100,10 @@ bool luaDoOneRunPermanentScript(event_t evt, int i, uint32_t scriptType)
 #endif
   }
 
-  if (lua_pcall(lsScripts, inputsCount, sio ? sio->outputsCount : 0, 0) == 0) {
+  LUA_PROFILER_START(profileKind, filename, filenameLen);
+  int result = lua_pcall(lsScripts, inputsCount, sio ? sio->outputsCount : 0, 0);
+  LUA_PROFILER_STOP();
+  if (result == 0) {
     if (sio) {
       for (int j=sio->outputsCount-1; j>=0; j--) {
         if (!lua_isnumber(lsScripts, -1)) {
@@ -1031,13 +1177,9 @@ bool luaTask(event_t evt, uint8_t scriptType, bool allowLcdUsage)
         break;
       }
       UNPROTECT_LUA();
-      //todo gc step between scripts
     }
   }
-  luaDoGc(lsScripts, false);
-#if defined(COLORLCD)
-  luaDoGc(lsWidgets, false);
-#endif
+  // the garbage is collected by luaDoGcIdle(), while the LCD is refreshed
   return scriptWasRun;
 }
 
@@ -1088,6 +1230,10 @@ void luaInit()
       // install our panic handler
       lua_atpanic(lsScripts, &custom_lua_atpanic);
 
+#if defined(LUA_PROFILER)
+      luaProfilerAttach(lsScripts);
+#endif
+
 #if defined(LUA_ALLOCATOR_TRACER)
       lua_sethook(lsScripts, luaHook, LUA_MASKLINE, 0);
 #endif
@@ -1103,6 +1249,13 @@ void luaInit()
       }
       UNPROTECT_LUA();
       TRACE("lsScripts %p", lsScripts);
+
+#if defined(LUA_COMPILER)
+      // first boot with this firmware or this SD card: compile everything now rather than on each model load
+      if (luaState != INTERPRETER_PANIC && strchr(LUA_SCRIPT_LOAD_MODE, 'b') && !strchr(LUA_SCRIPT_LOAD_MODE, 'x') && !luaCacheLoad()) {
+        luaCacheCompileAll(lsScripts);
+      }
+#endif
     }
     else {
       /* log error and return */
@@ -130,6 +130,7 @@ bool luaTask(event_t evt, uint8_t scriptType, bool allowLcdUsage);
 void checkLuaMemoryUsage();
 void luaExec(const char * filename);
 void luaDoGc(lua_State * L, bool full);
+uint16_t luaDoGcIdle();
 void luaError(lua_State * L, uint8_t error, bool acknowledge=true);
 uint32_t luaGetMemUsed(lua_State * L);
 void luaGetValueAndPush(lua_State * L, int src);
@@ -151,6 +152,11 @@ extern struct our_longjmp * global_lj;
                         if (setjmp(lj.b) == 0)
 #define UNPROTECT_LUA() global_lj = lj.previous; }   /* restore old error handler */
 
+// incremental GC time per GUI frame, in 2MHz ticks
+#define LUA_GC_MIN_BUDGET     (2*100)   // 100us
+#define LUA_GC_BUDGET_PER_KB  (2*50)    // +50us per KB allocated since the previous frame
+#define LUA_GC_FRAME_BUDGET   (2*2000)  // 2ms max
+
 extern uint16_t maxLuaInterval;
 extern uint16_t maxLuaDuration;
 extern uint8_t instructionsPercent;
@@ -183,6 +189,85 @@ struct LuaMemTracer {
 void * tracer_alloc(void * ud, void * ptr, size_t osize, size_t nsize);
 void luaHook(lua_State * L, lua_Debug *ar);
 
+#if defined(LUA_COMPILER)
+#define LUA_CACHE_PATH                 SCRIPTS_PATH "/luac.idx"
+#define LUA_CACHE_MAX_ENTRIES          64
+#define LUA_CACHE_MAX_DEPTH            2   // sub-directories compiled by luaCacheCompileAll()
+
+PACK(struct LuaCacheEntry {
+  uint32_t pathHash;    // .lua full path
+  uint32_t sourceHash;  // .lua content
+  uint32_t sourceSize;
+  uint32_t sourceTime;  // FAT date << 16 | time
+  uint8_t strip;        // debug info stripped from the .luac (no "d" mode flag)
+});
+
+uint32_t luaCacheHash(uint32_t hash, const void * data, uint32_t len);
+uint32_t luaCacheAbi();
+void luaCacheReset();
+bool luaCacheLoad();
+void luaCacheSave();
+bool luaCacheCheck(const char * filename, const FILINFO * finfo, bool strip);
+void luaCacheRecord(const char * filename, const FILINFO * finfo, bool strip);
+uint16_t luaCacheCompileAll(lua_State * L);
+#endif
+
+#if defined(LUA_PROFILER)
+#define LUA_PROFILER_NAME_LEN          10
+#define LUA_PROFILER_MAX_SCRIPTS       16
+#define LUA_PROFILER_MAX_FUNCTIONS     32
+#define LUA_PROFILER_STACK_DEPTH       16
+#define LUA_PROFILER_NONE              0xFF
+
+#define LUA_PROFILE_MIX                'm'
+#define LUA_PROFILE_FUNCTION           'f'
+#define LUA_PROFILE_TELEMETRY          't'
+#define LUA_PROFILE_STANDALONE         's'
+#define LUA_PROFILE_WIDGET             'w'
+#define LUA_PROFILE_GC                 'g'
+
+struct LuaScriptProfile {
+  char kind;
+  char name[LUA_PROFILER_NAME_LEN];
+  uint32_t runs;
+  uint32_t time;          // us, all runs
+  uint32_t maxTime;       // us, longest run
+  uint32_t instructions;  // counted by the instructions hook, one hook period resolution
+  uint32_t allocated;     // bytes allocated while running
+  uint32_t freed;         // bytes released while running (incremental GC work)
+};
+
+struct LuaFunctionProfile {
+  uint8_t script;         // index in luaScriptProfiles
+  int16_t line;           // line where the function is defined
+  char source[LUA_PROFILER_NAME_LEN];
+  uint32_t calls;
+  uint32_t ticks;         // 2MHz ticks, self time (Lua callees excluded, C callees included)
+  uint32_t instructions;
+};
+
+extern LuaScriptProfile luaScriptProfiles[LUA_PROFILER_MAX_SCRIPTS];
+extern uint8_t luaScriptProfilesCount;
+extern LuaFunctionProfile luaFunctionProfiles[LUA_PROFILER_MAX_FUNCTIONS];
+extern uint8_t luaFunctionProfilesCount;
+extern bool luaProfileFunctions;
+
+void luaProfilerReset();
+void luaProfilerAttach(lua_State * L);
+void luaProfilerStart(char kind, const char * name, uint8_t len=0xFF);
+void luaProfilerStop();
+void luaProfilerHook(lua_State * L, lua_Debug * ar);
+void luaProfilerReport(void (*print)(const char * line));
+void luaProfilerTrace();
+#define LUA_PROFILER_HOOK_MASK()       (luaProfileFunctions ? (LUA_MASKCALL|LUA_MASKRET) : 0)
+#define LUA_PROFILER_START(...)        luaProfilerStart(__VA_ARGS__)
+#define LUA_PROFILER_STOP()            luaProfilerStop()
+#else
+#define LUA_PROFILER_HOOK_MASK()       0
+#define LUA_PROFILER_START(...)
+#define LUA_PROFILER_STOP()
+#endif
+
 
 #else  // defined(LUA)
 
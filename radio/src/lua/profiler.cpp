@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/** @file Lua scripts profiler: CPU, instructions and memory accounting per script and per function. */
+
+#include "opentx.h"
+#include "lua_api.h"
+#include <stdio.h>
+
+#if defined(LUA_PROFILER)
+
+LuaScriptProfile luaScriptProfiles[LUA_PROFILER_MAX_SCRIPTS];
+uint8_t luaScriptProfilesCount = 0;
+LuaFunctionProfile luaFunctionProfiles[LUA_PROFILER_MAX_FUNCTIONS];
+uint8_t luaFunctionProfilesCount = 0;
+bool luaProfileFunctions = false;
+
+struct LuaProfilerAllocator {
+  lua_Alloc alloc;
+  void * ud;
+};
+
+#if defined(COLORLCD)
+static LuaProfilerAllocator profilerAllocators[2];  // lsScripts, lsWidgets
+#else
+static LuaProfilerAllocator profilerAllocators[1];  // lsScripts
+#endif
+
+static uint8_t currentScript = LUA_PROFILER_NONE;
+static DebugTimer currentTimer;
+
+// shadow of the Lua call stack, only maintained when luaProfileFunctions is set
+static uint8_t callStack[LUA_PROFILER_STACK_DEPTH];
+static uint8_t callStackDepth;
+static uint16_t lastTick;
+static tmr10ms_t lastTick10ms;
+
+static void copyName(char * destination, const char * source, uint8_t len)
+{
+  // keep only the file name
+  uint8_t start = 0;
+  for (uint8_t i=0; i<len && source[i]; i++) {
+    if (source[i] == '/') {
+      start = i + 1;
+    }
+  }
+  source += start;
+  len -= start;
+
+  uint8_t i = 0;
+  for (; i<len && i<LUA_PROFILER_NAME_LEN-1 && source[i]; i++) {
+    destination[i] = source[i];
+  }
+  destination[i] = '\0';
+}
+
+void luaProfilerReset()
+{
+  luaScriptProfilesCount = 0;
+  luaFunctionProfilesCount = 0;
+  currentScript = LUA_PROFILER_NONE;
+}
+
+static void * profiler_alloc(void * ud, void * ptr, size_t osize, size_t nsize)
+{
+  LuaProfilerAllocator * allocator = (LuaProfilerAllocator *)ud;
+  if (currentScript != LUA_PROFILER_NONE) {
+    LuaScriptProfile & profile = luaScriptProfiles[currentScript];
+    if (!ptr)
+      profile.allocated += nsize;  // osize is the object type here
+    else if (nsize > osize)
+      profile.allocated += nsize - osize;
+    else
+      profile.freed += osize - nsize;
+  }
+  return allocator->alloc(allocator->ud, ptr, osize, nsize);
+}
+
+void luaProfilerAttach(lua_State * L)
+{
+  LuaProfilerAllocator & allocator = profilerAllocators[L == lsScripts ? 0 : DIM(profilerAllocators) - 1];
+  allocator.alloc = lua_getallocf(L, &allocator.ud);
+  lua_setallocf(L, profiler_alloc, &allocator);
+}
+
+void luaProfilerStart(char kind, const char * name, uint8_t len)
+{
+  char key[LUA_PROFILER_NAME_LEN];
+  copyName(key, name, len);
+
+  uint8_t index = 0;
+  while (index < luaScriptProfilesCount && (luaScriptProfiles[index].kind != kind || strcmp(luaScriptProfiles[index].name, key))) {
+    index++;
+  }
+
+  if (index == luaScriptProfilesCount) {
+    if (index == LUA_PROFILER_MAX_SCRIPTS) {
+      currentScript = LUA_PROFILER_NONE;
+      return;
+    }
+    LuaScriptProfile & profile = luaScriptProfiles[luaScriptProfilesCount++];
+    memclear(&profile, sizeof(profile));
+    profile.kind = kind;
+    strcpy(profile.name, key);
+  }
+
+  currentScript = index;
+  callStackDepth = 0;
+  lastTick = getTmr2MHz();
+  lastTick10ms = get_tmr10ms();
+  currentTimer.start();
+}
+
+static uint8_t getCallStackTop()
+{
+  if (callStackDepth == 0)
+    return LUA_PROFILER_NONE;
+  else if (callStackDepth > LUA_PROFILER_STACK_DEPTH)
+    return callStack[LUA_PROFILER_STACK_DEPTH - 1];
+  else
+    return callStack[callStackDepth - 1];
+}
+
+static void chargeCallStackTop()
+{
+  uint16_t now = getTmr2MHz();
+  tmr10ms_t now10ms = get_tmr10ms();
+  uint8_t function = getCallStackTop();
+  if (function != LUA_PROFILER_NONE) {
+    // getTmr2MHz wraps every 32.7ms, longer slices are measured with the 10ms timer like DebugTimer does
+    uint32_t elapsed10ms = now10ms - lastTick10ms;
+    uint32_t ticks = (elapsed10ms < 3 ? (uint16_t)(now - lastTick) : elapsed10ms * 20000);
+    luaFunctionProfiles[function].ticks += ticks;
+  }
+  lastTick = now;
+  lastTick10ms = now10ms;
+}
+
+void luaProfilerStop()
+{
+  if (currentScript == LUA_PROFILER_NONE) return;
+
+  currentTimer.stop();
+  LuaScriptProfile & profile = luaScriptProfiles[currentScript];
+  profile.runs++;
+  profile.time += currentTimer.getLast();
+  if (currentTimer.getLast() > profile.maxTime) {
+    profile.maxTime = currentTimer.getLast();
+  }
+
+  // an error unwinds the Lua stack without return events
+  if (luaProfileFunctions) {
+    chargeCallStackTop();
+  }
+  currentScript = LUA_PROFILER_NONE;
+}
+
+static uint8_t getFunctionProfile(lua_Debug * ar)
+{
+  char source[LUA_PROFILER_NAME_LEN];
+  copyName(source, ar->source[0] == '@' || ar->source[0] == '=' ? ar->source + 1 : ar->source, 0xFF);
+
+  uint8_t index = 0;
+  while (index < luaFunctionProfilesCount) {
+    LuaFunctionProfile & function = luaFunctionProfiles[index];
+    if (function.script == currentScript && function.line == ar->linedefined && !strcmp(function.source, source)) {
+      break;
+    }
+    index++;
+  }
+
+  if (index == luaFunctionProfilesCount) {
+    if (index == LUA_PROFILER_MAX_FUNCTIONS) {
+      return LUA_PROFILER_NONE;
+    }
+    LuaFunctionProfile & function = luaFunctionProfiles[luaFunctionProfilesCount++];
+    memclear(&function, sizeof(function));
+    function.script = currentScript;
+    function.line = ar->linedefined;
+    strcpy(function.source, source);
+  }
+
+  luaFunctionProfiles[index].calls++;
+  return index;
+}
+
+void luaProfilerHook(lua_State * L, lua_Debug * ar)
+{
+  if (currentScript == LUA_PROFILER_NONE) return;
+
+  if (ar->event == LUA_HOOKCOUNT) {
+    int count = lua_gethookcount(L);
+    luaScriptProfiles[currentScript].instructions += count;
+    uint8_t function = getCallStackTop();
+    if (function != LUA_PROFILER_NONE) {
+      luaFunctionProfiles[function].instructions += count;
+    }
+  }
+  else if (ar->event == LUA_HOOKRET) {
+    chargeCallStackTop();
+    if (callStackDepth > 0) {
+      callStackDepth--;
+    }
+  }
+  else if (ar->event == LUA_HOOKCALL || ar->event == LUA_HOOKTAILCALL) {
+    chargeCallStackTop();
+    lua_getinfo(L, "S", ar);
+    // C functions time is charged to their caller
+    uint8_t function = (ar->what[0] == 'C' ? getCallStackTop() : getFunctionProfile(ar));
+    if (ar->event == LUA_HOOKTAILCALL && callStackDepth > 0) {
+      // the caller frame is replaced, there will be only one return event
+      callStackDepth--;
+    }
+    if (callStackDepth < LUA_PROFILER_STACK_DEPTH) {
+      callStack[callStackDepth] = function;
+    }
+    if (callStackDepth < 0xFF) {
+      callStackDepth++;
+    }
+  }
+}
+
+void luaProfilerReport(void (*print)(const char * line))
+{
+  char line[80];
+
+  print("Lua scripts: runs, time avg/max (us), instructions, allocated/freed (bytes)");
+  for (uint8_t i=0; i<luaScriptProfilesCount; i++) {
+    const LuaScriptProfile & profile = luaScriptProfiles[i];
+    snprintf(line, sizeof(line), "  %c %-9s %u, %u/%u, %u, %u/%u", profile.kind, profile.name, (unsigned)profile.runs,
+             (unsigned)(profile.runs ? profile.time / profile.runs : 0), (unsigned)profile.maxTime,
+             (unsigned)profile.instructions, (unsigned)profile.allocated, (unsigned)profile.freed);
+    print(line);
+  }
+
+  if (luaFunctionProfilesCount > 0) {
+    print("Lua functions: calls, self time (us), instructions");
+    for (uint8_t i=0; i<luaFunctionProfilesCount; i++) {
+      const LuaFunctionProfile & function = luaFunctionProfiles[i];
+      const LuaScriptProfile & profile = luaScriptProfiles[function.script];
+      snprintf(line, sizeof(line), "  %c %-9s %s:%d %u, %u, %u", profile.kind, profile.name, function.source, function.line,
+               (unsigned)function.calls, (unsigned)(function.ticks / 2), (unsigned)function.instructions);
+      print(line);
+    }
+  }
+}
+
+static void traceLine(const char * line)
+{
+  TRACE("%s", line);
+}
+
+void luaProfilerTrace()
+{
+  luaProfilerReport(traceLine);
+}
+
+#endif // defined(LUA_PROFILER)
@@ -322,7 +322,10 @@ class LuaWidgetFactory: public WidgetFactory
         l_pushtableint(option->name, persistentData->options[i].signedValue);
       }
 
-      if (lua_pcall(lsWidgets, 2, 1, 0) != 0) {
+      LUA_PROFILER_START(LUA_PROFILE_WIDGET, getName());
+      int result = lua_pcall(lsWidgets, 2, 1, 0);
+      LUA_PROFILER_STOP();
+      if (result != 0) {
         TRACE("Error in widget %s create() function: %s", getName(), lua_tostring(lsWidgets, -1));
       }
       int widgetData = luaL_ref(lsWidgets, LUA_REGISTRYINDEX);
@@ -352,7 +355,10 @@ void LuaWidget::update()
     l_pushtableint(option->name, persistentData->options[i].signedValue);
   }
 
-  if (lua_pcall(lsWidgets, 2, 0, 0) != 0) {
+  LUA_PROFILER_START(LUA_PROFILE_WIDGET, factory->getName());
+  int result = lua_pcall(lsWidgets, 2, 0, 0);
+  LUA_PROFILER_STOP();
+  if (result != 0) {
     setErrorMessage("update()");
   }
 }
@@ -387,7 +393,10 @@ void LuaWidget::refresh()
   LuaWidgetFactory * factory = (LuaWidgetFactory *)this->factory;
   lua_rawgeti(lsWidgets, LUA_REGISTRYINDEX, factory->refreshFunction);
   lua_rawgeti(lsWidgets, LUA_REGISTRYINDEX, widgetData);
-  if (lua_pcall(lsWidgets, 1, 0, 0) != 0) {
+  LUA_PROFILER_START(LUA_PROFILE_WIDGET, factory->getName());
+  int result = lua_pcall(lsWidgets, 1, 0, 0);
+  LUA_PROFILER_STOP();
+  if (result != 0) {
     setErrorMessage("refresh()");
   }
 }
@@ -401,7 +410,10 @@ void LuaWidget::background()
   if (factory->backgroundFunction) {
     lua_rawgeti(lsWidgets, LUA_REGISTRYINDEX, factory->backgroundFunction);
     lua_rawgeti(lsWidgets, LUA_REGISTRYINDEX, widgetData);
-    if (lua_pcall(lsWidgets, 1, 0, 0) != 0) {
+    LUA_PROFILER_START(LUA_PROFILE_WIDGET, factory->getName());
+    int result = lua_pcall(lsWidgets, 1, 0, 0);
+    LUA_PROFILER_STOP();
+    if (result != 0) {
       setErrorMessage("background()");
     }
   }
@@ -537,6 +549,10 @@ void luaInitThemesAndWidgets()
     // install our panic handler
     lua_atpanic(lsWidgets, &custom_lua_atpanic);
 
+#if defined(LUA_PROFILER)
+    luaProfilerAttach(lsWidgets);
+#endif
+
 #if defined(LUA_ALLOCATOR_TRACER)
     lua_sethook(lsWidgets, luaHook, LUA_MASKLINE, 0);
 #endif
@@ -194,6 +194,8 @@ void guiMain(event_t evt)
   // run Lua scripts that don't use LCD (to use CPU time while LCD DMA is running)
   DEBUG_TIMER_START(debugTimerLuaBg);
   luaTask(0, RUN_MIX_SCRIPT | RUN_FUNC_SCRIPT | RUN_TELEM_BG_SCRIPT, false);
+  // incremental Lua GC, within a time budget, while the LCD DMA is still running
+  luaDoGcIdle();
   DEBUG_TIMER_STOP(debugTimerLuaBg);
   // wait for LCD DMA to finish before continuing, because code from this point
   // is allowed to change the contents of LCD buffer
@@ -231,6 +233,8 @@ void guiMain(event_t evt)
 
       static bool popupDisplayed = false;
       if (warn || menu) {
+        // the popup overlay stays in the frame buffers until the main view is fully redrawn
+        invalidateCustomScreens();
         if (popupDisplayed == false) {
           menuHandlers[menuLevel](EVT_REFRESH);
           lcdDrawBlackOverlay();
@@ -341,6 +345,8 @@ void guiMain(event_t evt)
 
   // run Lua scripts that don't use LCD (to use CPU time while LCD DMA is running)
   luaTask(0, RUN_MIX_SCRIPT | RUN_FUNC_SCRIPT | RUN_TELEM_BG_SCRIPT, false);
+  // incremental Lua GC, within a time budget, while the LCD DMA is still running
+  luaDoGcIdle();
 
   t0 = get_tmr10ms() - t0;
   if (t0 > maxLuaDuration) {
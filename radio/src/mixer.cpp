@@ -20,6 +20,9 @@
 
 #include "opentx.h"
 #include "timers.h"
+#if defined(CPUARM)
+#include "mixer_plan.h"
+#endif
 
 #if defined(VIRTUAL_INPUTS)
   int8_t  virtualInputsTrims[NUM_INPUTS];
@@ -45,6 +48,20 @@ int16_t calibratedAnalogs[NUM_CALIBRATED_ANALOGS];
 int16_t channelOutputs[MAX_OUTPUT_CHANNELS] = {0};
 int16_t ex_chans[MAX_OUTPUT_CHANNELS] = {0}; // Outputs (before LIMITS) of the last perMain;
 
+#if defined(HOT_MODEL_SWITCH)
+// outputs blend after a model switch without pulses interruption
+static int16_t blendOrigin[MAX_OUTPUT_CHANNELS];
+static tmr10ms_t blendStart;
+static uint16_t blendDuration = 0;
+
+void startOutputsBlend(uint16_t duration10ms)
+{
+  memcpy(blendOrigin, channelOutputs, sizeof(blendOrigin));
+  blendStart = get_tmr10ms();
+  blendDuration = duration10ms;
+}
+#endif
+
 #if defined(HELI)
 int16_t cyc_anas[3] = {0};
 #endif
@@ -148,7 +165,11 @@ int expo(int x, int k)
   return neg ? -y : y;
 }
 
+#if defined(CPUARM)
+static void evalExpos(int16_t * anas, uint8_t mode, bool preview APPLY_EXPOS_EXTRA_PARAMS)
+#else
 void applyExpos(int16_t * anas, uint8_t mode APPLY_EXPOS_EXTRA_PARAMS)
+#endif
 {
 #if !defined(VIRTUAL_INPUTS)
   int16_t anas2[NUM_INPUTS]; // values before expo, to ensure same expo base when multiple expo lines are used
@@ -161,8 +182,23 @@ void applyExpos(int16_t * anas, uint8_t mode APPLY_EXPOS_EXTRA_PARAMS)
 #if defined(BOLD_FONT)
     if (mode==e_perout_mode_normal) swOn[i].activeExpo = false;
 #endif
+#if defined(CPUARM)
+    ExpoPlanOp line;
+    ExpoPlanOp * ed = &line;
+    if (preview) {
+      // the plan belongs to the mixer task
+      ExpoData * data = expoAddress(i);
+      if (!EXPO_VALID(data)) break; // end of list
+      compileExpo(line, data);
+    }
+    else {
+      if (i >= mixerPlan.expos) break; // end of list
+      ed = &mixerPlan.expo[i];
+    }
+#else
     ExpoData * ed = expoAddress(i);
     if (!EXPO_VALID(ed)) break; // end of list
+#endif
     if (ed->chn == cur_chn)
       continue;
     if (ed->flightModes & (1<<mixerCurrentFlightMode))
@@ -173,9 +209,12 @@ void applyExpos(int16_t * anas, uint8_t mode APPLY_EXPOS_EXTRA_PARAMS)
       if (ed->srcRaw == ovwrIdx) {
         v = ovwrValue;
       }
+      else if (ed->source) {
+        v = limit<int32_t>(-1024, *ed->source, 1024);
+      }
       else {
         v = getValue(ed->srcRaw);
-        if (ed->srcRaw >= MIXSRC_FIRST_TELEM && ed->scale > 0) {
+        if (ed->flags & EXPO_OP_TELEM_SCALE) {
           v = (v * 1024) / convertTelemValue(ed->srcRaw-MIXSRC_FIRST_TELEM+1, ed->scale);
         }
         v = limit<int32_t>(-1024, v, 1024);
@@ -206,7 +245,7 @@ void applyExpos(int16_t * anas, uint8_t mode APPLY_EXPOS_EXTRA_PARAMS)
 
         //========== WEIGHT ===============
 #if defined(CPUARM)
-        int32_t weight = GET_GVAR_PREC1(ed->weight, MIN_EXPO_WEIGHT, 100, mixerCurrentFlightMode);
+        int32_t weight = (ed->flags & EXPO_OP_WEIGHT_GVAR) ? GET_GVAR_PREC1(ed->weight, MIN_EXPO_WEIGHT, 100, mixerCurrentFlightMode) : ed->weight;
         v = div_and_round((int32_t)v * weight, 1000);
 #else
         int16_t weight = GET_GVAR(ed->weight, MIN_EXPO_WEIGHT, 100, mixerCurrentFlightMode);
@@ -216,16 +255,11 @@ void applyExpos(int16_t * anas, uint8_t mode APPLY_EXPOS_EXTRA_PARAMS)
 
 #if defined(VIRTUAL_INPUTS)
         //========== OFFSET ===============
-        int32_t offset = GET_GVAR_PREC1(ed->offset, -100, 100, mixerCurrentFlightMode);
+        int32_t offset = (ed->flags & EXPO_OP_OFFSET_GVAR) ? GET_GVAR_PREC1(ed->offset, -100, 100, mixerCurrentFlightMode) : ed->offset;
         if (offset) v += div_and_round(calc100toRESX(offset), 10);
 
         //========== TRIMS ================
-        if (ed->carryTrim < TRIM_ON)
-          virtualInputsTrims[cur_chn] = -ed->carryTrim - 1;
-        else if (ed->carryTrim == TRIM_ON && ed->srcRaw >= MIXSRC_Rud && ed->srcRaw <= MIXSRC_Ail)
-          virtualInputsTrims[cur_chn] = ed->srcRaw - MIXSRC_Rud;
-        else
-          virtualInputsTrims[cur_chn] = -1;
+        virtualInputsTrims[cur_chn] = ed->trim;
 #endif
 
         anas[cur_chn] = v;
@@ -234,6 +268,18 @@ void applyExpos(int16_t * anas, uint8_t mode APPLY_EXPOS_EXTRA_PARAMS)
   }
 }
 
+#if defined(CPUARM)
+void applyExpos(int16_t * anas, uint8_t mode APPLY_EXPOS_EXTRA_PARAMS)
+{
+  evalExpos(anas, mode, false APPLY_EXPOS_EXTRA_ARGS);
+}
+
+void applyExposPreview(int16_t * anas, uint8_t mode APPLY_EXPOS_EXTRA_PARAMS)
+{
+  evalExpos(anas, mode, true APPLY_EXPOS_EXTRA_ARGS);
+}
+#endif
+
 // #define PREVENT_ARITHMETIC_OVERFLOW
 // because of optimizations the reserves before overruns occurs is only the half
 // this defines enables some checks the greatly improves this situation
@@ -267,12 +313,29 @@ int16_t applyLimits(uint8_t channel, int32_t value)
   }
 #endif
 
+#if defined(CPUARM)
+  const LimitPlanOp & op = mixerPlan.limit[channel];
+  int16_t ofs, lim_p, lim_n;
+  if (isMixerPlanValid() && !(op.flags & LIMIT_OP_GVARS)) {
+    ofs   = op.ofs;
+    lim_p = op.max;
+    lim_n = op.min;
+  }
+  else {
+    ofs   = LIMIT_OFS_RESX(lim);
+    lim_p = LIMIT_MAX_RESX(lim);
+    lim_n = LIMIT_MIN_RESX(lim);
+    if (ofs > lim_p) ofs = lim_p;
+    if (ofs < lim_n) ofs = lim_n;
+  }
+#else
   int16_t ofs   = LIMIT_OFS_RESX(lim);
   int16_t lim_p = LIMIT_MAX_RESX(lim);
   int16_t lim_n = LIMIT_MIN_RESX(lim);
 
   if (ofs > lim_p) ofs = lim_p;
   if (ofs < lim_n) ofs = lim_n;
+#endif
 
   // because the rescaling optimization would reduce the calculation reserve we activate this for all builds
   // it increases the calculation reserve from factor 20,25x to 32x, which it slightly better as original
@@ -450,7 +513,7 @@ getvalue_t getValue(mixsrc_t i)
   else if (i <= MIXSRC_LAST_TELEM) {
     i -= MIXSRC_FIRST_TELEM;
     div_t qr = div(i, 3);
-    TelemetryItem & telemetryItem = telemetryItems[qr.quot];
+    TelemetryValue telemetryItem = getPublishedTelemetryValue(qr.quot);
     switch (qr.rem) {
       case 1:
         return telemetryItem.valueMin;
@@ -501,6 +564,10 @@ getvalue_t getValue(mixsrc_t i)
 
 void evalInputs(uint8_t mode)
 {
+#if defined(CPUARM)
+  checkMixerPlan();
+#endif
+
   BeepANACenter anaCenter = 0;
 
 #if defined(HELI) && !defined(VIRTUAL_INPUTS)
@@ -667,10 +734,60 @@ int getSourceTrimValue(int source, int stickValue=0)
 }
 #endif
 
+#if defined(CPUARM)
+// Version of the model data the mixer plan and the telemetry tables were built
+// from, bumped on every model change.
+uint8_t modelDataVersion = 1;
+
+void modelDataChanged()
+{
+  if (++modelDataVersion == 0) {
+    // tables with an old version could match again after the wrap
+    mixerPlan.version = 0;
+    telemetrySensorsIndex.version = 0;
+    telemetryEvalOrder.version = 0;
+    modelDataVersion = 1;
+  }
+}
+
+// The curve / weight / offset / differential stage of a mix line
+static int32_t evalMixLineOutput(MixPlanOp & md, getvalue_t v, bool applyOffsetAndCurve)
+{
+  int32_t weight = (md.flags & MIX_OP_WEIGHT_GVAR) ? GET_GVAR_PREC1(md.weight, GV_RANGELARGE_NEG, GV_RANGELARGE, mixerCurrentFlightMode) : md.weight;
+  int32_t offset = 0;
+  if (applyOffsetAndCurve) {
+    offset = (md.flags & MIX_OP_OFFSET_GVAR) ? GET_GVAR_PREC1(md.offset, GV_RANGELARGE_NEG, GV_RANGELARGE, mixerCurrentFlightMode) : md.offset;
+  }
+  int32_t curveParam = (md.flags & MIX_OP_CURVE_GVAR) ? GET_GVAR_PREC1(md.curveParam, -100, 100, mixerCurrentFlightMode) : md.curveParam;
+
+  //========== CURVES ===============
+  if (applyOffsetAndCurve && md.curve.type != CURVE_REF_DIFF && md.curve.value) {
+    v = applyCurve(v, md.curve);
+  }
+
+  //========== WEIGHT ===============
+  int32_t dv = (int32_t)v * calc100to256_16Bits(weight);
+  dv = div_and_round(dv, 10);
+
+  //========== OFFSET / AFTER ===============
+  if (offset) {
+    dv += div_and_round(calc100toRESX_16Bits(offset), 10) << 8;
+  }
+
+  //========== DIFFERENTIAL =========
+  if (md.curve.type == CURVE_REF_DIFF && md.curve.value) {
+    dv = applyCurve(dv, md.curve);
+  }
+
+  return dv;
+}
+#endif
+
 uint8_t mixerCurrentFlightMode;
-void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
+// Only the given channels are evaluated, the others keep their values from the previous run
+void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms, bitfield_channels_t channels)
 {
-  evalInputs(mode);
+  evalInputs(mode); // also brings the mixer plan up to date with the model
 
   if (tick10ms) evalLogicalSwitches(mode==e_perout_mode_normal);
 
@@ -758,14 +875,21 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
   }
 #endif
 
-  memclear(chans, sizeof(chans));        // All outputs to 0
+  if (channels == (bitfield_channels_t)-1) {
+    memclear(chans, sizeof(chans));        // All outputs to 0
+  }
+  else {
+    for (uint8_t i=0; i<MAX_OUTPUT_CHANNELS; i++) {
+      if (channels & ((bitfield_channels_t)1 << i)) chans[i] = 0;
+    }
+  }
 
   //========== MIXER LOOP ===============
   uint8_t lv_mixWarning = 0;
 
   uint8_t pass = 0;
 
-  bitfield_channels_t dirtyChannels = (bitfield_channels_t)-1; // all dirty when mixer starts
+  bitfield_channels_t dirtyChannels = channels; // all dirty when mixer starts
 
   do {
 
@@ -777,16 +901,26 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
       if (mode==e_perout_mode_normal && pass==0) swOn[i].activeMix = 0;
 #endif
 
+#if defined(CPUARM)
+      if (i >= mixerPlan.mixes) break;
+
+      MixPlanOp * md = &mixerPlan.mix[i];
+#else
       MixData *md = mixAddress(i);
 
       if (md->srcRaw == 0) break;
+#endif
 
       mixsrc_t stickIndex = md->srcRaw - MIXSRC_Rud;
 
       if (!(dirtyChannels & ((bitfield_channels_t)1 << md->destCh))) continue;
 
       // if this is the first calculation for the destination channel, initialize it with 0 (otherwise would be random)
+#if defined(CPUARM)
+      if (md->flags & MIX_OP_FIRST_OF_CHANNEL) {
+#else
       if (i == 0 || md->destCh != (md-1)->destCh) {
+#endif
         chans[md->destCh] = 0;
       }
 
@@ -802,9 +936,8 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
 
 #if defined(LUA_MODEL_SCRIPTS)
       // disable mixer if Lua script is used as source and script was killed
-      if (mixEnabled && md->srcRaw >= MIXSRC_FIRST_LUA && md->srcRaw <= MIXSRC_LAST_LUA) {
-        div_t qr = div(md->srcRaw-MIXSRC_FIRST_LUA, MAX_SCRIPT_OUTPUTS);
-        if (scriptInternalData[qr.quot].state != SCRIPT_OK) {
+      if (mixEnabled && (md->flags & MIX_OP_LUA_SOURCE)) {
+        if (scriptInternalData[md->param].state != SCRIPT_OK) {
           MIXER_LINE_DISABLE();
         }
       }
@@ -818,7 +951,11 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
           continue;
         }
         else {
+#if defined(CPUARM)
+          v = (md->source ? *md->source : getValue(md->srcRaw));
+#else
           v = getValue(md->srcRaw);
+#endif
         }
 #else
         if (!mixEnabled || stickIndex >= NUM_STICKS || (stickIndex == THR_STICK && g_model.thrTrim)) {
@@ -838,7 +975,11 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
 #endif
         {
           mixsrc_t srcRaw = MIXSRC_Rud + stickIndex;
+#if defined(CPUARM)
+          v = (md->source ? *md->source : getValue(srcRaw));
+#else
           v = getValue(srcRaw);
+#endif
           srcRaw -= MIXSRC_CH1;
           if (srcRaw<=MIXSRC_LAST_CH-MIXSRC_CH1 && md->destCh != srcRaw) {
             if (dirtyChannels & ((bitfield_channels_t)1 << srcRaw) & (passDirtyChannels|~(((bitfield_channels_t) 1 << md->destCh)-1)))
@@ -899,7 +1040,11 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
 
         //========== TRIMS ================
         if (!(mode & e_perout_mode_notrims)) {
-#if defined(VIRTUAL_INPUTS)
+#if defined(CPUARM)
+          if (md->flags & MIX_OP_TRIM) {
+            v += getSourceTrimValue(md->srcRaw, v);
+          }
+#elif defined(VIRTUAL_INPUTS)
           if (md->carryTrim == 0) {
             v += getSourceTrimValue(md->srcRaw, v);
           }
@@ -922,10 +1067,7 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
         }
       }
 
-#if defined(CPUARM)
-      int32_t weight = GET_GVAR_PREC1(MD_WEIGHT(md), GV_RANGELARGE_NEG, GV_RANGELARGE, mixerCurrentFlightMode);
-      weight = calc100to256_16Bits(weight);
-#else
+#if !defined(CPUARM)
       // saves 12 bytes code if done here and not together with weight; unknown reason
       int16_t weight = GET_GVAR(MD_WEIGHT(md), GV_RANGELARGE_NEG, GV_RANGELARGE, mixerCurrentFlightMode);
       weight = calc100to256_16Bits(weight);
@@ -971,40 +1113,25 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
         }
       }
 
-      //========== CURVES ===============
 #if defined(CPUARM)
-      if (apply_offset_and_curve && md->curve.type != CURVE_REF_DIFF && md->curve.value) {
-        v = applyCurve(v, md->curve);
-      }
+      //========== CURVES / WEIGHT / OFFSET / DIFFERENTIAL ===============
+      int32_t dv = evalMixLineOutput(*md, v, apply_offset_and_curve);
 #else
+      //========== CURVES ===============
       if (apply_offset_and_curve && md->curveParam && md->curveMode == MODE_CURVE) {
         v = applyCurve(v, md->curveParam);
       }
-#endif
 
       //========== WEIGHT ===============
       int32_t dv = (int32_t)v * weight;
-#if defined(CPUARM)
-      dv = div_and_round(dv, 10);
-#endif
 
       //========== OFFSET / AFTER ===============
       if (apply_offset_and_curve) {
-#if defined(CPUARM)
-        int32_t offset = GET_GVAR_PREC1(MD_OFFSET(md), GV_RANGELARGE_NEG, GV_RANGELARGE, mixerCurrentFlightMode);
-        if (offset) dv += div_and_round(calc100toRESX_16Bits(offset), 10) << 8;
-#else
         int16_t offset = GET_GVAR(MD_OFFSET(md), GV_RANGELARGE_NEG, GV_RANGELARGE, mixerCurrentFlightMode);
         if (offset) dv += int32_t(calc100toRESX_16Bits(offset)) << 8;
-#endif
       }
 
       //========== DIFFERENTIAL =========
-#if defined(CPUARM)
-      if (md->curve.type == CURVE_REF_DIFF && md->curve.value) {
-        dv = applyCurve(dv, md->curve);
-      }
-#else
       if (md->curveMode == MODE_DIFFERENTIAL) {
         // @@@2 also recalculate curveParam to a 256 basis which ease the calculation later a lot
         int16_t curveParam = calc100to256(GET_GVAR(md->curveParam, -100, 100, mixerCurrentFlightMode));
@@ -1022,7 +1149,11 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
           *ptr = dv;
 #if defined(BOLD_FONT)
           if (mode==e_perout_mode_normal) {
+#if defined(CPUARM)
+            for (uint8_t m=i-1; m<MAX_MIXERS && mixerPlan.mix[m].destCh==md->destCh; m--)
+#else
             for (uint8_t m=i-1; m<MAX_MIXERS && mixAddress(m)->destCh==md->destCh; m--)
+#endif
               swOn[m].activeMix = false;
           }
 #endif
@@ -1086,7 +1217,10 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
 
   } while (++pass < 5 && dirtyChannels);
 
-  mixWarning = lv_mixWarning;
+  // the warnings are only raised by the active flight mode
+  if (mode == e_perout_mode_normal) {
+    mixWarning = lv_mixWarning;
+  }
 }
 
 int32_t sum_chans512[MAX_OUTPUT_CHANNELS] = {0};
@@ -1112,6 +1246,11 @@ void evalMixes(uint8_t tick10ms)
 
   LS_RECURSIVE_EVALUATION_RESET();
 
+#if defined(CPUARM)
+  // in the mixer task, with mixerMutex held
+  checkMixerPlan();
+#endif
+
   uint8_t fm = getFlightMode();
 
   if (lastFlightMode != fm) {
@@ -1156,6 +1295,45 @@ void evalMixes(uint8_t tick10ms)
 
   int32_t weight = 0;
   if (flightModesFade) {
+#if defined(CPUARM)
+    // The active flight mode (or the first fading one when it has already
+    // faded in) is evaluated first, completely. Then only the channels which
+    // depend on the flight mode are evaluated again for the other fading
+    // flight modes, the other channels keep their value from the first run
+    uint8_t first = fm;
+    if (!(flightModesFade & ((ACTIVE_PHASES_TYPE)1 << fm))) {
+      for (first=0; !(flightModesFade & ((ACTIVE_PHASES_TYPE)1 << first)); first++);
+    }
+    for (uint8_t p=0; p<MAX_FLIGHT_MODES; p++) {
+      if (flightModesFade & ((ACTIVE_PHASES_TYPE)1 << p)) {
+        weight += fp_act[p];
+      }
+    }
+    LS_RECURSIVE_EVALUATION_RESET();
+    mixerCurrentFlightMode = first;
+    evalFlightModeMixes(first==fm ? e_perout_mode_normal : e_perout_mode_inactive_flight_mode, first==fm ? tick10ms : 0);
+    bitfield_channels_t flightModeChannels = mixerPlan.flightModeChannels;
+    for (uint8_t i=0; i<MAX_OUTPUT_CHANNELS; i++) {
+      if (flightModeChannels & ((bitfield_channels_t)1 << i))
+        sum_chans512[i] = (chans[i] >> 4) * fp_act[first];
+      else
+        sum_chans512[i] = (chans[i] >> 4) * weight;
+    }
+    LS_RECURSIVE_EVALUATION_RESET();
+    if (flightModeChannels) {
+      for (uint8_t p=0; p<MAX_FLIGHT_MODES; p++) {
+        if (p != first && (flightModesFade & ((ACTIVE_PHASES_TYPE)1 << p))) {
+          mixerCurrentFlightMode = p;
+          evalFlightModeMixes(e_perout_mode_inactive_flight_mode, 0, flightModeChannels);
+          for (uint8_t i=0; i<MAX_OUTPUT_CHANNELS; i++) {
+            if (flightModeChannels & ((bitfield_channels_t)1 << i))
+              sum_chans512[i] += (chans[i] >> 4) * fp_act[p];
+          }
+          LS_RECURSIVE_EVALUATION_RESET();
+        }
+      }
+    }
+#else
     memclear(sum_chans512, sizeof(sum_chans512));
     for (uint8_t p=0; p<MAX_FLIGHT_MODES; p++) {
       LS_RECURSIVE_EVALUATION_RESET();
@@ -1168,6 +1346,7 @@ void evalMixes(uint8_t tick10ms)
       }
       LS_RECURSIVE_EVALUATION_RESET();
     }
+#endif
     assert(weight);
     mixerCurrentFlightMode = fm;
   }
@@ -1195,6 +1374,16 @@ void evalMixes(uint8_t tick10ms)
   }
 
   //========== LIMITS ===============
+#if defined(HOT_MODEL_SWITCH)
+  uint16_t blendElapsed = 0;
+  if (blendDuration) {
+    blendElapsed = (tmr10ms_t)(get_tmr10ms() - blendStart);
+    if (blendElapsed >= blendDuration) {
+      blendDuration = 0;
+    }
+  }
+#endif
+
   for (uint8_t i=0; i<MAX_OUTPUT_CHANNELS; i++) {
     // chans[i] holds data from mixer.   chans[i] = v*weight => 1024*256
     // later we multiply by the limit (up to 100) and then we need to normalize
@@ -1211,6 +1400,12 @@ void evalMixes(uint8_t tick10ms)
 
     int16_t value = applyLimits(i, q);  // applyLimits will remove the 256 100% basis
 
+#if defined(HOT_MODEL_SWITCH)
+    if (blendDuration) {
+      value = blendOrigin[i] + (int32_t)(value - blendOrigin[i]) * blendElapsed / blendDuration;
+    }
+#endif
+
     cli();
     channelOutputs[i] = value;  // copy consistent word to int-level
     sei();
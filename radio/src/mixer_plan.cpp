@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "opentx.h"
+#include "mixer_plan.h"
+
+#if defined(HELI)
+extern int16_t cyc_anas[3];
+#endif
+
+MixerPlan mixerPlan;
+
+static const int16_t sourceMaxValue = 1024;
+
+// Same values than getValue() for the sources which are simply read from an array
+static const int16_t * getSourcePointer(mixsrc_t i)
+{
+  if (i >= MIXSRC_FIRST_INPUT && i <= MIXSRC_LAST_INPUT)
+    return &anas[i-MIXSRC_FIRST_INPUT];
+  else if (i >= MIXSRC_FIRST_STICK && i <= MIXSRC_LAST_POT+NUM_MOUSE_ANALOGS)
+    return &calibratedAnalogs[i-MIXSRC_Rud];
+  else if (i == MIXSRC_MAX)
+    return &sourceMaxValue;
+#if defined(HELI)
+  else if (i >= MIXSRC_CYC1 && i <= MIXSRC_CYC3)
+    return &cyc_anas[i-MIXSRC_CYC1];
+#endif
+  else if (i >= MIXSRC_CH1 && i <= MIXSRC_LAST_CH)
+    return &ex_chans[i-MIXSRC_CH1];
+  else
+    return NULL;
+}
+
+static bool isGVarField(int16_t x, int16_t min, int16_t max)
+{
+#if defined(GVARS)
+  return GV_IS_GV_VALUE(x, min, max);
+#else
+  return false;
+#endif
+}
+
+// GET_GVAR_PREC1() doesn't depend on the flight mode when the field is not a GVAR
+#define PLAN_FIELD_PREC1(x, min, max)  GET_GVAR_PREC1(x, min, max, 0)
+
+void compileExpo(ExpoPlanOp & op, const ExpoData * ed)
+{
+  op.srcRaw = ed->srcRaw;
+  op.source = getSourcePointer(ed->srcRaw);
+  op.swtch = ed->swtch;
+  op.flightModes = ed->flightModes;
+  op.scale = ed->scale;
+  op.curve = ed->curve;
+  op.chn = ed->chn;
+  op.mode = ed->mode;
+  op.weight = ed->weight;
+  op.offset = ed->offset;
+  op.flags = 0;
+
+  if (ed->srcRaw >= MIXSRC_FIRST_TELEM && ed->scale > 0)
+    op.flags |= EXPO_OP_TELEM_SCALE;
+
+  if (isGVarField(op.weight, MIN_EXPO_WEIGHT, 100))
+    op.flags |= EXPO_OP_WEIGHT_GVAR;
+  else
+    op.weight = PLAN_FIELD_PREC1(op.weight, MIN_EXPO_WEIGHT, 100);
+
+  if (isGVarField(op.offset, -100, 100))
+    op.flags |= EXPO_OP_OFFSET_GVAR;
+  else
+    op.offset = PLAN_FIELD_PREC1(op.offset, -100, 100);
+
+  if (ed->carryTrim < TRIM_ON)
+    op.trim = -ed->carryTrim - 1;
+  else if (ed->carryTrim == TRIM_ON && ed->srcRaw >= MIXSRC_Rud && ed->srcRaw <= MIXSRC_Ail)
+    op.trim = ed->srcRaw - MIXSRC_Rud;
+  else
+    op.trim = -1;
+}
+
+static void compileExpos()
+{
+  uint8_t count = 0;
+
+  for (uint8_t i=0; i<MAX_EXPOS; i++) {
+    ExpoData * ed = expoAddress(i);
+    if (!EXPO_VALID(ed)) break; // end of list
+    compileExpo(mixerPlan.expo[count++], ed);
+  }
+
+  mixerPlan.expos = count;
+}
+
+static void compileMixes()
+{
+  uint8_t count = 0;
+
+  for (uint8_t i=0; i<MAX_MIXERS; i++) {
+    MixData * md = mixAddress(i);
+    if (md->srcRaw == 0) break;
+
+    MixPlanOp & op = mixerPlan.mix[count++];
+    op.srcRaw = md->srcRaw;
+    op.source = getSourcePointer(md->srcRaw);
+    op.swtch = md->swtch;
+    op.flightModes = md->flightModes;
+    op.curve = md->curve;
+    op.destCh = md->destCh;
+    op.mltpx = md->mltpx;
+    op.mixWarn = md->mixWarn;
+    op.delayUp = md->delayUp;
+    op.delayDown = md->delayDown;
+    op.speedUp = md->speedUp;
+    op.speedDown = md->speedDown;
+    op.weight = MD_WEIGHT(md);
+    op.offset = MD_OFFSET(md);
+    op.curveParam = md->curve.value;
+    op.param = 0;
+    op.flags = 0;
+
+    if (i == 0 || md->destCh != (md-1)->destCh)
+      op.flags |= MIX_OP_FIRST_OF_CHANNEL;
+    if (md->carryTrim == 0 && ((md->srcRaw >= MIXSRC_Rud && md->srcRaw <= MIXSRC_Ail) || (md->srcRaw >= MIXSRC_FIRST_INPUT && md->srcRaw <= MIXSRC_LAST_INPUT)))
+      op.flags |= MIX_OP_TRIM;
+
+#if defined(LUA_MODEL_SCRIPTS)
+    if (md->srcRaw >= MIXSRC_FIRST_LUA && md->srcRaw <= MIXSRC_LAST_LUA) {
+      op.flags |= MIX_OP_LUA_SOURCE;
+      op.param = (md->srcRaw - MIXSRC_FIRST_LUA) / MAX_SCRIPT_OUTPUTS;
+    }
+#endif
+
+    if (isGVarField(op.weight, GV_RANGELARGE_NEG, GV_RANGELARGE))
+      op.flags |= MIX_OP_WEIGHT_GVAR;
+    else
+      op.weight = PLAN_FIELD_PREC1(op.weight, GV_RANGELARGE_NEG, GV_RANGELARGE);
+
+    if (isGVarField(op.offset, GV_RANGELARGE_NEG, GV_RANGELARGE))
+      op.flags |= MIX_OP_OFFSET_GVAR;
+    else
+      op.offset = PLAN_FIELD_PREC1(op.offset, GV_RANGELARGE_NEG, GV_RANGELARGE);
+
+    if (op.curve.type != CURVE_REF_DIFF && op.curve.type != CURVE_REF_EXPO)
+      op.curveParam = 0;
+    else if (isGVarField(op.curveParam, -100, 100))
+      op.flags |= MIX_OP_CURVE_GVAR;
+    else
+      op.curveParam = PLAN_FIELD_PREC1(op.curveParam, -100, 100);
+  }
+
+  mixerPlan.mixes = count;
+}
+
+static void compileLimits()
+{
+  for (uint8_t i=0; i<MAX_OUTPUT_CHANNELS; i++) {
+    LimitData * lim = limitAddress(i);
+    LimitPlanOp & op = mixerPlan.limit[i];
+    if (isGVarField(lim->offset, -1000, 1000) || isGVarField(lim->min, -GV_RANGELARGE, GV_RANGELARGE) || isGVarField(lim->max, -GV_RANGELARGE, GV_RANGELARGE)) {
+      op.flags = LIMIT_OP_GVARS;
+    }
+    else {
+      op.flags = 0;
+      op.min = LIMIT_MIN_RESX(lim);
+      op.max = LIMIT_MAX_RESX(lim);
+      op.ofs = LIMIT_OFS_RESX(lim);
+      if (op.ofs > op.max) op.ofs = op.max;
+      if (op.ofs < op.min) op.ofs = op.min;
+    }
+  }
+}
+
+// A trim has the same value in all flight modes when they all use the trim of FM0
+static bool isTrimShared(int8_t idx)
+{
+  if (idx < 0)
+    return true;
+  for (uint8_t p=1; p<MAX_FLIGHT_MODES; p++) {
+    if (flightModeAddress(p)->trim[idx].mode != 0)
+      return false;
+  }
+  return true;
+}
+
+static bool isFlightModeIndependentSwitch(swsrc_t swtch)
+{
+  swtch = abs(swtch);
+  return swtch == SWSRC_NONE || (swtch >= SWSRC_FIRST_SWITCH && swtch <= SWSRC_LAST_SWITCH);
+}
+
+static bool isFlightModeIndependentSource(mixsrc_t src, uint32_t inputs, bitfield_channels_t channels)
+{
+  if (src >= MIXSRC_FIRST_INPUT && src <= MIXSRC_LAST_INPUT)
+    return !(inputs & ((uint32_t)1 << (src - MIXSRC_FIRST_INPUT)));
+  else if (src >= MIXSRC_CH1 && src <= MIXSRC_LAST_CH)
+    return !(channels & ((bitfield_channels_t)1 << (src - MIXSRC_CH1)));
+  else
+    return (src >= MIXSRC_FIRST_STICK && src <= MIXSRC_LAST_POT) ||
+           (src == MIXSRC_MAX) ||
+           (src >= MIXSRC_FIRST_SWITCH && src <= MIXSRC_LAST_SWITCH) ||
+           (src >= MIXSRC_FIRST_TRAINER && src <= MIXSRC_LAST_TRAINER) ||
+           (src >= MIXSRC_FIRST_TELEM);
+}
+
+// Finds the channels which value may depend on the flight mode: lines enabled
+// in some flight modes only, GVARs, trims which are not shared between flight
+// modes, logical switches, and everything computed from them
+static void compileFlightModeChannels()
+{
+  uint32_t inputs = 0;
+  uint32_t trimmedInputs = 0;   // the trim of an input is added by the mixes which use it
+
+  for (uint8_t i=0; i<mixerPlan.expos; i++) {
+    ExpoPlanOp & op = mixerPlan.expo[i];
+    bool curveGVar = (op.curve.type == CURVE_REF_DIFF || op.curve.type == CURVE_REF_EXPO) && isGVarField(op.curve.value, -100, 100);
+    // the channels used by inputs are read from the last outputs, which are the same for all flight modes
+    bool channelSource = (op.srcRaw >= MIXSRC_CH1 && op.srcRaw <= MIXSRC_LAST_CH);
+    if (op.flightModes || curveGVar || (op.flags & (EXPO_OP_WEIGHT_GVAR|EXPO_OP_OFFSET_GVAR)) ||
+        !isFlightModeIndependentSwitch(op.swtch) ||
+        (!channelSource && !isFlightModeIndependentSource(op.srcRaw, 0, 0))) {
+      inputs |= (uint32_t)1 << op.chn;
+    }
+    if (!isTrimShared(op.trim)) {
+      trimmedInputs |= (uint32_t)1 << op.chn;
+    }
+  }
+
+  bitfield_channels_t channels = 0;
+  bool changed;
+
+  // the channels used as sources are resolved until nothing changes
+  do {
+    changed = false;
+    for (uint8_t i=0; i<mixerPlan.mixes; i++) {
+      MixPlanOp & op = mixerPlan.mix[i];
+      bitfield_channels_t mask = (bitfield_channels_t)1 << op.destCh;
+      if (channels & mask)
+        continue;
+      bool trim = false;
+      if (op.flags & MIX_OP_TRIM) {
+        if (op.srcRaw >= MIXSRC_FIRST_INPUT && op.srcRaw <= MIXSRC_LAST_INPUT)
+          trim = trimmedInputs & ((uint32_t)1 << (op.srcRaw - MIXSRC_FIRST_INPUT));
+        else
+          trim = !isTrimShared(op.srcRaw - MIXSRC_Rud);
+      }
+      if (trim || op.flightModes || op.delayUp || op.delayDown ||
+          (op.flags & (MIX_OP_WEIGHT_GVAR|MIX_OP_OFFSET_GVAR|MIX_OP_CURVE_GVAR|MIX_OP_LUA_SOURCE)) ||
+          !isFlightModeIndependentSwitch(op.swtch) ||
+          !isFlightModeIndependentSource(op.srcRaw, inputs, channels)) {
+        channels |= mask;
+        changed = true;
+      }
+    }
+  } while (changed);
+
+  mixerPlan.flightModeChannels = channels;
+}
+
+void compileMixerPlan()
+{
+  // the model may be edited again while the plan is compiled, the next run will then see another version
+  uint8_t version = modelDataVersion;
+
+  compileExpos();
+  compileMixes();
+  compileLimits();
+  compileFlightModeChannels();
+
+  mixerPlan.version = version;
+}
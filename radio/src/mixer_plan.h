@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _MIXER_PLAN_H_
+#define _MIXER_PLAN_H_
+
+// Mixer execution plan
+//
+// The inputs, mixes and outputs of the current model, decoded once from their
+// packed storage layout into flat arrays: sources are resolved to a pointer on
+// their value when possible, and weights / offsets / curve parameters which are
+// not GVARs are resolved in advance (GVARs fields are kept as they are stored
+// and resolved at each run). The plan is compiled again by evalInputs() the
+// first time it runs after modelDataVersion changes, that is after every model
+// load or edit. Only the mixer task, or the code which pauses it (mixerMutex
+// held, or the mixer task not started yet), evaluates the inputs and the mixes.
+// The menus previews (input curves) decode the lines again with compileExpo()
+// instead.
+//
+// The plan also tells which channels may have a different value from a flight
+// mode to another. During a flight modes fade only these channels have to be
+// evaluated again for each fading flight mode.
+
+enum MixPlanOpFlags {
+  MIX_OP_FIRST_OF_CHANNEL = 0x01,
+  MIX_OP_TRIM = 0x02,               // source trim is added
+  MIX_OP_LUA_SOURCE = 0x04,         // param is the script index
+  MIX_OP_WEIGHT_GVAR = 0x08,
+  MIX_OP_OFFSET_GVAR = 0x10,
+  MIX_OP_CURVE_GVAR = 0x20,
+};
+
+struct MixPlanOp {
+  const int16_t * source;   // NULL when the source goes through getValue()
+  int16_t weight;           // x10, or the GVAR reference
+  int16_t offset;           // x10, or the GVAR reference
+  int16_t curveParam;       // x10 for differential and expo, or the GVAR reference
+  mixsrc_t srcRaw;
+  swsrc_t swtch;
+  uint16_t flightModes;
+  CurveRef curve;
+  uint8_t flags;
+  uint8_t destCh;
+  uint8_t mltpx;
+  uint8_t param;
+  uint8_t mixWarn;
+  uint8_t delayUp;
+  uint8_t delayDown;
+  uint8_t speedUp;
+  uint8_t speedDown;
+};
+
+enum ExpoPlanOpFlags {
+  EXPO_OP_WEIGHT_GVAR = 0x01,
+  EXPO_OP_OFFSET_GVAR = 0x02,
+  EXPO_OP_TELEM_SCALE = 0x04,
+};
+
+struct ExpoPlanOp {
+  const int16_t * source;   // NULL when the source goes through getValue()
+  int16_t weight;           // x10, or the GVAR reference
+  int16_t offset;           // x10, or the GVAR reference
+  mixsrc_t srcRaw;
+  swsrc_t swtch;
+  uint16_t flightModes;
+  uint16_t scale;
+  CurveRef curve;
+  uint8_t chn;
+  uint8_t mode;
+  int8_t trim;              // value of virtualInputsTrims[chn]
+  uint8_t flags;
+};
+
+enum LimitPlanOpFlags {
+  LIMIT_OP_GVARS = 0x01,    // ofs, min and max have to be resolved at each run
+};
+
+struct LimitPlanOp {
+  int16_t ofs;              // RESX, already bounded by min and max
+  int16_t min;              // RESX
+  int16_t max;              // RESX
+  uint8_t flags;
+};
+
+struct MixerPlan {
+  uint8_t version;
+  uint8_t expos;
+  uint8_t mixes;
+  ExpoPlanOp expo[MAX_EXPOS];
+  MixPlanOp mix[MAX_MIXERS];
+  LimitPlanOp limit[MAX_OUTPUT_CHANNELS];
+  bitfield_channels_t flightModeChannels;
+};
+
+extern MixerPlan mixerPlan;
+extern uint8_t modelDataVersion;
+
+void compileMixerPlan();
+void compileExpo(ExpoPlanOp & op, const ExpoData * ed);
+
+inline bool isMixerPlanValid()
+{
+  return mixerPlan.version == modelDataVersion;
+}
+
+inline void checkMixerPlan()
+{
+  if (!isMixerPlanValid()) {
+    compileMixerPlan();
+  }
+}
+
+#endif // _MIXER_PLAN_H_
@@ -1189,7 +1189,7 @@ void checkTHR()
 
   GET_ADC_IF_MIXER_NOT_RUNNING();
 
-  evalInputs(e_perout_mode_notrainer); // let do evalInputs do the job
+  EVAL_INPUTS_IF_MIXER_NOT_RUNNING(e_perout_mode_notrainer); // let do evalInputs do the job
 
   int16_t v = calibratedAnalogs[thrchn];
   if (v <= THRCHK_DEADBAND-1024) {
@@ -1208,7 +1208,7 @@ void checkTHR()
 
     GET_ADC_IF_MIXER_NOT_RUNNING();
 
-    evalInputs(e_perout_mode_notrainer); // let do evalInputs do the job
+    EVAL_INPUTS_IF_MIXER_NOT_RUNNING(e_perout_mode_notrainer); // let do evalInputs do the job
 
     v = calibratedAnalogs[thrchn];
 
@@ -25,6 +25,13 @@
 #include <string.h>
 #include <stddef.h>
 #include <stdlib.h>
+
+#if defined(SIMU) && defined(__SSE2__)
+  #include <emmintrin.h>    // audio_mix.h, it has to come before the CMSIS headers
+#elif defined(SIMU) && defined(__ARM_NEON)
+  #include <arm_neon.h>
+#endif
+
 #include "definitions.h"
 #include "opentx_types.h"
 
@@ -34,6 +41,14 @@
   #define SWITCH_SIMU(a, b)  (b)
 #endif
 
+#if defined(SIMU) && defined(LUA) && !defined(LUA_PROFILER)
+  #define LUA_PROFILER       // the Lua profiler is always available in the simulator
+#endif
+
+#if defined(SDCARD) && !defined(EEPROM) && !defined(EEPROM_RLC) && !defined(SIMU)
+  #define STORAGE_TASK       // the settings and models are written to the SD card by the storage task
+#endif
+
 #if defined(PCBSKY9X)
   #define IS_PCBSKY9X        true
   #define CASE_PCBSKY9X(x)   x,
@@ -682,8 +697,14 @@ extern uint8_t flightModeTransitionLast;
   #define availableMemory() ((unsigned int)((unsigned char *)&_heap_end - heap))
 #endif
 
-void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms);
+void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms, bitfield_channels_t channels=(bitfield_channels_t)-1);
+#if defined(CPUARM)
+  void modelDataChanged();
+#endif
 void evalMixes(uint8_t tick10ms);
+#if defined(HOT_MODEL_SWITCH)
+  void startOutputsBlend(uint16_t duration10ms);
+#endif
 void doMixerCalculations();
 void scheduleNextMixerCalculation(uint8_t module, uint16_t delay);
 
@@ -865,8 +886,14 @@ extern uint16_t lastMixerDuration;
 #endif
 
 void checkLowEEPROM();
+// checkTHR() and checkSwitches() evaluate the inputs themselves only while the
+// mixer is paused; the caller then holds mixerMutex (pauseMixerCalculations())
+// or the mixer task has not run yet
 void checkTHR();
 void checkSwitches();
+#if defined(HOT_MODEL_SWITCH)
+bool isSwitchWarningRequired(const ModelData & model);
+#endif
 void checkAlarm();
 void checkAll();
 
@@ -879,6 +906,12 @@ void getADC();
   #endif
 #endif
 
+#if defined(CPUARM)
+  #define EVAL_INPUTS_IF_MIXER_NOT_RUNNING(mode) do { if (s_pulses_paused) evalInputs(mode); } while(0)
+#else
+  #define EVAL_INPUTS_IF_MIXER_NOT_RUNNING(mode) evalInputs(mode)
+#endif
+
 #include "sbus.h"
 
 void backlightOn();
@@ -908,6 +941,10 @@ template<class t> void SWAP(t & a, t & b) { t tmp = b; b = a; a = tmp; }
   inline void pauseMixerCalculations() { CoEnterMutexSection(mixerMutex); }
   inline void resumeMixerCalculations() { CoLeaveMutexSection(mixerMutex); }
 
+  extern OS_MutexID telemetryMutex;
+  inline void pauseTelemetry() { CoEnterMutexSection(telemetryMutex); }
+  inline void resumeTelemetry() { CoLeaveMutexSection(telemetryMutex); }
+
   inline OS_MutexID createMutex(void) { return CoCreateMutex(); }
   inline StatusType enterMutexSection(OS_MutexID mutexId) { return CoEnterMutexSection(mutexId); }
   inline StatusType leaveMutexSection(OS_MutexID mutexId) { return CoLeaveMutexSection(mutexId); }
@@ -925,6 +962,8 @@ template<class t> void SWAP(t & a, t & b) { t tmp = b; b = a; a = tmp; }
 
   #define pauseMixerCalculations()
   #define resumeMixerCalculations()
+  #define pauseTelemetry()
+  #define resumeTelemetry()
 
   inline OS_MutexID createMutex(void) {
     static OS_MutexID mtxId = 0;
@@ -1105,9 +1144,11 @@ bool moveCurve(uint8_t index, int8_t shift, int8_t custom=0);
 #if defined(CPUARM)
   #define APPLY_EXPOS_EXTRA_PARAMS_INC , uint8_t ovwrIdx=0, int16_t ovwrValue=0
   #define APPLY_EXPOS_EXTRA_PARAMS     , uint8_t ovwrIdx, int16_t ovwrValue
+  #define APPLY_EXPOS_EXTRA_ARGS       , ovwrIdx, ovwrValue
 #else
   #define APPLY_EXPOS_EXTRA_PARAMS_INC
   #define APPLY_EXPOS_EXTRA_PARAMS
+  #define APPLY_EXPOS_EXTRA_ARGS
 #endif
 
 #if defined(CPUARM)
@@ -1116,6 +1157,12 @@ void defaultInputs();
 #endif
 
 void applyExpos(int16_t * anas, uint8_t mode APPLY_EXPOS_EXTRA_PARAMS_INC);
+#if defined(CPUARM)
+// applyExpos() for the menus, the lines are read from the model instead of the mixer plan
+void applyExposPreview(int16_t * anas, uint8_t mode APPLY_EXPOS_EXTRA_PARAMS_INC);
+#else
+  #define applyExposPreview applyExpos
+#endif
 int16_t applyLimits(uint8_t channel, int32_t value);
 
 void evalInputs(uint8_t mode);
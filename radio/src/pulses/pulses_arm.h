@@ -148,6 +148,7 @@ union TrainerPulsesData {
 
 extern TrainerPulsesData trainerPulsesData;
 extern const uint16_t CRCTable[];
+extern const uint16_t pxxStuffingTable[5][16];
 
 void setupPulses(uint8_t port);
 void setupPulsesDSM2(uint8_t port);
@@ -102,41 +102,71 @@ void uartPutPcmCrc(uint8_t port)
 }
 #endif
 
+// PXX bit stuffing (a 0 is inserted after five 1), for each count of 1 already sent and each nibble:
+// bits 0-4 are the symbols to send (the first one in bit 0), bits 5-7 their count, bits 8-10 the new count of 1
+const uint16_t pxxStuffingTable[5][16] = {
+  { 0x080, 0x188, 0x084, 0x28C, 0x082, 0x18A, 0x086, 0x38E, 0x081, 0x189, 0x085, 0x28D, 0x083, 0x18B, 0x087, 0x48F },
+  { 0x080, 0x188, 0x084, 0x28C, 0x082, 0x18A, 0x086, 0x38E, 0x081, 0x189, 0x085, 0x28D, 0x083, 0x18B, 0x087, 0x0AF },
+  { 0x080, 0x188, 0x084, 0x28C, 0x082, 0x18A, 0x086, 0x38E, 0x081, 0x189, 0x085, 0x28D, 0x083, 0x18B, 0x0A7, 0x1B7 },
+  { 0x080, 0x188, 0x084, 0x28C, 0x082, 0x18A, 0x086, 0x38E, 0x081, 0x189, 0x085, 0x28D, 0x0A3, 0x1B3, 0x0AB, 0x2BB },
+  { 0x080, 0x188, 0x084, 0x28C, 0x082, 0x18A, 0x086, 0x38E, 0x0A1, 0x1B1, 0x0A9, 0x2B9, 0x0A5, 0x1B5, 0x0AD, 0x3BD },
+};
+
 #if defined(PPM_PIN_SERIAL)
-void pxxPutPcmSerialBit(uint8_t port, uint8_t bit)
+// 8uS/bit 01 = 0, 001 = 1, sent LSB first
+inline void pxxPutPcmSymbols(uint8_t port, uint8_t symbols, uint8_t count)
 {
-  modulePulsesData[port].pxx.serialByte >>= 1;
-  if (bit & 1) {
-    modulePulsesData[port].pxx.serialByte |= 0x80;
-  }
-  if (++modulePulsesData[port].pxx.serialBitCount >= 8) {
-    *modulePulsesData[port].pxx.ptr++ = modulePulsesData[port].pxx.serialByte;
-    modulePulsesData[port].pxx.serialBitCount = 0;
+  PxxSerialPulsesData & pxx = modulePulsesData[port].pxx;
+  uint32_t bits = pxx.serialByte;
+  uint8_t bitCount = pxx.serialBitCount;
+
+  while (count--) {
+    if (symbols & 1) {
+      bits |= 0x04 << bitCount;
+      bitCount += 3;
+    }
+    else {
+      bits |= 0x02 << bitCount;
+      bitCount += 2;
+    }
+    if (bitCount >= 8) {
+      *pxx.ptr++ = bits;
+      bits >>= 8;
+      bitCount -= 8;
+    }
+    symbols >>= 1;
   }
-}
 
-// 8uS/bit 01 = 0, 001 = 1
-void pxxPutPcmPart(uint8_t port, uint8_t value)
-{
-  pxxPutPcmSerialBit(port, 0);
-  if (value) {
-    pxxPutPcmSerialBit(port, 0);
-  }
-  pxxPutPcmSerialBit(port, 1);
+  pxx.serialByte = bits;
+  pxx.serialBitCount = bitCount;
 }
 
 void pxxPutPcmTail(uint8_t port)
 {
-  while (modulePulsesData[port].pxx.serialBitCount != 0) {
-    pxxPutPcmSerialBit(port, 1);
+  // the last byte is completed with 1
+  PxxSerialPulsesData & pxx = modulePulsesData[port].pxx;
+  if (pxx.serialBitCount != 0) {
+    *pxx.ptr++ = pxx.serialByte | (0xFF << pxx.serialBitCount);
+    pxx.serialByte = 0;
+    pxx.serialBitCount = 0;
   }
 }
 #else
-void pxxPutPcmPart(uint8_t port, uint8_t value)
+inline void pxxPutPcmSymbols(uint8_t port, uint8_t symbols, uint8_t count)
 {
-  pulse_duration_t duration = value ? 47 : 31;
-  *modulePulsesData[port].pxx.ptr++ = duration;
-  modulePulsesData[port].pxx.rest -= duration + 1;
+  PxxTimerPulsesData & pxx = modulePulsesData[port].pxx;
+  pulse_duration_t * ptr = pxx.ptr;
+  uint16_t rest = pxx.rest;
+
+  while (count--) {
+    pulse_duration_t duration = (symbols & 1) ? 47 : 31;
+    *ptr++ = duration;
+    rest -= duration + 1;
+    symbols >>= 1;
+  }
+
+  pxx.ptr = ptr;
+  pxx.rest = rest;
 }
 
 void pxxPutPcmTail(uint8_t port)
@@ -146,36 +176,22 @@ void pxxPutPcmTail(uint8_t port)
 }
 #endif
 
-void pxxPutPcmBit(uint8_t port, uint8_t bit)
-{
-  if (bit) {
-    pxxPutPcmPart(port, 1);
-    if (++modulePulsesData[port].pxx.pcmOnesCount == 5) {
-      modulePulsesData[port].pxx.pcmOnesCount = 0;
-      pxxPutPcmPart(port, 0);                                // Stuff a 0 bit in
-    }
-  }
-  else {
-    pxxPutPcmPart(port, 0);
-    modulePulsesData[port].pxx.pcmOnesCount = 0;
-  }
-
-}
-
 void pxxPutPcmByte(uint8_t port, uint8_t byte)
 {
   modulePulsesData[port].pxx.pcmCrc = (modulePulsesData[port].pxx.pcmCrc<<8) ^ (CRCTable[((modulePulsesData[port].pxx.pcmCrc>>8)^byte) & 0xFF]);
-  for (uint8_t i=0; i<8; i++) {
-    pxxPutPcmBit(port, byte & 0x80);
-    byte <<= 1;
-  }
+  uint16_t code = pxxStuffingTable[modulePulsesData[port].pxx.pcmOnesCount][byte >> 4];
+  pxxPutPcmSymbols(port, code & 0x1F, (code >> 5) & 0x07);
+  code = pxxStuffingTable[code >> 8][byte & 0x0F];
+  pxxPutPcmSymbols(port, code & 0x1F, (code >> 5) & 0x07);
+  modulePulsesData[port].pxx.pcmOnesCount = code >> 8;
 }
 
 void pxxInitPcmArray(uint8_t port)
 {
   modulePulsesData[port].pxx.ptr = modulePulsesData[port].pxx.pulses;
 #if defined(PPM_PIN_SERIAL)
-  modulePulsesData[port].pxx.pcmValue = 0;
+  modulePulsesData[port].pxx.serialByte = 0;
+  modulePulsesData[port].pxx.serialBitCount = 0;
 #else
   modulePulsesData[port].pxx.rest = 18000;
 #endif
@@ -185,16 +201,9 @@ void pxxInitPcmArray(uint8_t port)
 
 void pxxPutPcmHead(uint8_t port)
 {
-  // send 7E, do not CRC
+  // send 7E, do not CRC, do not stuff
   // 01111110
-  pxxPutPcmPart(port, 0);
-  pxxPutPcmPart(port, 1);
-  pxxPutPcmPart(port, 1);
-  pxxPutPcmPart(port, 1);
-  pxxPutPcmPart(port, 1);
-  pxxPutPcmPart(port, 1);
-  pxxPutPcmPart(port, 1);
-  pxxPutPcmPart(port, 0);
+  pxxPutPcmSymbols(port, 0x7E, 8);
 }
 
 void pxxPutPcmCrc(uint8_t port)
@@ -21,8 +21,6 @@
 #include "opentx.h"
 #include "sbus.h"
 
-#define SBUS_FRAME_GAP_DELAY   1000 // 500uS
-
 #define SBUS_START_BYTE        0x0F
 #define SBUS_END_BYTE          0x00
 #define SBUS_FLAGS_IDX         23
@@ -34,9 +32,23 @@
 
 #define SBUS_CH_CENTER         0x3E0
 
+#define SBUS_CH_VALUE(x)       (((int32_t)((x) & SBUS_CH_MASK) - SBUS_CH_CENTER) * 5 / 8)
+
+// 8 channels are packed in 11 bytes, LSB first
+static inline void unpackSbusChannels(const uint8_t * sbus, int16_t * pulses)
+{
+  pulses[0] = SBUS_CH_VALUE(sbus[0] | sbus[1] << 8);
+  pulses[1] = SBUS_CH_VALUE(sbus[1] >> 3 | sbus[2] << 5);
+  pulses[2] = SBUS_CH_VALUE(sbus[2] >> 6 | sbus[3] << 2 | sbus[4] << 10);
+  pulses[3] = SBUS_CH_VALUE(sbus[4] >> 1 | sbus[5] << 7);
+  pulses[4] = SBUS_CH_VALUE(sbus[5] >> 4 | sbus[6] << 4);
+  pulses[5] = SBUS_CH_VALUE(sbus[6] >> 7 | sbus[7] << 1 | sbus[8] << 9);
+  pulses[6] = SBUS_CH_VALUE(sbus[8] >> 2 | sbus[9] << 6);
+  pulses[7] = SBUS_CH_VALUE(sbus[9] >> 5 | sbus[10] << 3);
+}
 
 // Range for pulses (ppm input) is [-512:+512]
-void processSbusFrame(uint8_t * sbus, int16_t * pulses, uint32_t size)
+void processSbusFrame(const uint8_t * sbus, int16_t * pulses, uint32_t size)
 {
   if (size != SBUS_FRAME_SIZE || sbus[0] != SBUS_START_BYTE || sbus[SBUS_FRAME_SIZE-1] != SBUS_END_BYTE) {
     return; // not a valid SBUS frame
@@ -47,48 +59,11 @@ void processSbusFrame(uint8_t * sbus, int16_t * pulses, uint32_t size)
 
   sbus++; // skip start byte
 
-  uint32_t inputbitsavailable = 0;
-  uint32_t inputbits = 0;
-  for (uint32_t i=0; i<MAX_TRAINER_CHANNELS; i++) {
-    while (inputbitsavailable < SBUS_CH_BITS) {
-      inputbits |= *sbus++ << inputbitsavailable;
-      inputbitsavailable += 8;
-    }
-    *pulses++ = ((int32_t) (inputbits & SBUS_CH_MASK) - SBUS_CH_CENTER) * 5 / 8;
-    inputbitsavailable -= SBUS_CH_BITS;
-    inputbits >>= SBUS_CH_BITS;
+  for (uint32_t i=0; i<MAX_TRAINER_CHANNELS; i+=8) {
+    unpackSbusChannels(sbus, pulses);
+    sbus += 8 * SBUS_CH_BITS / 8;
+    pulses += 8;
   }
 
   ppmInputValidityTimer = PPM_IN_VALID_TIMEOUT;
 }
-
-void processSbusInput()
-{
-#if !defined(SIMU)
-  uint8_t rxchar;
-  uint32_t active = 0;
-  static uint8_t SbusIndex = 0;
-  static uint16_t SbusTimer;
-  static uint8_t SbusFrame[SBUS_FRAME_SIZE];
-
-  while (sbusGetByte(&rxchar)) {
-    active = 1;
-    if (SbusIndex > SBUS_FRAME_SIZE-1) {
-      SbusIndex = SBUS_FRAME_SIZE-1;
-    }
-    SbusFrame[SbusIndex++] = rxchar;
-  }
-  if (active) {
-    SbusTimer = getTmr2MHz();
-    return;
-  }
-  else {
-    if (SbusIndex) {
-      if ((uint16_t) (getTmr2MHz() - SbusTimer) > SBUS_FRAME_GAP_DELAY) {
-        processSbusFrame(SbusFrame, ppmInput, SbusIndex);
-        SbusIndex = 0;
-      }
-    }
-  }
-#endif
-}
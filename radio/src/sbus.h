@@ -24,6 +24,7 @@
 #define SBUS_BAUDRATE         100000
 #define SBUS_FRAME_SIZE       25
 
-void processSbusInput();
+// Called from the USART idle line interrupt, with the frame in place in the DMA buffer
+void processSbusFrame(const uint8_t * sbus, int16_t * pulses, uint32_t size);
 
 #endif // _SBUS_H_
@@ -53,7 +53,11 @@ const char RADIO_SETTINGS_PATH[] = RADIO_PATH "/radio.bin";
 #endif
 
 #define MODELS_EXT          ".bin"
+#if defined(LOGS_BINARY)
+#define LOGS_EXT            ".otl"
+#else
 #define LOGS_EXT            ".csv"
+#endif
 #define SOUNDS_EXT          ".wav"
 #define BMP_EXT             ".bmp"
 #define PNG_EXT             ".png"
@@ -91,10 +95,17 @@ const char RADIO_SETTINGS_PATH[] = RADIO_PATH "/radio.bin";
 extern FATFS g_FATFS_Obj;
 extern FIL g_oLogFile;
 
-extern uint8_t logDelay;
+extern uint16_t logDelay;
+#if defined(LOGS_BINARY)
+#define LOGS_FAST_PARAM   -1 // FUNC_LOGS parameter of the 20ms interval, only the binary logs are recorded that fast
+#define LOGS_FAST_DELAY   2
+#endif
 void logsInit();
 void logsClose();
 void logsWrite();
+#if defined(LOGS_BINARY)
+void logsRecord();
+#endif
 
 bool sdCardFormat();
 uint32_t sdGetNoSectors();
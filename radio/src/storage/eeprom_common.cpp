@@ -28,9 +28,19 @@ void eeLoadModel(uint8_t index)
 {
   if (index < MAX_MODELS) {
 
+#if defined(HOT_MODEL_SWITCH)
+    uint16_t size = eeLoadModelData(index, &shadowModel);
+    if (size >= EEPROM_MIN_MODEL_SIZE && modelHotSwitch(true)) {
+      return;
+    }
+
+    preModelLoad();
+    memcpy(&g_model, &shadowModel, sizeof(g_model));
+#else
     preModelLoad();
 
     uint16_t size = eeLoadModelData(index);
+#endif
 
 #if defined(SIMU) && defined(EEPROM_ZONE_SIZE)
     if (sizeof(uint16_t) + sizeof(g_model) > EEPROM_ZONE_SIZE) {
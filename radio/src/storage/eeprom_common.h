@@ -20,7 +20,7 @@
 
 #define EEPROM_MIN_MODEL_SIZE          256
 
-uint16_t eeLoadModelData(uint8_t id);
+uint16_t eeLoadModelData(uint8_t id, ModelData * model=&g_model);
 uint16_t eeLoadGeneralSettingsData();
 
 bool eeModelExists(uint8_t id);
@@ -244,9 +244,9 @@ uint16_t eeLoadGeneralSettingsData()
   return readFile(0, (uint8_t *)&g_eeGeneral, sizeof(g_eeGeneral));
 }
 
-uint16_t eeLoadModelData(uint8_t index)
+uint16_t eeLoadModelData(uint8_t index, ModelData * model)
 {
-  return readFile(index+1, (uint8_t *)&g_model, sizeof(g_model));
+  return readFile(index+1, (uint8_t *)model, sizeof(ModelData));
 }
 
 void writeGeneralSettings()
@@ -807,13 +807,13 @@ uint16_t eeLoadGeneralSettingsData()
 }
 #endif
 
-uint16_t eeLoadModelData(uint8_t index)
+uint16_t eeLoadModelData(uint8_t index, ModelData * model)
 {
 #if defined(CPUARM)
-  memset(&g_model, 0, sizeof(g_model));
+  memset(model, 0, sizeof(ModelData));
 #endif
   theFile.openRlc(FILE_MODEL(index));
-  return theFile.readRlc((uint8_t*)&g_model, sizeof(g_model));
+  return theFile.readRlc((uint8_t*)model, sizeof(ModelData));
 }
 
 bool eeLoadGeneral()
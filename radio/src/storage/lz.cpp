@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <inttypes.h>
+#include <string.h>
+#include "debug.h"
+
+/*
+  LZ77 encoding of the RAM backup, the tokens are:
+    00nnnnnn                        n+1 literal bytes follow (1..64)
+    01nnnnnn                        n+1 zero bytes (1..63)
+    01111111 nnnnnnnn               n+64 zero bytes (64..319)
+    1lllOOOO oooooooo               l+3 bytes copied from Oo+1 bytes before (3..9 bytes, up to 4096 bytes before)
+    1111OOOO oooooooo nnnnnnnn      n+10 bytes copied from Oo+1 bytes before (10..265 bytes)
+  A match never refers to data before the start of its own block, so several encoded
+  blocks written one after the other are decoded as a single one.
+*/
+
+#define LZ_LITERALS_MAX                64
+#define LZ_ZEROES_SHORT_MAX            63
+#define LZ_ZEROES_MAX                  (64+255)
+#define LZ_MATCH_MIN                   3
+#define LZ_MATCH_SHORT_MAX             9
+#define LZ_MATCH_MAX                   (10+255)
+#define LZ_OFFSET_MAX                  4096
+#define LZ_HASH_BITS                   10
+
+static uint16_t lzHashTable[1 << LZ_HASH_BITS];  // last position+1 of each 3 bytes sequence
+
+static inline unsigned int lzHash(const uint8_t * p)
+{
+  return (((uint32_t)p[0] << 16) + (p[1] << 8) + p[2]) * 2654435761u >> (32 - LZ_HASH_BITS);
+}
+
+#define CHECK_DST_SIZE(count) \
+  if (cur + (count) > dst + dstsize) { \
+    TRACE("LZ encoding size too big"); \
+    return 0; \
+  }
+
+unsigned int lzCompress(uint8_t * dst, unsigned int dstsize, const uint8_t * src, unsigned int srcsize)
+{
+  uint8_t * cur = dst;
+  unsigned int literals = 0; // first pending literal
+  unsigned int i = 0;
+
+  memset(lzHashTable, 0, sizeof(lzHashTable));
+
+  while (i < srcsize) {
+    unsigned int zeroes = 0;
+    while (zeroes < LZ_ZEROES_MAX && i + zeroes < srcsize && src[i + zeroes] == 0) {
+      zeroes++;
+    }
+
+    unsigned int length = 0;
+    unsigned int offset = 0;
+    if (zeroes < 2 && i + LZ_MATCH_MIN <= srcsize) {
+      uint16_t & entry = lzHashTable[lzHash(&src[i])];
+      if (entry && i + 1 - entry <= LZ_OFFSET_MAX) {
+        const uint8_t * ref = &src[entry - 1];
+        unsigned int max = srcsize - i < LZ_MATCH_MAX ? srcsize - i : LZ_MATCH_MAX;
+        while (length < max && ref[length] == src[i + length]) {
+          length++;
+        }
+        offset = i + 1 - entry;
+      }
+      entry = i + 1;
+    }
+
+    if (zeroes < 2 && length < LZ_MATCH_MIN) {
+      if (++i - literals < LZ_LITERALS_MAX)
+        continue;
+    }
+
+    unsigned int count = i - literals;
+    if (count) {
+      CHECK_DST_SIZE(1 + count);
+      *cur++ = count - 1;
+      memcpy(cur, &src[literals], count);
+      cur += count;
+    }
+
+    if (zeroes >= 2) {
+      if (zeroes <= LZ_ZEROES_SHORT_MAX) {
+        CHECK_DST_SIZE(1);
+        *cur++ = 0x40 + zeroes - 1;
+      }
+      else {
+        CHECK_DST_SIZE(2);
+        *cur++ = 0x7F;
+        *cur++ = zeroes - 64;
+      }
+      i += zeroes;
+    }
+    else if (length >= LZ_MATCH_MIN) {
+      offset -= 1;
+      if (length <= LZ_MATCH_SHORT_MAX) {
+        CHECK_DST_SIZE(2);
+        *cur++ = 0x80 + ((length - LZ_MATCH_MIN) << 4) + (offset >> 8);
+        *cur++ = offset;
+      }
+      else {
+        CHECK_DST_SIZE(3);
+        *cur++ = 0xF0 + (offset >> 8);
+        *cur++ = offset;
+        *cur++ = length - 10;
+      }
+      i += length;
+    }
+
+    literals = i;
+  }
+
+  unsigned int count = i - literals;
+  if (count) {
+    CHECK_DST_SIZE(1 + count);
+    *cur++ = count - 1;
+    memcpy(cur, &src[literals], count);
+    cur += count;
+  }
+
+  return cur - dst;
+}
+
+#undef CHECK_DST_SIZE
+#define CHECK_SIZES(srcCount, dstCount) \
+  if (src + (srcCount) > end || cur + (dstCount) > dst + dstsize) { \
+    TRACE("LZ decoding error"); \
+    return 0; \
+  }
+
+unsigned int lzUncompress(uint8_t * dst, unsigned int dstsize, const uint8_t * src, unsigned int srcsize)
+{
+  uint8_t * cur = dst;
+  const uint8_t * end = src + srcsize;
+
+  while (src < end) {
+    uint8_t token = *src++;
+    if (token < 0x40) {
+      unsigned int count = token + 1;
+      CHECK_SIZES(count, count);
+      memcpy(cur, src, count);
+      src += count;
+      cur += count;
+    }
+    else if (token < 0x80) {
+      unsigned int count = token - 0x40 + 1;
+      if (token == 0x7F) {
+        CHECK_SIZES(1, 0);
+        count = *src++ + 64;
+      }
+      CHECK_SIZES(0, count);
+      memset(cur, 0, count);
+      cur += count;
+    }
+    else {
+      CHECK_SIZES(1, 0);
+      unsigned int offset = ((token & 0x0F) << 8) + *src++ + 1;
+      unsigned int length = ((token >> 4) & 0x07) + LZ_MATCH_MIN;
+      if (length > LZ_MATCH_SHORT_MAX) {
+        CHECK_SIZES(1, 0);
+        length = *src++ + 10;
+      }
+      CHECK_SIZES(0, length);
+      if (offset > (unsigned int)(cur - dst)) {
+        TRACE("LZ decoding error");
+        return 0;
+      }
+      // byte per byte, the source may overlap what is written
+      const uint8_t * ref = cur - offset;
+      for (unsigned int j=0; j<length; j++) {
+        *cur++ = *ref++;
+      }
+    }
+  }
+
+  return cur - dst;
+}
+
+#undef CHECK_SIZES
@@ -41,12 +41,47 @@ RamBackup * ramBackup = &_ramBackup;
 RamBackup * ramBackup = (RamBackup *)BKPSRAM_BASE;
 #endif
 
+// the backup is encoded here first, the battery backed one is only replaced by a complete encoding
+static uint8_t ramBackupEncoded[sizeof(ramBackup->data)] __SDRAM;
+
+// encoded size of the model at the start of the backup, 0 when the whole backup has to be written
+static uint16_t ramBackupModelSize = 0;
+
 void rambackupWrite()
 {
-  copyRadioData(&ramBackupUncompressed.radio, &g_eeGeneral);
-  copyModelData(&ramBackupUncompressed.model, &g_model);
-  ramBackup->size = compress(ramBackup->data, 4094, (const uint8_t *)&ramBackupUncompressed, sizeof(ramBackupUncompressed));
-  TRACE("RamBackupWrite sdsize=%d backupsize=%d rlcsize=%d", sizeof(ModelData)+sizeof(RadioData), sizeof(Backup::RamBackupUncompressed), ramBackup->size);
+  uint8_t msk = (ramBackupModelSize ? rambackupDirtyMsk : EE_GENERAL | EE_MODEL);
+  unsigned int modelSize = ramBackupModelSize;
+
+  // on error the previous backup is kept and the next one is written from scratch
+  ramBackupModelSize = 0;
+
+  if (msk & EE_MODEL) {
+    copyModelData(&ramBackupUncompressed.model, &g_model);
+    modelSize = lzCompress(ramBackupEncoded, sizeof(ramBackupEncoded), (const uint8_t *)&ramBackupUncompressed.model, sizeof(ramBackupUncompressed.model));
+    if (modelSize == 0) {
+      TRACE_ERROR("RamBackupWrite: model too big");
+      return;
+    }
+  }
+
+  // the radio settings follow the model, they are encoded again when the model size changes
+  if (msk & EE_GENERAL) {
+    copyRadioData(&ramBackupUncompressed.radio, &g_eeGeneral);
+  }
+  unsigned int radioSize = lzCompress(ramBackupEncoded + modelSize, sizeof(ramBackupEncoded) - modelSize, (const uint8_t *)&ramBackupUncompressed.radio, sizeof(ramBackupUncompressed.radio));
+  if (radioSize == 0) {
+    TRACE_ERROR("RamBackupWrite: radio settings too big");
+    return;
+  }
+
+  // never restored while half written, the model part is only copied when it has changed
+  unsigned int start = (msk & EE_MODEL) ? 0 : modelSize;
+  ramBackup->size = 0;
+  memcpy(ramBackup->data + start, ramBackupEncoded + start, modelSize + radioSize - start);
+  ramBackup->codec = RAMBACKUP_CODEC_LZ;
+  ramBackup->size = modelSize + radioSize;
+  ramBackupModelSize = modelSize;
+  TRACE("RamBackupWrite sdsize=%d backupsize=%d lzsize=%d", sizeof(ModelData)+sizeof(RadioData), sizeof(Backup::RamBackupUncompressed), ramBackup->size);
 }
 
 bool rambackupRestore()
@@ -54,7 +89,12 @@ bool rambackupRestore()
   if (ramBackup->size == 0)
     return false;
 
-  if (uncompress((uint8_t *)&ramBackupUncompressed, sizeof(ramBackupUncompressed), ramBackup->data, ramBackup->size) != sizeof(ramBackupUncompressed))
+  unsigned int size;
+  if (ramBackup->codec == RAMBACKUP_CODEC_LZ)
+    size = lzUncompress((uint8_t *)&ramBackupUncompressed, sizeof(ramBackupUncompressed), ramBackup->data, ramBackup->size);
+  else
+    size = uncompress((uint8_t *)&ramBackupUncompressed, sizeof(ramBackupUncompressed), ramBackup->data, ramBackup->size);
+  if (size != sizeof(ramBackupUncompressed))
     return false;
 
   memset(&g_eeGeneral, 0, sizeof(g_eeGeneral));
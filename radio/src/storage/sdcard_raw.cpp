@@ -27,15 +27,31 @@ void getModelPath(char * path, const char * filename)
   strcpy(&path[sizeof(MODELS_PATH)], filename);
 }
 
+// The file is written next to the previous one, with a .tmp extension
+static void getTempPath(char * path, const char * filename)
+{
+  strcpy(path, filename);
+  char * ext = strrchr(path, '.');
+  if (!ext || strchr(ext, '/')) {
+    ext = path + strlen(path);
+  }
+  strcpy(ext, ".tmp");
+}
+
 const char * writeFile(const char * filename, const uint8_t * data, uint16_t size)
 {
   TRACE("writeFile(%s)", filename);
-  
-  FIL file;
+
+  // static, out of the storage task stack, there is only one write at a time
+  // (the storage task, or storageCheck(true) once the storage task is done)
+  static FIL file;
+  static char tmpPath[256];
   unsigned char buf[8];
   UINT written;
 
-  FRESULT result = f_open(&file, filename, FA_CREATE_ALWAYS | FA_WRITE);
+  getTempPath(tmpPath, filename);
+
+  FRESULT result = f_open(&file, tmpPath, FA_CREATE_ALWAYS | FA_WRITE);
   if (result != FR_OK) {
     return SDCARD_ERROR(result);
   }
@@ -57,15 +73,35 @@ const char * writeFile(const char * filename, const uint8_t * data, uint16_t siz
     return SDCARD_ERROR(result);
   }
 
-  f_close(&file);
+  result = f_close(&file);
+  if (result != FR_OK) {
+    return SDCARD_ERROR(result);
+  }
+
+  // the previous file is removed only once the new one is complete,
+  // loadFile() finishes the job if the power is lost before the rename
+  f_unlink(filename);
+  result = f_rename(tmpPath, filename);
+  if (result != FR_OK) {
+    return SDCARD_ERROR(result);
+  }
+
   return NULL;
 }
 
+// Content of the files on the SD card. The data are written from here, so that
+// the storage task can write them while the menus keep on modifying g_model
+static RadioData storageGeneral __SDRAM;
+static ModelData storageModel __SDRAM;
+static char storageModelFilename[LEN_MODEL_FILENAME+1];
+static uint8_t storageValidMsk;               // the files are known to match the snapshots
+static volatile uint8_t storagePendingMsk;    // snapshots being written by the storage task
+
 const char * writeModel()
 {
-  char path[256];
-  getModelPath(path, g_eeGeneral.currModelFilename);
-  return writeFile(path, (uint8_t *)&g_model, sizeof(g_model));
+  static char path[256];  // same as in writeFile()
+  getModelPath(path, storageModelFilename);
+  return writeFile(path, (uint8_t *)&storageModel, sizeof(storageModel));
 }
 
 const char * loadFile(const char * filename, uint8_t * data, uint16_t maxsize)
@@ -78,7 +114,17 @@ const char * loadFile(const char * filename, uint8_t * data, uint16_t maxsize)
 
   FRESULT result = f_open(&file, filename, FA_OPEN_EXISTING | FA_READ);
   if (result != FR_OK) {
-    return SDCARD_ERROR(result);
+    // the power may have been lost between the removal of the previous file and the rename of the new one
+    char tmpPath[256];
+    getTempPath(tmpPath, filename);
+    if (f_rename(tmpPath, filename) != FR_OK) {
+      return SDCARD_ERROR(result);
+    }
+    TRACE("loadFile(%s): recovered from %s", filename, tmpPath);
+    result = f_open(&file, filename, FA_OPEN_EXISTING | FA_READ);
+    if (result != FR_OK) {
+      return SDCARD_ERROR(result);
+    }
   }
 
   if (f_size(&file) < 8) {
@@ -116,15 +162,40 @@ const char * readModel(const char * filename, uint8_t * buffer, uint32_t size)
   return loadFile(path, buffer, size);
 }
 
+// the model file has just been read into g_model
+static void setStorageModel(const char * filename)
+{
+  storageWait();
+  memcpy(&storageModel, &g_model, sizeof(g_model));
+  strncpy(storageModelFilename, filename, LEN_MODEL_FILENAME);
+  storageValidMsk |= EE_MODEL;
+}
+
 const char * loadModel(const char * filename, bool alarms)
 {
+#if defined(HOT_MODEL_SWITCH)
+  memset(&shadowModel, 0, sizeof(shadowModel));
+  const char * error = readModel(filename, (uint8_t *)&shadowModel, sizeof(shadowModel));
+  if (!error && modelHotSwitch(alarms)) {
+    setStorageModel(filename);
+    return NULL;
+  }
+
+  preModelLoad();
+  memcpy(&g_model, &shadowModel, sizeof(g_model));
+#else
   preModelLoad();
 
   const char * error = readModel(filename, (uint8_t *)&g_model, sizeof(g_model));
+#endif
+
   if (error) {
     TRACE("loadModel error=%s", error);
   }
-  
+  else {
+    setStorageModel(filename);
+  }
+
   if (error) {
     modelDefault(0) ;
     storageCheck(true);
@@ -142,36 +213,126 @@ const char * loadRadioSettingsSettings()
   if (error) {
     TRACE("loadRadioSettingsSettings error=%s", error);
   }
+  else {
+    storageWait();
+    memcpy(&storageGeneral, &g_eeGeneral, sizeof(g_eeGeneral));
+    storageValidMsk |= EE_GENERAL;
+  }
   // TODO this is temporary, we only have one model for now
   return error;
 }
 
 const char * writeGeneralSettings()
 {
-  return writeFile(RADIO_SETTINGS_PATH, (uint8_t *)&g_eeGeneral, sizeof(g_eeGeneral));
+  return writeFile(RADIO_SETTINGS_PATH, (uint8_t *)&storageGeneral, sizeof(storageGeneral));
 }
 
-void storageCheck(bool immediately)
+static void storageWrite(uint8_t msk)
 {
-  if (storageDirtyMsk & EE_GENERAL) {
-    TRACE("eeprom write general");
-    storageDirtyMsk -= EE_GENERAL;
+  if (msk & EE_GENERAL) {
     const char * error = writeGeneralSettings();
     if (error) {
       TRACE("writeGeneralSettings error=%s", error);
+      storageValidMsk &= ~EE_GENERAL;
     }
   }
 
-  if (storageDirtyMsk & EE_MODEL) {
-    TRACE("eeprom write model");
-    storageDirtyMsk -= EE_MODEL;
+  if (msk & EE_MODEL) {
     const char * error = writeModel();
     if (error) {
       TRACE("writeModel error=%s", error);
+      storageValidMsk &= ~EE_MODEL;
     }
   }
 }
 
+// Wait until the storage task is done with the snapshots
+void storageWait()
+{
+#if defined(STORAGE_TASK)
+  while (storagePendingMsk) {
+    CoTickDelay(1);
+  }
+#endif
+}
+
+#if defined(STORAGE_TASK)
+void storageTask(void * pdata)
+{
+  while (1) {
+    CoWaitForSingleFlag(storageFlag, 0);
+    storageWrite(storagePendingMsk);
+    storagePendingMsk = 0;
+  }
+}
+#endif
+
+/*
+  @fn storageCheck(bool immediately)
+
+  Write the dirty settings and model. The data are copied to snapshots first,
+  nothing is written when they did not change since the last load or write
+  (a trim moved and back, a timer saved with the same value...).
+
+  @param immediately the files are written before returning, otherwise the
+   storage task writes them in background
+*/
+void storageCheck(bool immediately)
+{
+#if defined(STORAGE_TASK)
+  if (storagePendingMsk) {
+    if (!immediately) {
+      return; // the previous write is not finished, try again later
+    }
+    storageWait();
+  }
+#endif
+
+  uint8_t msk = 0;
+
+  if (storageDirtyMsk & EE_GENERAL) {
+    storageDirtyMsk -= EE_GENERAL;
+    if ((storageValidMsk & EE_GENERAL) && !memcmp(&storageGeneral, &g_eeGeneral, sizeof(g_eeGeneral))) {
+      TRACE("eeprom write general skipped, no change");
+    }
+    else {
+      TRACE("eeprom write general");
+      memcpy(&storageGeneral, &g_eeGeneral, sizeof(g_eeGeneral));
+      msk |= EE_GENERAL;
+    }
+  }
+
+  if (storageDirtyMsk & EE_MODEL) {
+    storageDirtyMsk -= EE_MODEL;
+    if ((storageValidMsk & EE_MODEL) && !strncmp(storageModelFilename, g_eeGeneral.currModelFilename, LEN_MODEL_FILENAME) &&
+        !memcmp(&storageModel, &g_model, sizeof(g_model))) {
+      TRACE("eeprom write model skipped, no change");
+    }
+    else {
+      TRACE("eeprom write model");
+      memcpy(&storageModel, &g_model, sizeof(g_model));
+      strncpy(storageModelFilename, g_eeGeneral.currModelFilename, LEN_MODEL_FILENAME);
+      msk |= EE_MODEL;
+    }
+  }
+
+  if (!msk) {
+    return;
+  }
+
+  storageValidMsk |= msk;
+
+#if defined(STORAGE_TASK)
+  if (!immediately) {
+    storagePendingMsk = msk;
+    CoSetFlag(storageFlag);
+    return;
+  }
+#endif
+
+  storageWrite(msk);
+}
+
 void storageReadAll()
 {
   TRACE("storageReadAll");
@@ -29,9 +29,18 @@
 const char * readModel(const char * filename, uint8_t * buffer, uint32_t size);
 const char * loadModel(const char * filename, bool alarms=true);
 const char * createModel();
+void storageWait();
+
+#if defined(STORAGE_TASK)
+void storageTask(void * pdata);
+#endif
+
+#define RAMBACKUP_CODEC_RLC            0
+#define RAMBACKUP_CODEC_LZ             1
 
 PACK(struct RamBackup {
-  uint16_t size;
+  uint16_t size:12;   // 0 when there is no valid backup
+  uint16_t codec:4;   // 0 (RLC) in the backups written by the former versions
   uint8_t data[4094];
 });
 
@@ -55,6 +55,14 @@ void storageFlushCurrentModel();
 void preModelLoad();
 void postModelLoad(bool alarms);
 
+#if defined(HOT_MODEL_SWITCH)
+#if !defined(HOT_MODEL_SWITCH_BLEND)
+  #define HOT_MODEL_SWITCH_BLEND 0
+#endif
+extern ModelData shadowModel;
+bool modelHotSwitch(bool alarms);
+#endif
+
 #if defined(EEPROM_RLC)
 #include "eeprom_common.h"
 #include "eeprom_rlc.h"
@@ -68,8 +76,12 @@ void postModelLoad(bool alarms);
 #if defined(RAMBACKUP)
 void rambackupWrite();
 bool rambackupRestore();
+#endif
+
+// RAM backup codecs, also built in the host tests and benchmarks of all the radios
 unsigned int compress(uint8_t * dst, unsigned int dstsize, const uint8_t * src, unsigned int len);
 unsigned int uncompress(uint8_t * dst, unsigned int dstsize, const uint8_t * src, unsigned int len);
-#endif
+unsigned int lzCompress(uint8_t * dst, unsigned int dstsize, const uint8_t * src, unsigned int len);
+unsigned int lzUncompress(uint8_t * dst, unsigned int dstsize, const uint8_t * src, unsigned int len);
 
 #endif // _STORAGE_H_
@@ -33,8 +33,14 @@ void storageDirty(uint8_t msk)
   storageDirtyMsk |= msk;
   storageDirtyTime10ms = get_tmr10ms();
 
+#if defined(CPUARM)
+  if (msk & EE_MODEL) {
+    modelDataChanged();
+  }
+#endif
+
 #if defined(RAMBACKUP)
-  rambackupDirtyMsk = storageDirtyMsk;
+  rambackupDirtyMsk |= msk;
   rambackupDirtyTime10ms = storageDirtyTime10ms;
 #endif
 }
@@ -56,33 +62,17 @@ void preModelLoad()
   pauseMixerCalculations();
 }
 #if defined(PCBTARANIS) || defined(PCBHORUS)
-static void fixUpModel()
+static void fixUpModel(ModelData & model)
 {
   // Ensure that when rfProtocol is RF_PROTO_OFF the type of the module is MODULE_TYPE_NONE
-  if (g_model.moduleData[INTERNAL_MODULE].type == MODULE_TYPE_XJT && g_model.moduleData[INTERNAL_MODULE].rfProtocol == RF_PROTO_OFF)
-    g_model.moduleData[INTERNAL_MODULE].type = MODULE_TYPE_NONE;
+  if (model.moduleData[INTERNAL_MODULE].type == MODULE_TYPE_XJT && model.moduleData[INTERNAL_MODULE].rfProtocol == RF_PROTO_OFF)
+    model.moduleData[INTERNAL_MODULE].type = MODULE_TYPE_NONE;
 }
 #endif
 
-void postModelLoad(bool alarms)
+// model state which is not saved, to be restored while the mixer is paused
+static void restoreModelState()
 {
-#if defined(PCBTARANIS) || defined(PCBHORUS)
-  fixUpModel();
-#endif
-  AUDIO_FLUSH();
-  flightReset(false);
-
-  if (pulsesStarted()) {
-#if defined(GUI)
-    if (alarms) {
-      checkAll();
-      PLAY_MODEL_NAME();
-    }
-#endif
-    resumePulses();
-  }
-
-
   customFunctionsReset();
 
   restoreTimers();
@@ -98,9 +88,18 @@ void postModelLoad(bool alarms)
 #endif
 
   LOAD_MODEL_CURVES();
+#if defined(CPUARM)
+  modelDataChanged();
+#endif
+}
 
-  resumeMixerCalculations();
-  // TODO pulses should be started after mixer calculations ...
+static void loadModelResources()
+{
+#if defined(RAMBACKUP)
+  // the model has changed without storageDirty()
+  rambackupDirtyMsk |= EE_MODEL;
+  rambackupDirtyTime10ms = get_tmr10ms();
+#endif
 
 #if defined(TELEMETRY_FRSKY)
   frskySendAlarms();
@@ -119,6 +118,130 @@ void postModelLoad(bool alarms)
   SEND_FAILSAFE_1S();
 }
 
+void postModelLoad(bool alarms)
+{
+#if defined(PCBTARANIS) || defined(PCBHORUS)
+  fixUpModel(g_model);
+#endif
+  AUDIO_FLUSH();
+  flightReset(false);
+
+  if (pulsesStarted()) {
+#if defined(GUI)
+    if (alarms) {
+      checkAll();
+      PLAY_MODEL_NAME();
+    }
+#endif
+    resumePulses();
+  }
+
+
+  restoreModelState();
+
+  resumeMixerCalculations();
+  // TODO pulses should be started after mixer calculations ...
+
+  loadModelResources();
+}
+
+#if defined(HOT_MODEL_SWITCH)
+ModelData shadowModel __SDRAM;
+
+static bool isSameRfSetup(const ModelData & model)
+{
+  for (int i=0; i<NUM_MODULES; i++) {
+    const ModuleData & current = g_model.moduleData[i];
+    const ModuleData & next = model.moduleData[i];
+    if (current.type != next.type || current.rfProtocol != next.rfProtocol || current.subType != next.subType) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool isThrottleIdle(const ModelData & model)
+{
+  if (model.disableThrottleWarning) {
+    return true;
+  }
+
+  // same throttle source as checkTHR(), the inputs are kept up to date by the running mixer
+  uint8_t thrchn = ((model.thrTraceSrc==0) || (model.thrTraceSrc>NUM_POTS+NUM_SLIDERS)) ? THR_STICK : model.thrTraceSrc+NUM_STICKS-1;
+  return calibratedAnalogs[thrchn] <= THRCHK_DEADBAND-1024;
+}
+
+// same checks as checkFailsafe()
+static bool isFailsafeSet(const ModelData & model)
+{
+#if defined(PCBTARANIS) || defined(PCBHORUS) || defined(PCBFLYSKY)
+  for (int i=0; i<NUM_MODULES; i++) {
+    if (IS_MODULE_PXX(i)) {
+      const ModuleData & moduleData = model.moduleData[i];
+      if (HAS_RF_PROTOCOL_FAILSAFE(moduleData.rfProtocol) && moduleData.failsafeMode == FAILSAFE_NOT_SET) {
+        return false;
+      }
+    }
+  }
+#endif
+  return true;
+}
+
+/*
+  @fn modelHotSwitch(bool alarms)
+
+  Swap the model loaded in shadowModel with the current one without interrupting the pulses.
+  The mixer and the telemetry are only paused for the copy, the outputs are then blended from their last value
+  during HOT_MODEL_SWITCH_BLEND (10ms units).
+
+  @retval false if the modules setup of the new model is different, or if one of its startup
+   warnings (throttle, switches, failsafe) would be displayed, the caller must then do a normal
+   (pulses paused) load
+*/
+bool modelHotSwitch(bool alarms)
+{
+  if (!pulsesStarted() || s_pulses_paused) {
+    return false;
+  }
+
+#if defined(PCBTARANIS) || defined(PCBHORUS)
+  fixUpModel(shadowModel);
+#endif
+
+  // the new outputs are sent as soon as the mixer is resumed, before any warning is displayed
+  if (!isSameRfSetup(shadowModel) || !isThrottleIdle(shadowModel) || isSwitchWarningRequired(shadowModel) || !isFailsafeSet(shadowModel)) {
+    TRACE("modelHotSwitch(): refused");
+    return false;
+  }
+
+#if defined(SDCARD)
+  logsClose();
+#endif
+
+  AUDIO_FLUSH();
+
+  pauseTelemetry(); // the telemetry task is not stopped by the pulses flag here
+  pauseMixerCalculations();
+  startOutputsBlend(HOT_MODEL_SWITCH_BLEND);
+  memcpy(&g_model, &shadowModel, sizeof(g_model));
+  flightReset(false);
+  restoreModelState();
+  resumeMixerCalculations();
+  resumeTelemetry();
+
+#if defined(GUI)
+  if (alarms) {
+    // no startup warning left, only the notes and the other alerts
+    checkAll();
+    PLAY_MODEL_NAME();
+  }
+#endif
+
+  loadModelResources();
+  return true;
+}
+#endif
+
 void storageFlushCurrentModel()
 {
   saveTimers();
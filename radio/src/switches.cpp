@@ -522,7 +522,7 @@ bool getSwitch(swsrc_t swtch)
 #endif
 #if defined(CPUARM)
   else if (cs_idx >= SWSRC_FIRST_SENSOR) {
-    result = !telemetryItems[cs_idx-SWSRC_FIRST_SENSOR].isOld();
+    result = !getPublishedTelemetryValue(cs_idx-SWSRC_FIRST_SENSOR).isOld();
   }
   else if (cs_idx == SWSRC_TELEMETRY_STREAMING) {
     result = TELEMETRY_STREAMING();
@@ -632,6 +632,63 @@ swsrc_t getMovedSwitch()
   return result;
 }
 
+#if defined(HOT_MODEL_SWITCH)
+/**
+  @brief Tells if checkSwitches() would warn with this model, the switches positions are not updated
+*/
+bool isSwitchWarningRequired(const ModelData & model)
+{
+  swarnstate_t states = model.switchWarningState;
+
+#if defined(PCBFRSKY) || defined(PCBFLYSKY)
+  for (int i=0; i<NUM_SWITCHES; i++) {
+    uint8_t position = (1024+getValue(MIXSRC_SA+i)) / 1024;
+#if defined(COLORLCD)
+    if (SWITCH_WARNING_ALLOWED(i)) {
+      unsigned int state = ((states >> (3*i)) & 0x07);
+      if (state && state-1 != position) {
+        return true;
+      }
+    }
+#else
+    if (SWITCH_WARNING_ALLOWED(i) && !(model.switchWarningEnable & (1<<i))) {
+      if (((states >> (i*2)) & 0x03) != position) {
+        return true;
+      }
+    }
+#endif
+  }
+  if (model.potsWarnMode) {
+    for (int i=0; i<NUM_POTS+NUM_SLIDERS; i++) {
+      if (IS_POT_SLIDER_AVAILABLE(POT1+i) && !(model.potsWarnEnabled & (1 << i)) && (abs(model.potsWarnPosition[i] - GET_LOWRES_POT_POSITION(i)) > 1)) {
+        return true;
+      }
+    }
+  }
+#else
+  swarnstate_t current = switches_states;
+  swarnstate_t mask = 0x80;
+  for (uint8_t i=NUM_PSWITCH; i>1; i--) {
+    if (switchState(i-1))
+      current |= mask;
+    else
+      current &= ~mask;
+    mask >>= 1;
+  }
+  for (int i=0; i<NUM_SWITCHES-1; i++) {
+    if (!(model.switchWarningEnable & (1<<i))) {
+      swarnstate_t bits = (i == 0 ? 0x03 : (1<<(i+1)));
+      if ((states & bits) != (current & bits)) {
+        return true;
+      }
+    }
+  }
+#endif
+
+  return false;
+}
+#endif
+
 #if defined(GUI)
 void checkSwitches()
 {
@@ -675,7 +732,9 @@ void checkSwitches()
       }
     }
     if (g_model.potsWarnMode) {
-      evalFlightModeMixes(e_perout_mode_normal, 0);
+      if (s_pulses_paused) {
+        evalFlightModeMixes(e_perout_mode_normal, 0); // otherwise the mixer task does the job
+      }
       bad_pots = 0;
       for (int i=0; i<NUM_POTS+NUM_SLIDERS; i++) {
         if (!IS_POT_SLIDER_AVAILABLE(POT1+i)) {
@@ -697,7 +756,9 @@ void checkSwitches()
       }
     }
     if (g_model.potsWarnMode) {
-      evalFlightModeMixes(e_perout_mode_normal, 0);
+      if (s_pulses_paused) {
+        evalFlightModeMixes(e_perout_mode_normal, 0); // otherwise the mixer task does the job
+      }
       bad_pots = 0;
       for (int i=0; i<NUM_POTS+NUM_SLIDERS; i++) {
         if (!IS_POT_SLIDER_AVAILABLE(POT1+i)) {
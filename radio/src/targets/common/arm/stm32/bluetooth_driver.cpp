@@ -104,6 +104,10 @@ void bluetoothDone()
 
 extern "C" void BT_USART_IRQHandler(void)
 {
+#if defined(PCBX9E) && defined(TRAINER_MODULE_HEARTBEAT)
+  heartbeatUsartIrq(); // SBUS trainer input on the same USART
+#endif
+
   DEBUG_INTERRUPT(INT_BLUETOOTH);
   if (USART_GetITStatus(BT_USART, USART_IT_RXNE) != RESET) {
     USART_ClearITPendingBit(BT_USART, USART_IT_RXNE);
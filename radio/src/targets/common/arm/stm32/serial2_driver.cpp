@@ -128,6 +128,12 @@ void serial2SbusInit()
 {
   uart3Setup(SBUS_BAUDRATE, true);
   SERIAL_USART->CR1 |= USART_CR1_M | USART_CR1_PCE ;
+#if defined(SBUS) && defined(SERIAL_DMA_Stream_RX)
+  // the line goes idle at the end of each frame
+  USART_ITConfig(SERIAL_USART, USART_IT_IDLE, ENABLE);
+  NVIC_SetPriority(SERIAL_USART_IRQn, 7);
+  NVIC_EnableIRQ(SERIAL_USART_IRQn);
+#endif
 }
 
 void serial2Stop()
@@ -150,6 +156,17 @@ uint8_t serial2TracesEnabled()
 extern "C" void SERIAL_USART_IRQHandler(void)
 {
   DEBUG_INTERRUPT(INT_SER2);
+
+#if defined(SBUS) && defined(SERIAL_DMA_Stream_RX)
+  // SBUS trainer, the frame is received by DMA
+  if (USART_GetITStatus(SERIAL_USART, USART_IT_IDLE) != RESET) {
+    USART_ReceiveData(SERIAL_USART); // clears the IDLE flag
+    uint32_t size = serial2RxFifo.restart(SERIAL_DMA_FLAGS_RX);
+    processSbusFrame(serial2RxFifo.buffer(), ppmInput, size);
+    return;
+  }
+#endif
+
   // Send
   if (USART_GetITStatus(SERIAL_USART, USART_IT_TXE) != RESET) {
     uint8_t txchar;
@@ -293,6 +293,10 @@ DRESULT disk_ioctl (
       break;
 
     case CTRL_SYNC:
+#if defined(DISK_CACHE)
+      res = diskCache.flush(drv);
+      if (res != RES_OK) break;
+#endif
       while (SD_GetStatus() == SD_TRANSFER_BUSY); /* Complete pending write process (needed at _FS_READONLY == 0) */
       res = RES_OK;
       break;
@@ -365,6 +369,9 @@ void sdDone()
     audioQueue.stopSD();
 #if defined(LOG_TELEMETRY)
     f_close(&g_telemetryFile);
+#endif
+#if defined(DISK_CACHE)
+    diskCache.flush(0);
 #endif
     f_mount(NULL, "", 0); // unmount SD
   }
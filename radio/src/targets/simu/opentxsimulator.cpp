@@ -21,6 +21,8 @@
 
 #include <QDebug>
 #include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
 
 #if !defined(MAX_LOGICAL_SWITCHES) && defined(NUM_CSW)
   #define MAX_LOGICAL_SWITCHES    NUM_CSW
@@ -59,7 +61,8 @@ OpenTxSimulator::OpenTxSimulator() :
   SimulatorInterface(),
   m_timer10ms(NULL),
   m_resetOutputsData(true),
-  m_stopRequested(false)
+  m_stopRequested(false),
+  m_virtualTime(false)
 {
   tracebackDevices.clear();
   traceCallback = firmwareTraceCb;
@@ -129,8 +132,10 @@ void OpenTxSimulator::start(const char * filename, bool tests)
   StartAudioThread(volumeGain);
   StartSimu(tests, simuSdDirectory.toLatin1().constData(), simuSettingsDirectory.toLatin1().constData());
 
-  emit started();
-  QTimer::singleShot(0, this, SLOT(run()));  // old style for Qt < 5.4
+  if (!m_virtualTime) {
+    emit started();
+    QTimer::singleShot(0, this, SLOT(run()));  // old style for Qt < 5.4
+  }
 }
 
 void OpenTxSimulator::stop()
@@ -417,6 +422,178 @@ void OpenTxSimulator::removeTracebackDevice(QIODevice * device)
   }
 }
 
+/*
+ * Headless simulation
+ *
+ * The firmware runs on a virtual clock (see simuSetVirtualTime()), as fast as
+ * the CPU allows, without the 10ms timer. The inputs come from a timeline
+ * file, one event per line:
+ *
+ *   <time ms> stick|knob|slider|analog|trim|trimsw|switch|key|trainer <index> <value>
+ *   <time ms> txvin <value>
+ *   <time ms> telemetry <S.PORT packet bytes, in hex>
+ *   <time ms> end
+ *
+ * The values are the same as for setInputValue(), # starts a comment. The
+ * simulation ends at the end event, or 10ms after the last event. The outputs
+ * are written in CSV each time one of them changes: time, channels, logical
+ * switches (same format as in the logs) and flight mode.
+ */
+
+bool OpenTxSimulator::runTimeline(const QString & timelineFile, const QString & outputFile, const char * filename, bool tests)
+{
+  if (isRunning())
+    return false;
+  OTXS_DBG << "timeline:" << timelineFile << "output:" << outputFile;
+
+  QVector<TimelineEvent> timeline;
+  quint32 duration;
+  if (!loadTimeline(timelineFile, timeline, duration))
+    return false;
+
+  QFile output(outputFile);
+  if (!output.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    qWarning() << "Cannot open" << outputFile << output.errorString();
+    return false;
+  }
+  QTextStream out(&output);
+  out << "Time(ms)";
+  for (unsigned i=0; i < DIM(channelOutputs); i++) {
+    out << ",CH" << i+1;
+  }
+  out << ",LSW,FM\n";
+
+  // the inputs at 0 are set before the firmware starts
+  int next = applyTimeline(timeline, 0, 0);
+
+  m_virtualTime = true;
+  simuSetVirtualTime(true);
+  start(filename, tests);
+
+  quint32 time = 0;
+  QString lastOutputs;
+  while (time < duration && isRunning()) {
+    next = applyTimeline(timeline, next, time);
+    simuAdvanceTime(10 * 1000);
+    per10ms();
+    time += 10;
+    QString outputs = getTimelineOutputs();
+    if (outputs != lastOutputs) {
+      out << time << outputs << "\n";
+      lastOutputs = outputs;
+    }
+  }
+
+  bool result = (time >= duration && isRunning());
+  if (!result)
+    qWarning() << "Simulation stopped at" << time << "ms:" << getError();
+
+  stop();
+  simuSetVirtualTime(false);
+  m_virtualTime = false;
+  return result;
+}
+
+bool OpenTxSimulator::loadTimeline(const QString & timelineFile, QVector<TimelineEvent> & timeline, quint32 & duration)
+{
+  // same order as InputSourceType
+  static const QStringList inputs = QStringList() << "" << "analog" << "stick" << "knob" << "slider" << "txvin" << "switch" << "trimsw" << "trim" << "key" << "" << "trainer";
+
+  QFile file(timelineFile);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    qWarning() << "Cannot open" << timelineFile << file.errorString();
+    return false;
+  }
+
+  duration = 0;
+  int line = 0;
+  QTextStream in(&file);
+  while (!in.atEnd()) {
+    QStringList fields = in.readLine().section('#', 0, 0).simplified().split(' ', QString::SkipEmptyParts);
+    line++;
+    if (fields.isEmpty())
+      continue;
+
+    TimelineEvent event;
+    event.index = 0;
+    event.value = 0;
+    bool ok = (fields.size() >= 2);
+    if (ok) {
+      event.time = fields[0].toUInt(&ok);
+      event.type = inputs.indexOf(fields[1]);
+    }
+    if (ok && event.time < duration)
+      ok = false;  // the events have to be in time order
+
+    if (ok) {
+      if (fields[1] == "end" && fields.size() == 2) {
+        duration = event.time;
+        return true;
+      }
+      else if (fields[1] == "telemetry" && fields.size() > 2) {
+        event.type = INPUT_SRC_NONE;
+        event.telemetry = QByteArray::fromHex(QStringList(fields.mid(2)).join("").toLatin1());
+      }
+      else if (event.type == INPUT_SRC_TXVIN && fields.size() == 3) {
+        event.value = fields[2].toShort(&ok);
+      }
+      else if (event.type > INPUT_SRC_NONE && fields.size() == 4) {
+        event.index = fields[2].toUShort(&ok);
+        if (ok)
+          event.value = fields[3].toShort(&ok);
+      }
+      else {
+        ok = false;
+      }
+    }
+
+    if (!ok) {
+      qWarning() << timelineFile << "line" << line << ": invalid event" << fields.join(" ");
+      return false;
+    }
+    timeline.append(event);
+    duration = event.time;
+  }
+
+  // no end event, the last event is applied
+  duration += 10;
+  return true;
+}
+
+// Returns the index of the first event after time
+int OpenTxSimulator::applyTimeline(const QVector<TimelineEvent> & timeline, int next, quint32 time)
+{
+  for (; next < timeline.size() && timeline[next].time <= time; next++) {
+    const TimelineEvent & event = timeline[next];
+    if (event.type == INPUT_SRC_NONE)
+      sendTelemetry(event.telemetry);
+    else
+      setInputValue(event.type, event.index, event.value);
+  }
+  return next;
+}
+
+QString OpenTxSimulator::getTimelineOutputs()
+{
+  QString result;
+  QTextStream out(&result);
+
+  for (unsigned i=0; i < DIM(channelOutputs); i++) {
+    out << "," << channelOutputs[i];
+  }
+
+  quint64 lsw = 0;
+  for (unsigned i=0; i < MAX_LOGICAL_SWITCHES; i++) {
+    bool state = GET_SWITCH_BOOL(SWSRC_SW1+i);
+    if (state)
+      lsw |= (quint64)1 << i;
+  }
+  out << ",0x" << QString::number(lsw, 16).toUpper().rightJustified(16, '0');
+  out << "," << getFlightMode();
+
+  return result;
+}
+
 
 /*** Protected functions ***/
 
@@ -45,6 +45,7 @@ class DLLEXPORT OpenTxSimulator : public SimulatorInterface
     virtual uint8_t getSensorInstance(uint16_t id, uint8_t defaultValue = 0);
     virtual uint16_t getSensorRatio(uint16_t id);
     virtual const int getCapability(Capability cap);
+    virtual bool runTimeline(const QString & timelineFile, const QString & outputFile, const char * filename = NULL, bool tests = true);
 
     static QVector<QIODevice *> tracebackDevices;
 
@@ -76,6 +77,14 @@ class DLLEXPORT OpenTxSimulator : public SimulatorInterface
 
   protected:
 
+    struct TimelineEvent {
+      quint32 time;  // ms
+      int type;      // InputSourceType, or INPUT_SRC_NONE for the telemetry packets
+      quint8 index;
+      qint16 value;
+      QByteArray telemetry;
+    };
+
     bool isStopRequested();
     void setStopRequested(bool stop);
     bool checkLcdChanged();
@@ -85,6 +94,9 @@ class DLLEXPORT OpenTxSimulator : public SimulatorInterface
     const QString getCurrentPhaseName();
     const char * getError();
     const int voltageToAdc(const int volts);
+    bool loadTimeline(const QString & timelineFile, QVector<TimelineEvent> & timeline, quint32 & duration);
+    int applyTimeline(const QVector<TimelineEvent> & timeline, int next, quint32 time);
+    QString getTimelineOutputs();
 
     QString simuSdDirectory;
     QString simuSettingsDirectory;
@@ -97,6 +109,7 @@ class DLLEXPORT OpenTxSimulator : public SimulatorInterface
     int volumeGain;
     bool m_resetOutputsData;
     bool m_stopRequested;
+    bool m_virtualTime;
 
 };
 
@@ -81,8 +81,151 @@ void toplcdOff()
 {
 }
 
+// Virtual time (headless simulation)
+//
+// When enabled, simuTimerMicros() returns a virtual clock which only advances
+// in simuAdvanceTime(), and the firmware tasks sleep in virtual time. Once all
+// of them sleep, the clock jumps to the next wake-up and wakes the tasks one at
+// a time, in priority order as CoOS would. The simulation then runs as fast as
+// the CPU allows and gives the same results on each run. A task must not block
+// on anything else than a sleep for long, the clock would wait for it.
+
+struct SimuTaskSleep {
+  uint64_t wakeup;
+  uint32_t priority;
+  bool woken;
+  SimuTaskSleep * next;
+};
+
+struct SimuVirtualClock {
+  bool enabled;
+  uint64_t micros;
+  int running;                   // tasks not sleeping
+  SimuTaskSleep * sleeping;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+};
+
+static SimuVirtualClock simuClock = { false, 0, 0, NULL, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+#define SIMU_NOT_A_TASK        UINT32_MAX
+#define SIMU_MAIN_TASK_PRIO    (UINT32_MAX - 1)
+
+static thread_local uint32_t simuTaskPriority = SIMU_NOT_A_TASK;
+
+static void simuWakeAllTasks();
+
+// Only while the simulation is stopped
+void simuSetVirtualTime(bool enable)
+{
+  if (!main_thread_running) {
+    if (enable) {
+      simuClock.running = 0;
+      simuClock.sleeping = NULL;
+    }
+    else {
+      simuWakeAllTasks();
+    }
+    simuClock.enabled = enable;
+  }
+}
+
+// Called by the thread which creates the task, before it may sleep
+static void simuTaskCreated()
+{
+  if (simuClock.enabled) {
+    pthread_mutex_lock(&simuClock.mutex);
+    simuClock.running++;
+    pthread_mutex_unlock(&simuClock.mutex);
+  }
+}
+
+static void simuTaskFinished()
+{
+  if (simuClock.enabled) {
+    pthread_mutex_lock(&simuClock.mutex);
+    simuClock.running--;
+    pthread_cond_broadcast(&simuClock.cond);
+    pthread_mutex_unlock(&simuClock.mutex);
+  }
+}
+
+static void simuWakeAllTasks()
+{
+  pthread_mutex_lock(&simuClock.mutex);
+  for (SimuTaskSleep * task = simuClock.sleeping; task; task = task->next) {
+    task->woken = true;
+    simuClock.running++;
+  }
+  simuClock.sleeping = NULL;
+  pthread_cond_broadcast(&simuClock.cond);
+  pthread_mutex_unlock(&simuClock.mutex);
+}
+
+void simuSleep(unsigned int ms)
+{
+  if (!simuClock.enabled || simuTaskPriority == SIMU_NOT_A_TASK || !main_thread_running) {
+#if defined(_MSC_VER)
+    Sleep(ms);
+#else
+    usleep(1000 * ms);
+#endif
+    return;
+  }
+
+  pthread_mutex_lock(&simuClock.mutex);
+  if (!main_thread_running) {
+    // StopSimu() already woke up the tasks
+    pthread_mutex_unlock(&simuClock.mutex);
+    return;
+  }
+  SimuTaskSleep task = { simuClock.micros + 1000 * ms, simuTaskPriority, false, simuClock.sleeping };
+  simuClock.sleeping = &task;
+  simuClock.running--;
+  pthread_cond_broadcast(&simuClock.cond);
+  while (!task.woken) {
+    pthread_cond_wait(&simuClock.cond, &simuClock.mutex);
+  }
+  pthread_mutex_unlock(&simuClock.mutex);
+}
+
+// Runs the tasks until the virtual clock reaches now + us, returns with all of them sleeping
+void simuAdvanceTime(uint32_t us)
+{
+  pthread_mutex_lock(&simuClock.mutex);
+  uint64_t target = simuClock.micros + us;
+  while (main_thread_running) {
+    while (simuClock.running > 0 && main_thread_running) {
+      pthread_cond_wait(&simuClock.cond, &simuClock.mutex);
+    }
+    SimuTaskSleep ** next = NULL;
+    for (SimuTaskSleep ** task = &simuClock.sleeping; *task; task = &(*task)->next) {
+      if (!next || (*task)->wakeup < (*next)->wakeup || ((*task)->wakeup == (*next)->wakeup && (*task)->priority < (*next)->priority)) {
+        next = task;
+      }
+    }
+    if (!next || (*next)->wakeup > target || !main_thread_running) {
+      break;
+    }
+    SimuTaskSleep * task = *next;
+    *next = task->next;
+    if (task->wakeup > simuClock.micros) {
+      simuClock.micros = task->wakeup;
+    }
+    task->woken = true;
+    simuClock.running++;
+    pthread_cond_broadcast(&simuClock.cond);
+  }
+  simuClock.micros = target;
+  pthread_mutex_unlock(&simuClock.mutex);
+}
+
 uint64_t simuTimerMicros(void)
 {
+  if (simuClock.enabled) {
+    return simuClock.micros;
+  }
+
 #if SIMPGMSPC_USE_QT
 
   static QElapsedTimer ticker;
@@ -378,6 +521,14 @@ void simuSetSwitch(uint8_t swtch, int8_t state)
   }
 }
 
+static void * simuMainTask(void *)
+{
+  simuTaskPriority = SIMU_MAIN_TASK_PRIO;
+  simuMain();
+  simuTaskFinished();
+  return NULL;
+}
+
 void StartSimu(bool tests, const char * sdPath, const char * settingsPath)
 {
   if (main_thread_running)
@@ -415,7 +566,8 @@ void StartSimu(bool tests, const char * sdPath, const char * settingsPath)
   try {
 #endif
 
-  pthread_create(&main_thread_pid, NULL, &simuMain, NULL);
+  simuTaskCreated();
+  pthread_create(&main_thread_pid, NULL, &simuMainTask, NULL);
 
 #if defined(SIMU_EXCEPTIONS)
   }
@@ -430,10 +582,14 @@ void StopSimu()
     return;
 
   main_thread_running = 0;
+  simuWakeAllTasks();
 
 #if defined(CPUARM)
   pthread_join(mixerTaskId, NULL);
   pthread_join(menusTaskId, NULL);
+#if defined(TELEMETRY_FRSKY) || defined(TELEMETRY_MAVLINK)
+  pthread_join(telemetryTaskId, NULL);
+#endif
 #if IS_TOUCH_ENABLED()
   pthread_join(TouchManager::taskId(), NULL);
 #endif
@@ -629,6 +785,9 @@ void lcdRefresh()
     lightEnabled = (bool)isBacklightEnabled();
     simuLcdRefresh = true;
   }
+#if defined(COLORLCD)
+  lcdRefreshCount++;
+#endif
 }
 
 void telemetryPortInit(uint8_t baudrate)
@@ -741,16 +900,26 @@ void serialCrlf() { }
 void serialPutc(char c) { }
 uint16_t stackSize() { return 0; }
 
+struct SimuTask {
+  FUNCPtr task;
+  void * argv;
+  uint32_t priority;
+};
+
 void * start_routine(void * attr)
 {
-  FUNCPtr task = (FUNCPtr)attr;
-  task(NULL);
+  SimuTask task = *(SimuTask *)attr;
+  delete (SimuTask *)attr;
+  simuTaskPriority = task.priority;
+  task.task(task.argv);
+  simuTaskFinished();
   return NULL;
 }
 
 OS_TID CoCreateTask(FUNCPtr task, void *argv, uint32_t parameter, void * stk, uint32_t stksize)
 {
   pthread_t tid;
-  pthread_create(&tid, NULL, start_routine, (void *)task);
+  simuTaskCreated();
+  pthread_create(&tid, NULL, start_routine, new SimuTask { task, argv, parameter });
   return tid;
 }
@@ -23,16 +23,18 @@
 
 #ifndef __GNUC__
 #include <windows.h>
-#define sleep(x) Sleep(x)
 #define strcasecmp  _stricmp
 #define strncasecmp _tcsnicmp
 #define chdir  _chdir
 #define getcwd _getcwd
 #else
 #include <unistd.h>
-#define sleep(x) usleep(1000*x)
 #endif
 
+// the firmware tasks sleep in virtual time when it is enabled (see simuSetVirtualTime())
+void simuSleep(unsigned int ms);
+#define sleep(x) simuSleep(x)
+
 #ifdef SIMU_EXCEPTIONS
 extern char * main_thread_error;
 #include <stdlib.h>
@@ -348,6 +350,8 @@ extern uint32_t Master_frequency;
 #define NVIC_SystemReset() exit(0)
 #define __disable_irq()
 #define __enable_irq()
+#define __get_PRIMASK()                0
+#define __DMB()                        __sync_synchronize()
 #endif
 
 extern uint8_t portb, portc, porth, dummyport;
@@ -364,6 +368,9 @@ extern char * main_thread_error;
 
 uint64_t simuTimerMicros(void);
 
+void simuSetVirtualTime(bool enable);
+void simuAdvanceTime(uint32_t us);
+
 void simuInit();
 void StartSimu(bool tests=true, const char * sdPath = 0, const char * settingsPath = 0);
 void StopSimu();
@@ -425,6 +432,7 @@ typedef U8                 StatusType;
 OS_TID CoCreateTask(FUNCPtr task, void *argv, uint32_t parameter, void * stk, uint32_t stksize);
 U64 CoGetOSTime(void);
 #define CoCreateTaskEx(...)            0
+#define CoGetCurTaskID()               pthread_self()
 
 #define CoCreateMutex(...)             PTHREAD_MUTEX_INITIALIZER
 #define CoEnterMutexSection(m)         pthread_mutex_lock(&(m))
@@ -218,6 +218,9 @@ void disable_sbusOut(uint32_t module_index);
   void stop_cppm_on_heartbeat_capture(void);
   void init_sbus_on_heartbeat_capture(void);
   void stop_sbus_on_heartbeat_capture(void);
+#if defined(PCBX9E)
+  void heartbeatUsartIrq(void); // USART6 is shared with Bluetooth, called from its IRQ handler
+#endif
 #else
   #define init_cppm_on_heartbeat_capture()
   #define stop_cppm_on_heartbeat_capture()
@@ -225,9 +228,6 @@ void disable_sbusOut(uint32_t module_index);
   #define stop_sbus_on_heartbeat_capture()
 #endif
 
-// SBUS
-int sbusGetByte(uint8_t * byte);
-
 // Keys driver
 enum EnumKeys
 {
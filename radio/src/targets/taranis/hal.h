@@ -712,6 +712,7 @@
   #define SERIAL_USART_IRQn             USART3_IRQn
   #define SERIAL_DMA_Stream_RX          DMA1_Stream1
   #define SERIAL_DMA_Channel_RX         DMA_Channel_4
+  #define SERIAL_DMA_FLAGS_RX           (DMA_FLAG_FEIF1 | DMA_FLAG_DMEIF1 | DMA_FLAG_TEIF1 | DMA_FLAG_HTIF1 | DMA_FLAG_TCIF1)
 #endif
 
 // Telemetry
@@ -779,6 +780,7 @@
   #define HEARTBEAT_USART_IRQn          USART6_IRQn
   #define HEARTBEAT_DMA_Stream          DMA2_Stream1
   #define HEARTBEAT_DMA_Channel         DMA_Channel_5
+  #define HEARTBEAT_DMA_FLAGS           (DMA_FLAG_FEIF1 | DMA_FLAG_DMEIF1 | DMA_FLAG_TEIF1 | DMA_FLAG_HTIF1 | DMA_FLAG_TCIF1)
 #endif
 
 // USB
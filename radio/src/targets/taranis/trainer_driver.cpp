@@ -244,10 +244,16 @@ void init_sbus_on_heartbeat_capture()
   USART_DMACmd(HEARTBEAT_USART, USART_DMAReq_Rx, ENABLE);
   USART_Cmd(HEARTBEAT_USART, ENABLE);
   DMA_Cmd(HEARTBEAT_DMA_Stream, ENABLE);
+
+  // the line goes idle at the end of each frame
+  USART_ITConfig(HEARTBEAT_USART, USART_IT_IDLE, ENABLE);
+  NVIC_SetPriority(HEARTBEAT_USART_IRQn, 7);
+  NVIC_EnableIRQ(HEARTBEAT_USART_IRQn);
 }
 
 void stop_sbus_on_heartbeat_capture()
 {
+  USART_ITConfig(HEARTBEAT_USART, USART_IT_IDLE, DISABLE);
   DMA_Cmd(HEARTBEAT_DMA_Stream, DISABLE);
   USART_Cmd(HEARTBEAT_USART, DISABLE);
   USART_DMACmd(HEARTBEAT_USART, USART_DMAReq_Rx, DISABLE);
@@ -259,16 +265,17 @@ void stop_sbus_on_heartbeat_capture()
   }
 }
 
-int sbusGetByte(uint8_t * byte)
-{
-  switch (currentTrainerMode) {
-    case TRAINER_MODE_MASTER_SBUS_EXTERNAL_MODULE:
-      return heartbeatFifo.pop(*byte);
-#if !defined(PCBX7) && !defined(PCBX9E)
-    case TRAINER_MODE_MASTER_BATTERY_COMPARTMENT:
-      return serial2RxFifo.pop(*byte);
+#if defined(PCBX9E)
+void heartbeatUsartIrq()
+#else
+extern "C" void HEARTBEAT_USART_IRQHandler()
 #endif
-    default:
-      return false;
+{
+  DEBUG_INTERRUPT(INT_TRAINER);
+
+  if (USART_GetITStatus(HEARTBEAT_USART, USART_IT_IDLE) != RESET) {
+    USART_ReceiveData(HEARTBEAT_USART); // clears the IDLE flag
+    uint32_t size = heartbeatFifo.restart(HEARTBEAT_DMA_FLAGS);
+    processSbusFrame(heartbeatFifo.buffer(), ppmInput, size);
   }
 }
@@ -30,8 +30,20 @@ TaskStack<MIXER_STACK_SIZE> mixerStack;
 OS_TID audioTaskId;
 TaskStack<AUDIO_STACK_SIZE> audioStack;
 
+#if defined(TELEMETRY_FRSKY) || defined(TELEMETRY_MAVLINK)
+OS_TID telemetryTaskId;
+TaskStack<TELEMETRY_STACK_SIZE> telemetryStack;
+#endif
+
+#if defined(STORAGE_TASK)
+OS_TID storageTaskId;
+TaskStack<STORAGE_STACK_SIZE> storageStack;
+OS_FlagID storageFlag;
+#endif
+
 OS_MutexID audioMutex;
 OS_MutexID mixerMutex;
+OS_MutexID telemetryMutex;
 
 OS_FlagID openTxInitCompleteFlag;
 
@@ -39,6 +51,7 @@ enum TaskIndex {
   MENU_TASK_INDEX,
   MIXER_TASK_INDEX,
   AUDIO_TASK_INDEX,
+  TELEMETRY_TASK_INDEX,
   CLI_TASK_INDEX,
   TOUCH_TASK_INDEX,
   BLUETOOTH_TASK_INDEX,
@@ -69,6 +82,12 @@ void stackPaint()
   menusStack.paint();
   mixerStack.paint();
   audioStack.paint();
+#if defined(TELEMETRY_FRSKY) || defined(TELEMETRY_MAVLINK)
+  telemetryStack.paint();
+#endif
+#if defined(STORAGE_TASK)
+  storageStack.paint();
+#endif
 #if defined(CLI)
   cliStack.paint();
 #endif
@@ -110,11 +129,125 @@ bool isForcePowerOffRequested()
   return false;
 }
 
-uint32_t nextMixerTime[NUM_MODULES];
+// Mixer scheduler
+//
+// Each module pulses interrupt announces the start of its next frame through
+// scheduleNextMixerCalculation(). The mixer task sleeps until the last OS tick
+// which still lets doMixerCalculations() complete before the earliest of these
+// frames, instead of waking up on every tick.
+
+#define MIXER_SCHEDULER_TICK_US        2000  // CoOS tick
+#define MIXER_SCHEDULER_MARGIN_US      250   // ISR latency + pulses setup
+
+#if !defined(SIMU) && defined(STM32)
+  #define MIXER_KEEP_ALIVE_TICKS       (usbStarted() ? 5 : 10)  // run at least every 20ms (every 10ms if USB is active)
+#else
+  #define MIXER_KEEP_ALIVE_TICKS       10                        // run at least every 20ms
+#endif
+
+struct MixerSchedule {
+  uint32_t deadline;   // OS tick at which the mixer has to start for the next frame
+  uint32_t lastFrame;  // OS tick at which the last frame was announced
+  uint16_t period;     // frame period in us, 0 when the module doesn't use the mixer scheduler
+  bool pending;        // deadline not yet served by a mixer run
+};
+
+volatile MixerSchedule mixerSchedules[NUM_MODULES];
+
+// Running high-percentile estimate of doMixerCalculations() duration (2MHz
+// ticks): fast attack on longer runs, slow decay on shorter ones. Starts with
+// the 2ms which used to be hardcoded.
+uint16_t mixerDurationEstimate = 2 * 2000;
+
+static void updateMixerDurationEstimate(uint16_t duration)
+{
+  if (duration > mixerDurationEstimate)
+    mixerDurationEstimate += (duration - mixerDurationEstimate + 3) / 4;
+  else
+    mixerDurationEstimate -= (mixerDurationEstimate - duration) / 64;
+}
+
+// Lead time between the mixer start and the frame start, in us
+static inline uint32_t getMixerLeadTime()
+{
+  return mixerDurationEstimate / 2 + MIXER_SCHEDULER_MARGIN_US;
+}
+
+// Number of whole OS ticks which may be slept after a frame start while still
+// starting the mixer <lead> us before the next frame
+static inline uint32_t getMixerTicksBeforeDeadline(uint32_t period)
+{
+  uint32_t lead = getMixerLeadTime();
+  return period > lead ? (period - lead) / MIXER_SCHEDULER_TICK_US : 0;
+}
+
+// Called from the pulses interrupt, delay is the module frame period in ms
+void scheduleNextMixerCalculation(uint8_t module, uint16_t delay)
+{
+  uint32_t now = (uint32_t)CoGetOSTime();
+  uint16_t period = delay * 1000;
+  volatile MixerSchedule & schedule = mixerSchedules[module];
+  schedule.period = period;
+  schedule.lastFrame = now;
+  schedule.deadline = now + getMixerTicksBeforeDeadline(period);
+  schedule.pending = true;
+  DEBUG_TIMER_STOP(debugTimerMixerCalcToUsage);
+}
+
+// Returns true when a module deadline is reached, and marks it served
+static bool checkMixerDeadlines(uint32_t now)
+{
+  bool run = false;
+  for (uint8_t i=0; i<NUM_MODULES; i++) {
+    volatile MixerSchedule & schedule = mixerSchedules[i];
+    if (schedule.pending && (int32_t)(now - schedule.deadline) >= 0) {
+      schedule.pending = false;
+      run = true;
+    }
+  }
+  return run;
+}
+
+// Returns the OS tick at which the mixer task has to wake up next. Deadlines
+// of all modules are merged: the one already announced, or for a module whose
+// deadline has been served, the earliest deadline its next frame could announce.
+static uint32_t getNextMixerWakeup(uint32_t now, uint32_t lastRunTime)
+{
+  uint32_t wakeup = lastRunTime + MIXER_KEEP_ALIVE_TICKS;
+
+  for (uint8_t i=0; i<NUM_MODULES; i++) {
+    volatile MixerSchedule & schedule = mixerSchedules[i];
+    uint16_t period = schedule.period;
+    uint32_t deadline;
+    if (schedule.pending) {
+      deadline = schedule.deadline;
+    }
+    else if (period) {
+      uint32_t periodTicks = period / MIXER_SCHEDULER_TICK_US;
+      deadline = schedule.lastFrame + periodTicks + getMixerTicksBeforeDeadline(period);
+      if ((int32_t)(deadline - now) <= 0) {
+        if (now - schedule.lastFrame > 2 * periodTicks + 2) {
+          continue;  // the module stopped announcing frames (pulses paused, protocol change)
+        }
+        // the module didn't announce its frame yet, check again on next tick
+        deadline = now + 1;
+      }
+    }
+    else {
+      continue;
+    }
+    if ((int32_t)(deadline - wakeup) < 0) {
+      wakeup = deadline;
+    }
+  }
+
+  return wakeup;
+}
 
 void mixerTask(void * pdata)
 {
-  static uint32_t lastRunTime;
+  uint32_t lastRunTime = 0;
+  uint32_t now = (uint32_t)CoGetOSTime();
   s_pulses_paused = true;
 
   while(1) {
@@ -124,33 +257,18 @@ void mixerTask(void * pdata)
       return;
 #endif
 
-#if defined(SBUS)
-    processSbusInput();
-#endif
-
-    CoTickDelay(1);
+    int32_t delay = (int32_t)(getNextMixerWakeup(now, lastRunTime) - now);
+    CoTickDelay(delay > 0 ? delay : 1);
 
     if (isForcePowerOffRequested()) {
       pwrOff();
     }
 
-    uint32_t now = CoGetOSTime();
-    bool run = false;
-#if !defined(SIMU) && defined(STM32)
-    if ((now - lastRunTime) >= (usbStarted() ? 5 : 10)) {     // run at least every 20ms (every 10ms if USB is active)
-#else
-    if ((now - lastRunTime) >= 10) {     // run at least every 20ms
-#endif
-      run = true;
-    }
-    else if (now == nextMixerTime[0]) {
+    now = (uint32_t)CoGetOSTime();
+    bool run = checkMixerDeadlines(now);
+    if ((now - lastRunTime) >= MIXER_KEEP_ALIVE_TICKS) {
       run = true;
     }
-#if NUM_MODULES >= 2
-    else if (now == nextMixerTime[1]) {
-      run = true;
-    }
-#endif
     if (!run) {
       continue;  // go back to sleep
     }
@@ -163,6 +281,7 @@ void mixerTask(void * pdata)
       DEBUG_TIMER_START(debugTimerMixer);
       CoEnterMutexSection(mixerMutex);
       doMixerCalculations();
+      updateMixerDurationEstimate((uint16_t)(getTmr2MHz() - t0));
       DEBUG_TIMER_START(debugTimerMixerCalcToUsage);
       DEBUG_TIMER_SAMPLE(debugTimerMixerIterval);
       CoLeaveMutexSection(mixerMutex);
@@ -174,10 +293,8 @@ void mixerTask(void * pdata)
       }
 #endif
 
-#if defined(TELEMETRY_FRSKY) || defined(TELEMETRY_MAVLINK)
-      DEBUG_TIMER_START(debugTimerTelemetryWakeup);
-      telemetryWakeup();
-      DEBUG_TIMER_STOP(debugTimerTelemetryWakeup);
+#if defined(LOGS_BINARY)
+      logsRecord();
 #endif
 
 #if defined(BLUETOOTH)
@@ -192,16 +309,42 @@ void mixerTask(void * pdata)
       t0 = getTmr2MHz() - t0;
       if (t0 > maxMixerDuration) maxMixerDuration = t0 ;
     }
+
+    now = (uint32_t)CoGetOSTime();
   }
 }
 
-void scheduleNextMixerCalculation(uint8_t module, uint16_t delay)
+#if defined(TELEMETRY_FRSKY) || defined(TELEMETRY_MAVLINK)
+// Telemetry task
+//
+// The telemetry bytes are decoded, the calculated sensors evaluated and the
+// alarms checked here, below the mixer and audio priorities: a burst of
+// telemetry never delays a mixer run nor the sound, and the menus still come
+// after it. The mixer task only reads the sensors values published
+// at the end of each telemetryWakeup() (see telemetry_sensors.h).
+
+#define TELEMETRY_TASK_PERIOD_TICKS    2     // 4ms, the telemetry FIFO holds more than 10ms at 400kbaud
+
+void telemetryTask(void * pdata)
 {
-  // Schedule next mixer calculation time,
-  // for now assume mixer calculation takes 2 ms.
-  nextMixerTime[module] = (uint32_t)CoGetOSTime() + (delay)/2 - 1/*2ms*/;
-  DEBUG_TIMER_STOP(debugTimerMixerCalcToUsage);
+  while (1) {
+#if defined(SIMU)
+    if (main_thread_running == 0)
+      return;
+#endif
+
+    CoTickDelay(TELEMETRY_TASK_PERIOD_TICKS);
+
+    if (!s_pulses_paused) {
+      DEBUG_TIMER_START(debugTimerTelemetryWakeup);
+      CoEnterMutexSection(telemetryMutex);
+      telemetryWakeup();
+      CoLeaveMutexSection(telemetryMutex);
+      DEBUG_TIMER_STOP(debugTimerTelemetryWakeup);
+    }
+  }
 }
+#endif
 
 #define MENU_TASK_PERIOD_TICKS      25    // 50ms
 
@@ -276,6 +419,14 @@ void tasksStart()
   mixerTaskId = CoCreateTask(mixerTask, NULL, MIXER_TASK_PRIO, &mixerStack.stack[MIXER_STACK_SIZE-1], MIXER_STACK_SIZE);
   menusTaskId = CoCreateTask(menusTask, NULL, MENUS_TASK_PRIO, &menusStack.stack[MENUS_STACK_SIZE-1], MENUS_STACK_SIZE);
 
+#if defined(TELEMETRY_FRSKY) || defined(TELEMETRY_MAVLINK)
+  telemetryTaskId = CoCreateTask(telemetryTask, NULL, TELEMETRY_TASK_PRIO, &telemetryStack.stack[TELEMETRY_STACK_SIZE-1], TELEMETRY_STACK_SIZE);
+#endif
+
+#if defined(STORAGE_TASK)
+  storageTaskId = CoCreateTask(storageTask, NULL, STORAGE_TASK_PRIO, &storageStack.stack[STORAGE_STACK_SIZE-1], STORAGE_STACK_SIZE);
+#endif
+
 #if !defined(SIMU)
   // TODO move the SIMU audio in this task
   audioTaskId = CoCreateTask(audioTask, NULL, AUDIO_TASK_PRIO, &audioStack.stack[AUDIO_STACK_SIZE-1], AUDIO_STACK_SIZE);
@@ -287,8 +438,12 @@ void tasksStart()
 
   audioMutex = CoCreateMutex();
   mixerMutex = CoCreateMutex();
+  telemetryMutex = CoCreateMutex();
 
   openTxInitCompleteFlag = CoCreateFlag(false, false);
+#if defined(STORAGE_TASK)
+  storageFlag = CoCreateFlag(true, false);
+#endif
 
   CoStartOS();
 }
@@ -31,12 +31,16 @@ extern "C" {
 #define MENUS_STACK_SIZE       2000
 #define MIXER_STACK_SIZE       504
 #define AUDIO_STACK_SIZE       504
+#define TELEMETRY_STACK_SIZE   504
+#define STORAGE_STACK_SIZE     800  // FatFs LFN buffer (512 bytes) and the f_rename() / f_unlink() directories, the FIL and paths are static
 #define TOUCH_STACK_SIZE       400  // TODO: this can be reduced a lot after debug (tracing) is done (on last check only 42 Words are actually used)
 #define BLUETOOTH_STACK_SIZE   504  // WTF: there is no BT task.... ???
 
 #define MIXER_TASK_PRIO        5
 #define AUDIO_TASK_PRIO        7
+#define TELEMETRY_TASK_PRIO    8    // below the audio task, a telemetry burst never delays the sound
 #define MENUS_TASK_PRIO        10
+#define STORAGE_TASK_PRIO      11   // lower prio than GUI, the SD writes never delay the menus
 #define CLI_TASK_PRIO          10
 #define TOUCH_TASK_PRIO        12   // lower prio than GUI! otherwise may block (runs at 1 tick)
 
@@ -81,6 +85,17 @@ extern TaskStack<MIXER_STACK_SIZE> mixerStack;
 extern OS_TID audioTaskId;
 extern TaskStack<AUDIO_STACK_SIZE> audioStack;
 
+#if defined(TELEMETRY_FRSKY) || defined(TELEMETRY_MAVLINK)
+extern OS_TID telemetryTaskId;
+extern TaskStack<TELEMETRY_STACK_SIZE> telemetryStack;
+#endif
+
+#if defined(STORAGE_TASK)
+extern OS_TID storageTaskId;
+extern TaskStack<STORAGE_STACK_SIZE> storageStack;
+extern OS_FlagID storageFlag;
+#endif
+
 extern OS_FlagID openTxInitCompleteFlag;
 
 void tasksStart();
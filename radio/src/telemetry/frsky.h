@@ -433,6 +433,21 @@ void frskyDProcessPacket(const uint8_t *packet);
 // FrSky S.PORT Telemetry Protocol
 void sportProcessTelemetryPacket(const uint8_t * packet);
 
+#if defined(CPUARM)
+struct FrSkySportSensor {
+  const uint16_t firstId;
+  const uint16_t lastId;
+  const uint8_t subId;
+  const char * name;
+  const TelemetryUnit unit;
+  const uint8_t prec;
+};
+
+// sorted by firstId then subId, the ranges don't overlap
+extern const FrSkySportSensor sportSensors[];
+const FrSkySportSensor * getFrSkySportSensor(uint16_t id, uint8_t subId=0);
+#endif
+
 void telemetryWakeup();
 void telemetryReset();
 
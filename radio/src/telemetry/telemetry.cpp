@@ -132,12 +132,8 @@ void telemetryWakeup()
 #endif
 
 #if defined(CPUARM)
-  for (int i=0; i<MAX_TELEMETRY_SENSORS; i++) {
-    const TelemetrySensor & sensor = g_model.telemetrySensors[i];
-    if (sensor.type == TELEM_TYPE_CALCULATED) {
-      telemetryItems[i].eval(sensor);
-    }
-  }
+  applyTelemetryItemsResets();
+  evalCalculatedTelemetrySensors();
 #endif
 
 #if defined(VARIO)
@@ -206,6 +202,8 @@ void telemetryWakeup()
       }
     }
   }
+
+  publishTelemetryValues();
 #endif
 }
 
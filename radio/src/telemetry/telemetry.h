@@ -109,6 +109,34 @@ PACK(struct CellValue
   }
 });
 
+#define TELEMETRY_SENSORS_HASH_BITS    6
+#define TELEMETRY_SENSORS_INDEX_END    0xFF
+
+struct TelemetrySensorsIndex {
+  uint8_t first[1 << TELEMETRY_SENSORS_HASH_BITS];  // first sensor of each hash value
+  uint8_t next[MAX_TELEMETRY_SENSORS];             // next sensor with the same hash value
+  uint8_t version;                                 // modelDataVersion when it was built
+};
+
+extern TelemetrySensorsIndex telemetrySensorsIndex;
+void buildTelemetrySensorsIndex();
+
+#define TELEMETRY_SENSORS_MASK_WORDS   ((MAX_TELEMETRY_SENSORS + 31) / 32)
+#define TELEMETRY_EVAL_ALWAYS          0x80  // flag in TelemetryEvalOrder::order
+
+struct TelemetryEvalOrder {
+  uint8_t order[MAX_TELEMETRY_SENSORS];            // calculated sensors, sources first
+  uint8_t count;
+  uint8_t version;                                 // modelDataVersion when it was built
+};
+
+extern TelemetryEvalOrder telemetryEvalOrder;
+extern volatile uint32_t telemetryItemsChanged[TELEMETRY_SENSORS_MASK_WORDS];
+void buildTelemetryEvalOrder();
+void evalCalculatedTelemetrySensors();
+void requestTelemetryItemReset(uint8_t index);
+void applyTelemetryItemsResets();
+
 int setTelemetryValue(TelemetryProtocol protocol, uint16_t id, uint8_t subId, uint8_t instance, int32_t value, uint32_t unit, uint32_t prec);
 void delTelemetryIndex(uint8_t index);
 int availableTelemetryIndex();
@@ -19,10 +19,34 @@
  */
 
 #include "opentx.h"
+#include "mixer_plan.h"
 
 TelemetryItem telemetryItems[MAX_TELEMETRY_SENSORS];
 uint8_t allowNewSensors;
 
+TelemetryValue telemetryValues[2][MAX_TELEMETRY_SENSORS];
+volatile uint32_t telemetryValuesSeq = 0;
+
+// the buffer not read since the previous publication is written, then published
+// by incrementing the sequence, a reader retries when it has changed
+void publishTelemetryValues()
+{
+  uint32_t seq = telemetryValuesSeq + 1;
+  for (int i=0; i<MAX_TELEMETRY_SENSORS; i++) {
+    const TelemetryItem & item = telemetryItems[i];
+    TelemetryValue & result = telemetryValues[seq & 1][i];
+    result.value = item.value;
+    result.valueMin = item.valueMin;
+    result.valueMax = item.valueMax;
+    result.lastReceived = item.lastReceived;
+    // same layout as in TelemetryItem, the GPS copy carries the date and time as well
+    result.gps.latitude = item.gps.latitude;
+    result.gps.longitude = item.gps.longitude;
+  }
+  __DMB();
+  telemetryValuesSeq = seq;
+}
+
 // TODO in maths
 uint32_t getDistFromEarthAxis(int32_t latitude)
 {
@@ -36,6 +60,8 @@ void TelemetryItem::setValue(const TelemetrySensor & sensor, int32_t val, uint32
 {
   int32_t newVal = val;
 
+  telemetryItemChanged(this);
+
   if (unit == UNIT_CELLS) {
     uint32_t data = uint32_t(newVal);
     uint8_t cellsCount = (data >> 24);
@@ -220,7 +246,7 @@ void TelemetryItem::per10ms(const TelemetrySensor & sensor)
           return;
         }
         else if (currentItem.isOld()) {
-          lastReceived = TELEMETRY_VALUE_OLD;
+          setOld();
           return;
         }
         int32_t current = convertTelemetryValue(currentItem.value, currentSensor.unit, currentSensor.prec, UNIT_AMPS, 1);
@@ -230,6 +256,8 @@ void TelemetryItem::per10ms(const TelemetrySensor & sensor)
           setValue(sensor, value+1, sensor.unit, sensor.prec);
         }
         lastReceived = now();
+        // still fresh, the calculated sensors using it must not become old at low current
+        telemetryItemChanged(this);
       }
       break;
 
@@ -245,7 +273,7 @@ void TelemetryItem::eval(const TelemetrySensor & sensor)
       if (sensor.cell.source) {
         TelemetryItem & cellsItem = telemetryItems[sensor.cell.source-1];
         if (cellsItem.isOld()) {
-          lastReceived = TELEMETRY_VALUE_OLD;
+          setOld();
         }
         else {
           unsigned int index = sensor.cell.index;
@@ -288,13 +316,13 @@ void TelemetryItem::eval(const TelemetrySensor & sensor)
 
     case TELEM_FORMULA_DIST:
       if (sensor.dist.gps) {
-        TelemetryItem gpsItem = telemetryItems[sensor.dist.gps-1];
+        TelemetryItem & gpsItem = telemetryItems[sensor.dist.gps-1];
         TelemetryItem * altItem = NULL;
         if (!gpsItem.isAvailable()) {
           return;
         }
         else if (gpsItem.isOld()) {
-          lastReceived = TELEMETRY_VALUE_OLD;
+          setOld();
           return;
         }
         if (sensor.dist.alt) {
@@ -303,7 +331,7 @@ void TelemetryItem::eval(const TelemetrySensor & sensor)
             return;
           }
           else if (altItem->isOld()) {
-            lastReceived = TELEMETRY_VALUE_OLD;
+            setOld();
             return;
           }
         }
@@ -358,7 +386,7 @@ void TelemetryItem::eval(const TelemetrySensor & sensor)
               return;
             }
             else if (telemetryItem.isOld()) {
-              lastReceived = TELEMETRY_VALUE_OLD;
+              setOld();
               return;
             }
           }
@@ -384,7 +412,7 @@ void TelemetryItem::eval(const TelemetrySensor & sensor)
       if (sensor.formula == TELEM_FORMULA_AVERAGE) {
         if (count == 0) {
           if (available)
-            lastReceived = TELEMETRY_VALUE_OLD;
+            setOld();
           return;
         }
         else {
@@ -405,6 +433,236 @@ void TelemetryItem::eval(const TelemetrySensor & sensor)
   }
 }
 
+// Calculated sensors evaluation
+//
+// The calculated sensors are evaluated in the order of their dependencies, a
+// sensor after its calculated sources, so that a chain of sensors is updated
+// in one telemetryWakeup(). A sensor is only evaluated when one of its
+// sources received a value, became old or was cleared since the previous
+// telemetryWakeup(): each TelemetryItem change sets its bit in
+// telemetryItemsChanged[]. The order is built again, and all sensors are
+// evaluated, when modelDataVersion changes. A sensor which has no source, or
+// which depends on a sensor evaluated after it (a dependency loop), is still
+// evaluated at each telemetryWakeup() as before.
+
+TelemetryEvalOrder telemetryEvalOrder;
+volatile uint32_t telemetryItemsChanged[TELEMETRY_SENSORS_MASK_WORDS];
+
+void telemetryItemChanged(const TelemetryItem * item)
+{
+  unsigned int index = item - telemetryItems;
+  if (index < MAX_TELEMETRY_SENSORS) {
+    // may be called from the 10ms interrupt (consumption sensors)
+    uint32_t prim = __get_PRIMASK();
+    __disable_irq();
+    telemetryItemsChanged[index / 32] |= (1u << (index % 32));
+    if (!prim) __enable_irq();
+  }
+}
+
+// the resets of the special functions, requested by the mixer task and applied
+// by the telemetry task, the only one writing the telemetry items
+static volatile uint32_t telemetryItemsResets[TELEMETRY_SENSORS_MASK_WORDS];
+
+void requestTelemetryItemReset(uint8_t index)
+{
+  uint32_t prim = __get_PRIMASK();
+  __disable_irq();
+  telemetryItemsResets[index / 32] |= (1u << (index % 32));
+  if (!prim) __enable_irq();
+}
+
+void applyTelemetryItemsResets()
+{
+  for (int i=0; i<TELEMETRY_SENSORS_MASK_WORDS; i++) {
+    uint32_t prim = __get_PRIMASK();
+    __disable_irq();
+    uint32_t resets = telemetryItemsResets[i];
+    telemetryItemsResets[i] = 0;
+    if (!prim) __enable_irq();
+    for (int j=0; resets; j++, resets >>= 1) {
+      if (resets & 1) {
+        telemetryItems[i*32 + j].clear();
+      }
+    }
+  }
+}
+
+static bool takeTelemetryItemChanged(uint8_t index)
+{
+  uint32_t mask = (1u << (index % 32));
+  uint32_t prim = __get_PRIMASK();
+  __disable_irq();
+  bool result = telemetryItemsChanged[index / 32] & mask;
+  telemetryItemsChanged[index / 32] &= ~mask;
+  if (!prim) __enable_irq();
+  return result;
+}
+
+static inline bool isTelemetryItemChanged(const uint32_t * changed, uint8_t index)
+{
+  return changed[index / 32] & (1u << (index % 32));
+}
+
+// Returns the number of sources used by TelemetryItem::eval(), 0 when the
+// sensor isn't evaluated there
+static uint8_t getCalculatedSensorSources(const TelemetrySensor & sensor, uint8_t * sources)
+{
+  uint8_t count = 0;
+
+  if (sensor.type != TELEM_TYPE_CALCULATED)
+    return 0;
+
+  switch (sensor.formula) {
+    case TELEM_FORMULA_CELL:
+      if (sensor.cell.source)
+        sources[count++] = sensor.cell.source - 1;
+      break;
+
+    case TELEM_FORMULA_DIST:
+      if (sensor.dist.gps)
+        sources[count++] = sensor.dist.gps - 1;
+      if (sensor.dist.alt)
+        sources[count++] = sensor.dist.alt - 1;
+      break;
+
+    case TELEM_FORMULA_ADD:
+    case TELEM_FORMULA_AVERAGE:
+    case TELEM_FORMULA_MIN:
+    case TELEM_FORMULA_MAX:
+    case TELEM_FORMULA_MULTIPLY:
+      for (int i=0; i<(sensor.formula == TELEM_FORMULA_MULTIPLY ? 2 : 4); i++) {
+        int8_t source = sensor.calc.sources[i];
+        if (source)
+          sources[count++] = abs(source) - 1;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  return count;
+}
+
+static bool isEvaluatedSensor(const TelemetrySensor & sensor)
+{
+  if (sensor.type != TELEM_TYPE_CALCULATED)
+    return false;
+
+  switch (sensor.formula) {
+    case TELEM_FORMULA_CELL:
+    case TELEM_FORMULA_DIST:
+    case TELEM_FORMULA_ADD:
+    case TELEM_FORMULA_AVERAGE:
+    case TELEM_FORMULA_MIN:
+    case TELEM_FORMULA_MAX:
+    case TELEM_FORMULA_MULTIPLY:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void buildTelemetryEvalOrder()
+{
+  TelemetryEvalOrder & evalOrder = telemetryEvalOrder;
+  uint8_t sources[4];
+  bool placed[MAX_TELEMETRY_SENSORS];
+
+  // the other sensors are only sources here
+  for (int i=0; i<MAX_TELEMETRY_SENSORS; i++) {
+    placed[i] = !isEvaluatedSensor(g_model.telemetrySensors[i]);
+  }
+
+  // each time the first sensor whose sources are all placed, or the first
+  // sensor not yet placed when the others are in a dependency loop
+  evalOrder.count = 0;
+  while (1) {
+    int next = -1, first = -1;
+    for (int i=0; i<MAX_TELEMETRY_SENSORS; i++) {
+      if (placed[i])
+        continue;
+      if (first < 0)
+        first = i;
+      uint8_t count = getCalculatedSensorSources(g_model.telemetrySensors[i], sources);
+      bool ready = true;
+      for (uint8_t j=0; j<count; j++) {
+        if (sources[j] < MAX_TELEMETRY_SENSORS && !placed[sources[j]])
+          ready = false;
+      }
+      if (ready) {
+        next = i;
+        break;
+      }
+    }
+    if (next < 0)
+      next = first;
+    if (next < 0)
+      break;
+    placed[next] = true;
+    evalOrder.order[evalOrder.count++] = next;
+  }
+
+  // then the sensors which have to be evaluated each time
+  for (int i=0; i<evalOrder.count; i++) {
+    uint8_t index = evalOrder.order[i];
+    uint8_t count = getCalculatedSensorSources(g_model.telemetrySensors[index], sources);
+    bool always = (count == 0);
+    for (uint8_t j=0; j<count; j++) {
+      for (int k=i; k<evalOrder.count; k++) {
+        if ((evalOrder.order[k] & ~TELEMETRY_EVAL_ALWAYS) == sources[j])
+          always = true;
+      }
+    }
+    if (always) {
+      evalOrder.order[i] |= TELEMETRY_EVAL_ALWAYS;
+    }
+  }
+
+  evalOrder.version = modelDataVersion;
+}
+
+void evalCalculatedTelemetrySensors()
+{
+  bool all = false;
+  if (telemetryEvalOrder.version != modelDataVersion) {
+    buildTelemetryEvalOrder();
+    all = true;
+  }
+
+  // the changes since the previous call, then the ones of the sensors evaluated now
+  uint32_t changed[TELEMETRY_SENSORS_MASK_WORDS];
+  uint32_t prim = __get_PRIMASK();
+  __disable_irq();
+  for (int i=0; i<TELEMETRY_SENSORS_MASK_WORDS; i++) {
+    changed[i] = telemetryItemsChanged[i];
+    telemetryItemsChanged[i] = 0;
+  }
+  if (!prim) __enable_irq();
+
+  for (int i=0; i<telemetryEvalOrder.count; i++) {
+    uint8_t index = telemetryEvalOrder.order[i] & ~TELEMETRY_EVAL_ALWAYS;
+    const TelemetrySensor & sensor = g_model.telemetrySensors[index];
+    bool eval = all || (telemetryEvalOrder.order[i] & TELEMETRY_EVAL_ALWAYS);
+    if (!eval) {
+      uint8_t sources[4];
+      uint8_t count = getCalculatedSensorSources(sensor, sources);
+      for (uint8_t j=0; j<count; j++) {
+        if (sources[j] < MAX_TELEMETRY_SENSORS && isTelemetryItemChanged(changed, sources[j]))
+          eval = true;
+      }
+    }
+    if (eval) {
+      telemetryItems[index].eval(sensor);
+    }
+    // the sensors after this one see its change now, not on the next call
+    if (takeTelemetryItemChanged(index)) {
+      changed[index / 32] |= (1u << (index % 32));
+    }
+  }
+}
+
 void delTelemetryIndex(uint8_t index)
 {
   memclear(&g_model.telemetrySensors[index], sizeof(TelemetrySensor));
@@ -434,23 +692,82 @@ int lastUsedTelemetryIndex()
   return -1;
 }
 
+// Sensors lookup index
+//
+// setTelemetryValue() is called in the telemetry task for each decoded value.
+// The custom sensors are found through a hash table on their id, subId and
+// instance (not the instance when g_model.ignoreSensorIds is set), chained in
+// the sensors order, whatever their label, as the former linear scan did. The table is built again when modelDataVersion changes,
+// that is on each model load or edit, sensors discovery and deletion included.
+// The entries are checked against the sensor on each lookup: a sensor changed
+// without storageDirty() may be missed, never wrongly matched.
+
+TelemetrySensorsIndex telemetrySensorsIndex;
+
+static inline uint8_t getTelemetrySensorHash(uint16_t id, uint8_t subId, uint8_t instance)
+{
+  uint32_t key = ((uint32_t)id << 16) + ((uint32_t)subId << 8) + (g_model.ignoreSensorIds ? 0 : instance);
+  return (key * 2654435761u) >> (32 - TELEMETRY_SENSORS_HASH_BITS);
+}
+
+static inline bool isTelemetrySensorMatching(const TelemetrySensor & sensor, uint16_t id, uint8_t subId, uint8_t instance)
+{
+  return sensor.type == TELEM_TYPE_CUSTOM && sensor.id == id && sensor.subId == subId && (sensor.instance == instance || g_model.ignoreSensorIds);
+}
+
+void buildTelemetrySensorsIndex()
+{
+  TelemetrySensorsIndex & sensorsIndex = telemetrySensorsIndex;
+  memset(sensorsIndex.first, TELEMETRY_SENSORS_INDEX_END, sizeof(sensorsIndex.first));
+  // inserted backwards to keep the sensors order in the chains
+  for (int index=MAX_TELEMETRY_SENSORS-1; index>=0; index--) {
+    const TelemetrySensor & sensor = g_model.telemetrySensors[index];
+    if (sensor.type == TELEM_TYPE_CUSTOM) {
+      uint8_t hash = getTelemetrySensorHash(sensor.id, sensor.subId, sensor.instance);
+      sensorsIndex.next[index] = sensorsIndex.first[hash];
+      sensorsIndex.first[hash] = index;
+    }
+  }
+  sensorsIndex.version = modelDataVersion;
+}
+
 int setTelemetryValue(TelemetryProtocol protocol, uint16_t id, uint8_t subId, uint8_t instance, int32_t value, uint32_t unit, uint32_t prec)
 {
   bool available = false;
 
-  for (int index=0; index<MAX_TELEMETRY_SENSORS; index++) {
-    TelemetrySensor & telemetrySensor = g_model.telemetrySensors[index];
-    if (telemetrySensor.type == TELEM_TYPE_CUSTOM && telemetrySensor.id == id && telemetrySensor.subId == subId && (telemetrySensor.instance == instance || g_model.ignoreSensorIds)) {
-      telemetryItems[index].setValue(telemetrySensor, value, unit, prec);
+  if (telemetrySensorsIndex.version != modelDataVersion) {
+    buildTelemetrySensorsIndex();
+  }
+
+  // the chain length is bounded in case the index is built again in another task at the same time
+  uint8_t entry = telemetrySensorsIndex.first[getTelemetrySensorHash(id, subId, instance)];
+  for (int count=0; entry<MAX_TELEMETRY_SENSORS && count<MAX_TELEMETRY_SENSORS; count++) {
+    TelemetrySensor & telemetrySensor = g_model.telemetrySensors[entry];
+    if (isTelemetrySensorMatching(telemetrySensor, id, subId, instance)) {
+      telemetryItems[entry].setValue(telemetrySensor, value, unit, prec);
       available = true;
       // we continue search here, because sensors can share the same id and instance
     }
+    entry = telemetrySensorsIndex.next[entry];
   }
 
   if (available || !allowNewSensors) {
     return -1;
   }
 
+  // before creating a new sensor, the sensors which may have been missed by the index
+  for (int i=0; i<MAX_TELEMETRY_SENSORS; i++) {
+    TelemetrySensor & telemetrySensor = g_model.telemetrySensors[i];
+    if (isTelemetrySensorMatching(telemetrySensor, id, subId, instance)) {
+      telemetryItems[i].setValue(telemetrySensor, value, unit, prec);
+      available = true;
+    }
+  }
+
+  if (available) {
+    return -1;
+  }
+
   int index = availableTelemetryIndex();
   if (index >= 0) {
     switch (protocol) {
@@ -28,6 +28,9 @@
 #define TELEMETRY_VALUE_UNAVAILABLE    255
 #define TELEMETRY_VALUE_OLD            254
 
+class TelemetryItem;
+void telemetryItemChanged(const TelemetryItem * item);
+
 class TelemetryItem
 {
   public:
@@ -93,6 +96,7 @@ class TelemetryItem
     {
       memset(this, 0, sizeof(*this));
       lastReceived = TELEMETRY_VALUE_UNAVAILABLE;
+      telemetryItemChanged(this);
     }
 
     void eval(const TelemetrySensor & sensor);
@@ -129,6 +133,7 @@ class TelemetryItem
     inline void setOld()
     {
       lastReceived = TELEMETRY_VALUE_OLD;
+      telemetryItemChanged(this);
     }
 
     void gpsReceived(); // TODO seems not used
@@ -137,4 +142,57 @@ class TelemetryItem
 extern TelemetryItem telemetryItems[MAX_TELEMETRY_SENSORS];
 extern uint8_t allowNewSensors;
 
+// Sensors values seen by the mixer task
+//
+// telemetryItems[] are written by the telemetry task. At the end of each
+// telemetryWakeup() their values are copied in the buffer which isn't
+// published, then this buffer is published. The mixer task has a higher
+// priority than the telemetry task, so a mixer run always reads the values
+// of one telemetryWakeup(), never a frame half decoded, and never waits for
+// the telemetry task.
+struct TelemetryValue
+{
+  int32_t value;
+  int32_t valueMin;
+  int32_t valueMax;
+  uint8_t lastReceived;
+  union {
+    struct {
+      int32_t latitude;
+      int32_t longitude;
+    } gps;
+    struct {
+      uint16_t year;
+      uint8_t  month;
+      uint8_t  day;
+      uint8_t  hour;
+      uint8_t  min;
+      uint8_t  sec;
+    } datetime;
+  };
+
+  inline bool isOld() const
+  {
+    return (lastReceived == TELEMETRY_VALUE_OLD);
+  }
+};
+
+extern TelemetryValue telemetryValues[2][MAX_TELEMETRY_SENSORS];
+extern volatile uint32_t telemetryValuesSeq;
+
+inline TelemetryValue getPublishedTelemetryValue(uint8_t index)
+{
+  TelemetryValue result;
+  uint32_t seq;
+  do {
+    seq = telemetryValuesSeq;
+    __DMB();
+    result = telemetryValues[seq & 1][index];
+    __DMB();
+  } while (seq != telemetryValuesSeq);
+  return result;
+}
+
+void publishTelemetryValues();
+
 #endif // _TELEMETRY_SENSORS_H_
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <math.h>
+#include "gtests.h"
+
+#if defined(CPUARM)
+#include "audio_mix.h"
+
+// the former per sample mixing
+static void mixSampleReference(audio_data_t * result, int sample, unsigned int fade)
+{
+  *result = limit(AUDIO_DATA_MIN, *result + ((sample >> fade) >> (16-AUDIO_BITS_PER_SAMPLE)), AUDIO_DATA_MAX);
+}
+
+static void fillRandom(audio_data_t * data, int16_t * samples, uint32_t count)
+{
+  for (uint32_t i=0; i<count; i++) {
+    data[i] = AUDIO_DATA_MIN + rand() % (AUDIO_DATA_MAX - AUDIO_DATA_MIN + 1);
+    samples[i] = int16_t(rand()) >> AUDIO_SAMPLE_SHIFT;
+  }
+}
+
+TEST(Audio, MixBlockIsExact)
+{
+  audio_data_t data[AUDIO_BUFFER_SIZE], expected[AUDIO_BUFFER_SIZE];
+  int16_t samples[AUDIO_BUFFER_SIZE];
+
+  srand(42);
+  for (uint32_t count=0; count<=AUDIO_BUFFER_SIZE; count+=7) {
+    // the unaligned blocks and the remaining samples are checked too
+    for (uint32_t offset=0; offset<2 && offset<=count; offset++) {
+      fillRandom(data, samples, AUDIO_BUFFER_SIZE);
+      memcpy(expected, data, sizeof(data));
+      audioMixBlockGeneric(expected+offset, samples+offset, count-offset);
+      audioMixBlock(data+offset, samples+offset, count-offset);
+      EXPECT_EQ(0, memcmp(expected, data, sizeof(data))) << "count " << count << " offset " << offset;
+    }
+  }
+}
+
+TEST(Audio, MixBlockSaturates)
+{
+  audio_data_t data[8] = { AUDIO_DATA_MAX, AUDIO_DATA_MIN, AUDIO_DATA_SILENCE, AUDIO_DATA_MAX, AUDIO_DATA_MIN, AUDIO_DATA_SILENCE, AUDIO_DATA_MAX-1, AUDIO_DATA_MIN+1 };
+  int16_t samples[8] = { 1, -1, 0, INT16_MAX >> AUDIO_SAMPLE_SHIFT, INT16_MIN >> AUDIO_SAMPLE_SHIFT, INT16_MIN >> AUDIO_SAMPLE_SHIFT, 2, -2 };
+  audio_data_t expected[8] = { AUDIO_DATA_MAX, AUDIO_DATA_MIN, AUDIO_DATA_SILENCE, AUDIO_DATA_MAX, AUDIO_DATA_MIN, audio_data_t(AUDIO_DATA_SILENCE + (INT16_MIN >> AUDIO_SAMPLE_SHIFT)), AUDIO_DATA_MAX, AUDIO_DATA_MIN };
+
+  audioMixBlock(data, samples, 8);
+  for (int i=0; i<8; i++) {
+    EXPECT_EQ(expected[i], data[i]) << "sample " << i;
+  }
+}
+
+TEST(Audio, WavResamplingIsExact)
+{
+  int16_t input[AUDIO_BUFFER_SIZE];
+  uint8_t codes[AUDIO_BUFFER_SIZE];
+  int16_t table[256];
+  int16_t samples[AUDIO_BUFFER_SIZE];
+  audio_data_t data[AUDIO_BUFFER_SIZE], expected[AUDIO_BUFFER_SIZE];
+
+  srand(42);
+  for (int i=0; i<AUDIO_BUFFER_SIZE; i++) {
+    input[i] = rand();
+    codes[i] = rand();
+  }
+  for (int i=0; i<256; i++) {
+    table[i] = rand();
+  }
+
+  for (uint8_t ratio=1; ratio<=4; ratio*=2) {
+    for (unsigned int shift=0; shift<=5; shift++) {
+      uint32_t count = AUDIO_BUFFER_SIZE / ratio;
+
+      fillRandom(data, samples, AUDIO_BUFFER_SIZE);
+      memcpy(expected, data, sizeof(data));
+      for (uint32_t i=0; i<count; i++) {
+        for (uint8_t j=0; j<ratio; j++) {
+          mixSampleReference(&expected[i*ratio+j], input[i], shift);
+        }
+      }
+      EXPECT_EQ(AUDIO_BUFFER_SIZE, audioResamplePcm16(samples, input, count, ratio, shift + AUDIO_SAMPLE_SHIFT));
+      audioMixBlock(data, samples, AUDIO_BUFFER_SIZE);
+      EXPECT_EQ(0, memcmp(expected, data, sizeof(data))) << "PCM ratio " << (int)ratio << " shift " << shift;
+
+      fillRandom(data, samples, AUDIO_BUFFER_SIZE);
+      memcpy(expected, data, sizeof(data));
+      for (uint32_t i=0; i<count; i++) {
+        for (uint8_t j=0; j<ratio; j++) {
+          mixSampleReference(&expected[i*ratio+j], table[codes[i]], shift);
+        }
+      }
+      EXPECT_EQ(AUDIO_BUFFER_SIZE, audioResampleTable(samples, codes, table, count, ratio, shift + AUDIO_SAMPLE_SHIFT));
+      audioMixBlock(data, samples, AUDIO_BUFFER_SIZE);
+      EXPECT_EQ(0, memcmp(expected, data, sizeof(data))) << "table ratio " << (int)ratio << " shift " << shift;
+    }
+  }
+}
+
+// The fixed point synthesis against the exact phase and volume (see audio_mix.h)
+TEST(Audio, ToneSynthesisTolerance)
+{
+  const unsigned int ratios[] = { 10, 8, 6, 4, 2 };
+  const int frequencies[] = { BEEP_MIN_FREQ, 200, 440, 1000, BEEP_DEFAULT_FREQ, 5000, BEEP_MAX_FREQ };
+  int16_t samples[AUDIO_BUFFER_SIZE];
+
+  for (int freq : frequencies) {
+    for (unsigned int ratio : ratios) {
+      double step = double(freq) * AUDIO_SINE_VALUES / AUDIO_SAMPLE_RATE;
+      double volume = 1.0 / (freq < 330 ? ratio * double(freq * freq) / (330 * 330) : ratio);
+      uint32_t phase = audioSynthTone(samples, AUDIO_BUFFER_SIZE, 0, step * 65536, lround(volume * 65536), 0);
+      EXPECT_NEAR(0, remainder(step * AUDIO_BUFFER_SIZE - phase / 65536.0, AUDIO_SINE_VALUES), 0.01);
+      for (int i=0; i<AUDIO_BUFFER_SIZE; i++) {
+        double idx = step * i;
+        bool found = false;
+        // the index may be on the other side of an index boundary
+        for (double delta = -0.01; delta <= 0.01; delta += 0.01) {
+          int index = int(floor(idx + delta)) % AUDIO_SINE_VALUES;
+          double exact = limit<double>(INT16_MIN, sineValues[index] * volume, INT16_MAX);
+          if (fabs(samples[i] - exact) <= 1)
+            found = true;
+        }
+        EXPECT_TRUE(found) << "freq " << freq << " ratio " << ratio << " sample " << i;
+      }
+    }
+  }
+}
+
+TEST(Audio, CommandFifoSharedPush)
+{
+  static AudioCommandFifo fifo;
+  for (int i=0; i<AUDIO_QUEUE_LENGTH; i++) {
+    AudioCommand command(AUDIO_COMMAND_PLAY);
+    command.seq = i;
+    if (i & 1)
+      fifo.pushShared(command);
+    else
+      fifo.push(command);
+  }
+  // one slot always stays free
+  EXPECT_TRUE(fifo.full());
+  for (int i=0; i<AUDIO_QUEUE_LENGTH-1; i++) {
+    const AudioCommand * command = fifo.front();
+    ASSERT_TRUE(command != NULL);
+    EXPECT_EQ(i, command->seq);
+    fifo.pop();
+  }
+  EXPECT_TRUE(fifo.empty());
+  EXPECT_TRUE(fifo.front() == NULL);
+}
+#endif
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "bench.h"
+#include "audio_mix.h"
+
+// One iteration is one audio buffer (10ms)
+
+static audio_data_t benchAudioData[AUDIO_BUFFER_SIZE];
+static int16_t benchAudioSamples[AUDIO_BUFFER_SIZE];
+
+// the former float synthesis, kept as the reference
+static void floatSynthTone(float & toneIdx, float step, float volume)
+{
+  for (int i=0; i<AUDIO_BUFFER_SIZE; i++) {
+    int16_t sample = sineValues[int(toneIdx)] * volume;
+    benchAudioData[i] = limit(AUDIO_DATA_MIN, benchAudioData[i] + (sample >> AUDIO_SAMPLE_SHIFT), AUDIO_DATA_MAX);
+    toneIdx += step;
+    if ((unsigned int)toneIdx >= AUDIO_SINE_VALUES)
+      toneIdx -= AUDIO_SINE_VALUES;
+  }
+}
+
+static void runTonePass(BenchProbe & probe, BenchStage & synth, BenchStage & mix, BenchStage & generic, BenchStage & reference)
+{
+  const uint16_t freq = BEEP_DEFAULT_FREQ;
+  uint32_t phase = 0;
+  uint32_t step = ((uint64_t)freq * AUDIO_SINE_VALUES << 16) / AUDIO_SAMPLE_RATE;
+  float toneIdx = 0;
+
+  for (uint64_t i=0; i<benchOptions.iterations; i++) {
+    BENCH_STAGE(probe, synth, phase = audioSynthTone(benchAudioSamples, AUDIO_BUFFER_SIZE, phase, step, 65536 / 6, AUDIO_SAMPLE_SHIFT));
+    BENCH_STAGE(probe, mix, audioMixBlock(benchAudioData, benchAudioSamples, AUDIO_BUFFER_SIZE));
+    BENCH_STAGE(probe, generic, audioMixBlockGeneric(benchAudioData, benchAudioSamples, AUDIO_BUFFER_SIZE));
+    BENCH_STAGE(probe, reference, floatSynthTone(toneIdx, float(freq) * AUDIO_SINE_VALUES / AUDIO_SAMPLE_RATE, 1.0f / 6));
+  }
+}
+
+static void runWavPass(BenchProbe & probe, BenchStage & pcm, BenchStage & table, BenchStage & mix)
+{
+  static int16_t input[AUDIO_BUFFER_SIZE];
+  static uint8_t codes[AUDIO_BUFFER_SIZE];
+  static int16_t codesTable[256];
+
+  for (int i=0; i<AUDIO_BUFFER_SIZE; i++) {
+    input[i] = rand();
+    codes[i] = rand();
+  }
+  for (int i=0; i<256; i++) {
+    codesTable[i] = rand();
+  }
+
+  for (uint64_t i=0; i<benchOptions.iterations; i++) {
+    // 16kHz PCM and 8kHz A-law / u-law files, the usual prompts
+    BENCH_STAGE(probe, pcm, audioResamplePcm16(benchAudioSamples, input, AUDIO_BUFFER_SIZE / 2, 2, 2 + AUDIO_SAMPLE_SHIFT));
+    BENCH_STAGE(probe, table, audioResampleTable(benchAudioSamples, codes, codesTable, AUDIO_BUFFER_SIZE / 4, 4, 2 + AUDIO_SAMPLE_SHIFT));
+    BENCH_STAGE(probe, mix, audioMixBlock(benchAudioData, benchAudioSamples, AUDIO_BUFFER_SIZE));
+  }
+}
+
+void runAudioBenchmarks(std::vector<BenchResult> & results)
+{
+  if (benchSelected("tone")) {
+    BenchStage synth("audioSynthTone");
+    BenchStage mix("audioMixBlock");
+    BenchStage generic("audioMixBlockGeneric");
+    BenchStage reference("floatSynthTone");
+
+    for (int profile=0; profile<=1; profile++) {
+      if (profile && !benchProfileAvailable())
+        break;
+      BenchProbe probe(profile);
+      runTonePass(probe, synth, mix, generic, reference);
+    }
+
+    BenchResult result;
+    result.suite = "audio";
+    result.name = "tone";
+    result.iterations = benchOptions.iterations;
+    result.stages = { synth, mix, generic, reference };
+    results.push_back(result);
+  }
+
+  if (benchSelected("wav")) {
+    BenchStage pcm("audioResamplePcm16");
+    BenchStage table("audioResampleTable");
+    BenchStage mix("audioMixBlock");
+
+    for (int profile=0; profile<=1; profile++) {
+      if (profile && !benchProfileAvailable())
+        break;
+      BenchProbe probe(profile);
+      runWavPass(probe, pcm, table, mix);
+    }
+
+    BenchResult result;
+    result.suite = "audio";
+    result.name = "wav";
+    result.iterations = benchOptions.iterations;
+    result.stages = { pcm, table, mix };
+    results.push_back(result);
+  }
+}
@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <new>
+#include "bench.h"
+#include "stamp.h"
+
+#if defined(_MSC_VER)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+BenchOptions benchOptions = { 1000000, NULL };
+
+uint16_t anaInValues[NUM_STICKS+NUM_POTS+NUM_SLIDERS] = { 0 };
+uint16_t anaIn(uint8_t chan)
+{
+  if (chan < NUM_STICKS+NUM_POTS+NUM_SLIDERS)
+    return anaInValues[chan];
+  else
+    return 0;
+}
+
+uint16_t getAnalogValue(uint8_t index)
+{
+  return anaIn(index);
+}
+
+//========== ALLOCATIONS ===============
+
+static volatile uint64_t allocationsCount = 0;
+
+uint64_t benchAllocationsCount()
+{
+  return allocationsCount;
+}
+
+void * operator new(size_t size)
+{
+#if !defined(__GLIBC__)
+  ++allocationsCount; // otherwise counted by malloc() below
+#endif
+  void * result = malloc(size ? size : 1);
+  if (!result)
+    throw std::bad_alloc();
+  return result;
+}
+
+void * operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void * ptr) noexcept
+{
+  free(ptr);
+}
+
+void operator delete[](void * ptr) noexcept
+{
+  free(ptr);
+}
+
+#if defined(__GLIBC__)
+// the C allocations are counted as well
+extern "C" void * __libc_malloc(size_t size);
+extern "C" void * __libc_calloc(size_t count, size_t size);
+extern "C" void * __libc_realloc(void * ptr, size_t size);
+
+extern "C" void * malloc(size_t size)
+{
+  ++allocationsCount;
+  return __libc_malloc(size);
+}
+
+extern "C" void * calloc(size_t count, size_t size)
+{
+  ++allocationsCount;
+  return __libc_calloc(count, size);
+}
+
+extern "C" void * realloc(void * ptr, size_t size)
+{
+  ++allocationsCount;
+  return __libc_realloc(ptr, size);
+}
+#endif
+
+//========== BRANCHES PROFILE ===============
+
+#if defined(__linux__)
+static int perfGroup = -1;
+static int perfMisses = -1;
+
+static int openPerfCounter(uint64_t config, int group)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = (group < 0);
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+static void initPerfCounters()
+{
+  perfGroup = openPerfCounter(PERF_COUNT_HW_BRANCH_INSTRUCTIONS, -1);
+  if (perfGroup >= 0) {
+    perfMisses = openPerfCounter(PERF_COUNT_HW_BRANCH_MISSES, perfGroup);
+    if (perfMisses < 0) {
+      close(perfGroup);
+      perfGroup = -1;
+    }
+  }
+}
+
+bool benchProfileAvailable()
+{
+  return perfGroup >= 0;
+}
+#else
+static void initPerfCounters()
+{
+}
+
+bool benchProfileAvailable()
+{
+  return false;
+}
+#endif
+
+//========== PROBE ===============
+
+static inline uint64_t getNanoseconds()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void BenchProbe::start()
+{
+  startAllocations = allocationsCount;
+#if defined(__linux__)
+  if (profile) {
+    ioctl(perfGroup, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(perfGroup, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return;
+  }
+#endif
+  startTime = getNanoseconds();
+}
+
+void BenchProbe::stop(BenchStage & stage)
+{
+#if defined(__linux__)
+  if (profile) {
+    ioctl(perfGroup, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    uint64_t values[3]; // nr, branches, misses
+    if (read(perfGroup, values, sizeof(values)) == sizeof(values)) {
+      stage.branches = (stage.branches < 0 ? 0 : stage.branches) + values[1];
+      stage.branchMisses = (stage.branchMisses < 0 ? 0 : stage.branchMisses) + values[2];
+    }
+    return;
+  }
+#endif
+  uint64_t elapsed = getNanoseconds() - startTime;
+  stage.nanoseconds += (elapsed > overhead ? elapsed - overhead : 0);
+  stage.allocations += allocationsCount - startAllocations;
+  stage.calls++;
+}
+
+uint64_t BenchProbe::overhead = 0;
+
+// Time taken by the probe itself around an empty stage
+static uint64_t getProbeOverhead()
+{
+  BenchProbe probe(false);
+  BenchStage stage("overhead");
+  for (int i=0; i<100000; i++) {
+    BENCH_STAGE(probe, stage, );
+  }
+  return stage.nanoseconds / stage.calls;
+}
+
+//========== REPORTS ===============
+
+bool benchSelected(const char * name)
+{
+  return !benchOptions.filter || !strcmp(benchOptions.filter, name);
+}
+
+static double perIteration(int64_t value, uint64_t iterations)
+{
+  return iterations ? double(value) / iterations : 0;
+}
+
+static void printResults(const std::vector<BenchResult> & results)
+{
+  for (const BenchResult & result : results) {
+    printf("%s/%s (%llu iterations)\n", result.suite.c_str(), result.name.c_str(), (unsigned long long)result.iterations);
+    for (const BenchStage & stage : result.stages) {
+      printf("  %-24s %10.1f ns/it %8.2f alloc/it", stage.name, perIteration(stage.nanoseconds, result.iterations), perIteration(stage.allocations, result.iterations));
+      if (stage.branches >= 0)
+        printf(" %10.1f branches/it %8.2f misses/it", perIteration(stage.branches, result.iterations), perIteration(stage.branchMisses, result.iterations));
+      if (stage.size >= 0)
+        printf(" %6d bytes", (int)stage.size);
+      printf("%s\n", stage.derived ? " (derived)" : "");
+    }
+  }
+}
+
+static void writeJsonValue(FILE * f, const char * key, int64_t value, uint64_t iterations)
+{
+  if (value < 0)
+    fprintf(f, "\"%s\": null", key);
+  else
+    fprintf(f, "\"%s\": %.3f", key, perIteration(value, iterations));
+}
+
+static void writeJson(FILE * f, const std::vector<BenchResult> & results, uint64_t overhead)
+{
+  fprintf(f, "{\n");
+  fprintf(f, "  \"version\": \"%s\",\n", VERSION);
+  fprintf(f, "  \"date\": \"%s\",\n", DATE);
+  fprintf(f, "  \"flavour\": \"%s\",\n", FLAVOUR);
+  fprintf(f, "  \"probe_overhead_ns\": %llu,\n", (unsigned long long)overhead);
+  fprintf(f, "  \"results\": [\n");
+  for (unsigned i=0; i<results.size(); i++) {
+    const BenchResult & result = results[i];
+    fprintf(f, "    {\n");
+    fprintf(f, "      \"suite\": \"%s\",\n", result.suite.c_str());
+    fprintf(f, "      \"name\": \"%s\",\n", result.name.c_str());
+    fprintf(f, "      \"iterations\": %llu,\n", (unsigned long long)result.iterations);
+    fprintf(f, "      \"stages\": [\n");
+    for (unsigned j=0; j<result.stages.size(); j++) {
+      const BenchStage & stage = result.stages[j];
+      fprintf(f, "        { \"timer\": \"%s\", \"derived\": %s, ", stage.name, stage.derived ? "true" : "false");
+      writeJsonValue(f, "ns_per_iteration", stage.nanoseconds, result.iterations);
+      fprintf(f, ", ");
+      writeJsonValue(f, "allocations_per_iteration", stage.allocations, result.iterations);
+      fprintf(f, ", ");
+      writeJsonValue(f, "branches_per_iteration", stage.branches, result.iterations);
+      fprintf(f, ", ");
+      writeJsonValue(f, "branch_misses_per_iteration", stage.branchMisses, result.iterations);
+      if (stage.size >= 0)
+        fprintf(f, ", \"size\": %lld", (long long)stage.size);
+      fprintf(f, " }%s\n", j+1 < result.stages.size() ? "," : "");
+    }
+    fprintf(f, "      ]\n");
+    fprintf(f, "    }%s\n", i+1 < results.size() ? "," : "");
+  }
+  fprintf(f, "  ]\n");
+  fprintf(f, "}\n");
+}
+
+static void usage(const char * name)
+{
+  fprintf(stderr, "Usage: %s [--iterations N] [--filter NAME] [--json FILE|-]\n", name);
+}
+
+int main(int argc, char ** argv)
+{
+  const char * json = NULL;
+
+  for (int i=1; i<argc; i++) {
+    if (!strcmp(argv[i], "--iterations") && i+1 < argc) {
+      benchOptions.iterations = strtoull(argv[++i], NULL, 10);
+    }
+    else if (!strcmp(argv[i], "--filter") && i+1 < argc) {
+      benchOptions.filter = argv[++i];
+    }
+    else if (!strcmp(argv[i], "--json") && i+1 < argc) {
+      json = argv[++i];
+    }
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  FILE * jsonFile = NULL;
+  if (json && !strcmp(json, "-")) {
+    // the simulator traces are sent to stderr to keep the JSON output clean
+    fflush(stdout);
+    jsonFile = fdopen(dup(fileno(stdout)), "w");
+    dup2(fileno(stderr), fileno(stdout));
+  }
+  else if (json) {
+    jsonFile = fopen(json, "w");
+  }
+  if (json && !jsonFile) {
+    perror(json);
+    return 1;
+  }
+
+  simuInit();
+  initPerfCounters();
+
+  // the probe cost is removed from each measured stage
+  uint64_t overhead = getProbeOverhead();
+  BenchProbe::overhead = overhead;
+
+  std::vector<BenchResult> results;
+  runMixerBenchmarks(results);
+  runAudioBenchmarks(results);
+  runStorageBenchmarks(results);
+
+  printResults(results);
+
+  if (!benchProfileAvailable()) {
+    printf("Branches profile not available on this host\n");
+  }
+
+  if (jsonFile) {
+    writeJson(jsonFile, results, overhead);
+    fclose(jsonFile);
+  }
+
+  return 0;
+}
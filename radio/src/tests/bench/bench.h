@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "opentx.h"
+
+// Host benchmarks
+//
+// Each measured stage keeps its time, the heap allocations done inside and,
+// when the host exposes hardware counters (Linux perf events), its branch
+// profile. The timing and the branch profile are taken in separate passes so
+// that the counters control doesn't end in the measured time.
+
+struct BenchStage
+{
+  const char * name;        // the debugTimer* name of the same stage in the firmware, or the kernel name
+  bool derived;             // computed from the other stages, not measured
+  uint64_t calls;
+  uint64_t nanoseconds;
+  uint64_t allocations;
+  int64_t branches;         // -1 when not available
+  int64_t branchMisses;     // -1 when not available
+  int64_t size;             // bytes output by the stage (encoders), -1 when not relevant
+
+  explicit BenchStage(const char * name, bool derived=false):
+    name(name),
+    derived(derived),
+    calls(0),
+    nanoseconds(0),
+    allocations(0),
+    branches(-1),
+    branchMisses(-1),
+    size(-1)
+  {
+  }
+};
+
+struct BenchResult
+{
+  std::string suite;
+  std::string name;
+  uint64_t iterations;
+  std::vector<BenchStage> stages;
+};
+
+// Measures one call of a stage, either its time or its branches
+class BenchProbe
+{
+  public:
+    explicit BenchProbe(bool profile):
+      profile(profile)
+    {
+    }
+
+    bool isProfiling() const
+    {
+      return profile;
+    }
+
+    void start();
+    void stop(BenchStage & stage);
+
+    static uint64_t overhead;  // ns removed from each measured call
+
+  protected:
+    bool profile;
+    uint64_t startTime;
+    uint64_t startAllocations;
+};
+
+#define BENCH_STAGE(probe, stage, call) \
+  do { (probe).start(); call; (probe).stop(stage); } while (0)
+
+struct BenchOptions
+{
+  uint64_t iterations;
+  const char * filter;      // only run the benchmarks with this name when not NULL
+};
+
+extern BenchOptions benchOptions;
+extern uint16_t anaInValues[NUM_STICKS+NUM_POTS+NUM_SLIDERS];
+
+bool benchProfileAvailable();
+bool benchSelected(const char * name);
+uint64_t benchAllocationsCount();
+
+// the benchmarks suites
+void runMixerBenchmarks(std::vector<BenchResult> & results);
+void runAudioBenchmarks(std::vector<BenchResult> & results);
+void runStorageBenchmarks(std::vector<BenchResult> & results);
+
+#endif // _BENCH_H_
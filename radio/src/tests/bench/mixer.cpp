@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "bench.h"
+
+extern uint8_t s_mixer_first_run_done;
+
+#define GVAR_REF(index)   (-GV1_LARGE + (index))
+
+static void benchModelReset()
+{
+  generalDefault();
+  g_eeGeneral.templateSetup = 0;
+  for (int i=0; i<NUM_SWITCHES; i++) {
+    simuSetSwitch(i, -1);
+  }
+  memset(&g_model, 0, sizeof(g_model));
+  memset(&anaInValues, 0, sizeof(anaInValues));
+  modelDefault(0);
+  memclear(chans, sizeof(chans));
+  memclear(ex_chans, sizeof(ex_chans));
+  memclear(act, sizeof(act));
+  memclear(swOn, sizeof(swOn));
+  s_mixer_first_run_done = false;
+  lastFlightMode = 255;
+  logicalSwitchesReset();
+}
+
+static void addMix(uint8_t index, uint8_t destCh, mixsrc_t srcRaw, int16_t weight, uint8_t mltpx=MLTPX_ADD)
+{
+  MixData * md = mixAddress(index);
+  md->destCh = destCh;
+  md->srcRaw = srcRaw;
+  md->weight = weight;
+  md->mltpx = mltpx;
+}
+
+// 4 channels trainer: the default model with expo and dual rates on the sticks
+static void setupTrainer()
+{
+  for (uint8_t i=0; i<NUM_STICKS; i++) {
+    ExpoData * ed = expoAddress(i);
+    ed->curve.type = CURVE_REF_EXPO;
+    ed->curve.value = 30;
+    ed->weight = 75;
+  }
+}
+
+// 32 mixes glider with all its flight modes fading into each other
+static void setupGlider()
+{
+  uint8_t index = 0;
+
+  for (uint8_t ch=0; ch<8; ch++) {
+    addMix(index++, ch, MIXSRC_FIRST_INPUT + (ch % NUM_STICKS), 100);
+    addMix(index++, ch, MIXSRC_FIRST_INPUT + ((ch + 1) % NUM_STICKS), ch & 1 ? 30 : -30);
+    addMix(index++, ch, MIXSRC_FIRST_POT + (ch % NUM_POTS), 25);
+    MixData * md = mixAddress(index);
+    addMix(index++, ch, MIXSRC_MAX, 10);
+    md->flightModes = ((1 << MAX_FLIGHT_MODES) - 1) & ~(1 << (1 + ch % (MAX_FLIGHT_MODES-1)));
+    md->speedUp = 10;
+    md->speedDown = 10;
+  }
+
+  for (uint8_t fm=1; fm<MAX_FLIGHT_MODES; fm++) {
+    FlightModeData * flightMode = flightModeAddress(fm);
+#if defined(PCBFRSKY)
+    // the upper and lower positions of the 3 positions switches
+    flightMode->swtch = SWSRC_FIRST_SWITCH + 3*((fm-1)/2) + ((fm-1) & 1 ? 2 : 0);
+#else
+    flightMode->swtch = SWSRC_FIRST_SWITCH + (fm-1) % NUM_PSWITCH;
+#endif
+    flightMode->fadeIn = 10;
+    flightMode->fadeOut = 10;
+  }
+}
+
+// heli with swash mixing, custom curves and GVARs weights
+static void setupHeli()
+{
+#if defined(HELI)
+  g_model.swashR.type = SWASH_TYPE_120;
+  g_model.swashR.collectiveSource = MIXSRC_Thr;
+  g_model.swashR.elevatorSource = MIXSRC_Ele;
+  g_model.swashR.aileronSource = MIXSRC_Ail;
+  g_model.swashR.collectiveWeight = 100;
+  g_model.swashR.elevatorWeight = 100;
+  g_model.swashR.aileronWeight = 100;
+  g_model.swashR.value = 80;
+
+  addMix(0, 0, MIXSRC_CYC1, GVAR_REF(0));
+  addMix(1, 1, MIXSRC_CYC2, GVAR_REF(0));
+  addMix(2, 2, MIXSRC_CYC3, GVAR_REF(0));
+#else
+  addMix(0, 0, MIXSRC_Ele, GVAR_REF(0));
+  addMix(1, 1, MIXSRC_Ail, GVAR_REF(0));
+  addMix(2, 2, MIXSRC_Thr, GVAR_REF(0));
+#endif
+  addMix(3, 3, MIXSRC_Rud, 100);
+  addMix(4, 3, MIXSRC_Thr, GVAR_REF(1));
+  addMix(5, 4, MIXSRC_Thr, 100);
+  addMix(6, 5, MIXSRC_Thr, 100);
+
+  // throttle and pitch curves
+  g_model.curves[0].points = 4;
+  g_model.curves[1].points = 4;
+  for (uint8_t i=0; i<9; i++) {
+    g_model.points[i] = -100 + 25*i;
+    g_model.points[9+i] = (i < 4 ? 0 : (i-4) * 25);
+  }
+  mixAddress(5)->curve.type = CURVE_REF_CUSTOM;
+  mixAddress(5)->curve.value = 1;
+  mixAddress(6)->curve.type = CURVE_REF_CUSTOM;
+  mixAddress(6)->curve.value = 2;
+
+  // idle up and hold
+  for (uint8_t fm=0; fm<3; fm++) {
+    FlightModeData * flightMode = flightModeAddress(fm);
+    if (fm > 0) {
+      flightMode->swtch = SWSRC_FIRST_SWITCH + fm;
+    }
+    flightMode->gvars[0] = 100 - 10*fm;
+    flightMode->gvars[1] = 20*fm;
+  }
+}
+
+struct MixerBenchModel {
+  const char * name;
+  void (*setup)();
+  uint8_t switches;         // the number of switches toggled during the run
+};
+
+static const MixerBenchModel mixerBenchModels[] = {
+  { "trainer4ch", setupTrainer, 0 },
+  { "glider32", setupGlider, 4 },
+  { "heli", setupHeli, 2 },
+};
+
+static void benchModelLoad(const MixerBenchModel & model)
+{
+  benchModelReset();
+  model.setup();
+  LOAD_MODEL_CURVES();
+  storageDirty(EE_MODEL);
+  g_tmr10ms = 1;
+}
+
+// Moves the sticks and the pots, and the switches from time to time
+static void benchModelInputs(const MixerBenchModel & model, uint64_t iteration)
+{
+  for (uint8_t i=0; i<NUM_STICKS+NUM_POTS; i++) {
+    anaInValues[i] = ((iteration * (7+i) + (i * 263)) % 2048) + (rand() & 7);
+  }
+  if (model.switches && (iteration % 256) == 0) {
+    uint8_t sw = (iteration / 256) % model.switches;
+    simuSetSwitch(sw, int8_t((iteration / 256 / model.switches) % 3) - 1);
+  }
+  if (iteration & 1) {
+    g_tmr10ms++;
+  }
+}
+
+static void runMixerPass(const MixerBenchModel & model, BenchProbe & probe, BenchStage & total)
+{
+  benchModelLoad(model);
+  for (uint64_t i=0; i<benchOptions.iterations; i++) {
+    benchModelInputs(model, i);
+    BENCH_STAGE(probe, total, doMixerCalculations());
+  }
+}
+
+// The same stages as doMixerCalculations(), measured one by one
+static void runMixerStagesPass(const MixerBenchModel & model, BenchProbe & probe, BenchStage & adc, BenchStage & switches, BenchStage & mixes)
+{
+  tmr10ms_t lastTMR = 0;
+
+  benchModelLoad(model);
+  for (uint64_t i=0; i<benchOptions.iterations; i++) {
+    benchModelInputs(model, i);
+    tmr10ms_t tmr10ms = get_tmr10ms();
+    uint8_t tick10ms = (tmr10ms >= lastTMR ? tmr10ms - lastTMR : 1);
+    lastTMR = tmr10ms;
+    BENCH_STAGE(probe, adc, getADC());
+    BENCH_STAGE(probe, switches, getSwitchesPosition(!s_mixer_first_run_done));
+    BENCH_STAGE(probe, mixes, evalMixes(tick10ms));
+  }
+}
+
+void runMixerBenchmarks(std::vector<BenchResult> & results)
+{
+  for (const MixerBenchModel & model : mixerBenchModels) {
+    if (!benchSelected(model.name))
+      continue;
+
+    BenchStage total("debugTimerMixer");
+    BenchStage adc("debugTimerGetAdc");
+    BenchStage switches("debugTimerGetSwitches");
+    BenchStage mixes("debugTimerEvalMixes");
+    BenchStage others("debugTimerMixes10ms", true);
+
+    for (int profile=0; profile<=1; profile++) {
+      if (profile && !benchProfileAvailable())
+        break;
+      BenchProbe probe(profile);
+      runMixerPass(model, probe, total);
+      runMixerStagesPass(model, probe, adc, switches, mixes);
+    }
+
+    // the 10ms part of doMixerCalculations() is what remains once the other stages are removed
+    uint64_t stages = adc.nanoseconds + switches.nanoseconds + mixes.nanoseconds;
+    others.nanoseconds = (total.nanoseconds > stages ? total.nanoseconds - stages : 0);
+    uint64_t allocations = adc.allocations + switches.allocations + mixes.allocations;
+    others.allocations = (total.allocations > allocations ? total.allocations - allocations : 0);
+    if (total.branches >= 0) {
+      others.branches = std::max<int64_t>(0, total.branches - adc.branches - switches.branches - mixes.branches);
+      others.branchMisses = std::max<int64_t>(0, total.branchMisses - adc.branchMisses - switches.branchMisses - mixes.branchMisses);
+    }
+
+    BenchResult result;
+    result.suite = "mixer";
+    result.name = model.name;
+    result.iterations = benchOptions.iterations;
+    result.stages = { total, adc, switches, mixes, others };
+    results.push_back(result);
+  }
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "bench.h"
+
+// One iteration is the encoding and the decoding of the model and radio settings, as in the RAM backup
+
+PACK(struct StorageBenchData {
+  ModelData model;
+  RadioData radio;
+});
+
+static StorageBenchData storageBenchData;
+static StorageBenchData storageBenchDecoded;
+static uint8_t storageBenchEncoded[2 * sizeof(StorageBenchData)];
+
+static void setupDefault()
+{
+}
+
+// every slot used
+static void setupFull()
+{
+  for (int i=0; i<MAX_MIXERS; i++) {
+    MixData * md = mixAddress(i);
+    md->destCh = i % MAX_OUTPUT_CHANNELS;
+    md->srcRaw = MIXSRC_FIRST_INPUT + i % NUM_STICKS;
+    md->weight = 100 - i;
+    md->swtch = 1 + i % 12;
+  }
+  for (int i=0; i<MAX_EXPOS; i++) {
+    ExpoData * ed = expoAddress(i);
+    ed->srcRaw = MIXSRC_FIRST_STICK + i % NUM_STICKS;
+    ed->chn = i % NUM_STICKS;
+    ed->mode = 3;
+    ed->weight = 100 - i;
+    ed->curve.type = CURVE_REF_EXPO;
+    ed->curve.value = 20 + i;
+  }
+  for (int i=0; i<MAX_OUTPUT_CHANNELS; i++) {
+    g_model.limitData[i].min = -100 - i;
+    g_model.limitData[i].max = 100 + i;
+  }
+  for (int i=0; i<MAX_CURVE_POINTS; i++) {
+    g_model.points[i] = i % 200 - 100;
+  }
+  for (int i=0; i<MAX_LOGICAL_SWITCHES; i++) {
+    g_model.logicalSw[i].func = 1 + i % 10;
+    g_model.logicalSw[i].v1 = i;
+    g_model.logicalSw[i].v2 = 10 * i;
+  }
+  for (int i=0; i<MAX_SPECIAL_FUNCTIONS; i++) {
+    g_model.customFn[i].swtch = 1 + i;
+    g_model.customFn[i].func = i % 16;
+    g_model.customFn[i].active = 1;
+  }
+  for (int fm=0; fm<MAX_FLIGHT_MODES; fm++) {
+    for (int i=0; i<NUM_TRIMS; i++) {
+      g_model.flightModeData[fm].trim[i].value = fm * 10 - i;
+    }
+  }
+}
+
+struct StorageBenchModel {
+  const char * name;
+  void (*setup)();
+};
+
+static const StorageBenchModel storageBenchModels[] = {
+  { "default", setupDefault },
+  { "full", setupFull },
+};
+
+static void runCodecPass(BenchProbe & probe, BenchStage & encoder, BenchStage & decoder,
+                         unsigned int (*encode)(uint8_t *, unsigned int, const uint8_t *, unsigned int),
+                         unsigned int (*decode)(uint8_t *, unsigned int, const uint8_t *, unsigned int))
+{
+  unsigned int size = 0;
+  for (uint64_t i=0; i<benchOptions.iterations; i++) {
+    BENCH_STAGE(probe, encoder, size = encode(storageBenchEncoded, sizeof(storageBenchEncoded), (const uint8_t *)&storageBenchData, sizeof(storageBenchData)));
+    BENCH_STAGE(probe, decoder, decode((uint8_t *)&storageBenchDecoded, sizeof(storageBenchDecoded), storageBenchEncoded, size));
+  }
+  encoder.size = size;
+  if (memcmp(&storageBenchData, &storageBenchDecoded, sizeof(storageBenchData))) {
+    fprintf(stderr, "%s: decoded data differ\n", decoder.name);
+  }
+}
+
+void runStorageBenchmarks(std::vector<BenchResult> & results)
+{
+  for (const StorageBenchModel & model : storageBenchModels) {
+    if (!benchSelected(model.name))
+      continue;
+
+    generalDefault();
+    memset(&g_model, 0, sizeof(g_model));
+    modelDefault(0);
+    model.setup();
+    storageBenchData.model = g_model;
+    storageBenchData.radio = g_eeGeneral;
+
+    BenchStage rlcEncoder("compress");
+    BenchStage rlcDecoder("uncompress");
+    BenchStage lzEncoder("lzCompress");
+    BenchStage lzDecoder("lzUncompress");
+
+    for (int profile=0; profile<=1; profile++) {
+      if (profile && !benchProfileAvailable())
+        break;
+      BenchProbe probe(profile);
+      runCodecPass(probe, rlcEncoder, rlcDecoder, compress, uncompress);
+      runCodecPass(probe, lzEncoder, lzDecoder, lzCompress, lzUncompress);
+    }
+
+    BenchResult result;
+    result.suite = "storage";
+    result.name = model.name;
+    result.iterations = benchOptions.iterations;
+    result.stages = { rlcEncoder, rlcDecoder, lzEncoder, lzDecoder };
+    results.push_back(result);
+  }
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "gtests.h"
+
+#if defined(LUA)
+#include "bin_allocator.h"
+
+static BinAllocator allocator;
+
+static uint32_t getUsedSlots()
+{
+  uint32_t result = 0;
+  for (uint8_t i=0; i<BinAllocator::CLASSES; i++) {
+    result += allocator.getStats(i).used;
+  }
+  return result;
+}
+
+TEST(BinAllocator, sizeClasses)
+{
+  allocator.reset();
+
+  for (uint8_t i=0; i<BinAllocator::CLASSES; i++) {
+    size_t size = binClasses[i].size;
+    void * small = allocator.malloc(i == 0 ? 1 : binClasses[i-1].size + 1);
+    void * exact = allocator.malloc(size);
+    ASSERT_TRUE(small != NULL);
+    ASSERT_TRUE(exact != NULL);
+    EXPECT_EQ(0u, (uintptr_t)small % 8);
+    EXPECT_EQ(2, allocator.getStats(i).used);
+    EXPECT_TRUE(allocator.free(small, 1));
+    EXPECT_TRUE(allocator.free(exact, size));
+  }
+  EXPECT_TRUE(allocator.malloc(BinAllocator::MAX_SIZE + 1) == NULL);
+
+  int outside;
+  EXPECT_FALSE(allocator.free(&outside, sizeof(outside)));
+  EXPECT_EQ(0u, getUsedSlots());
+}
+
+TEST(BinAllocator, fullClassSpills)
+{
+  allocator.reset();
+
+  std::vector<void *> blocks;
+  for (int i=0; i<binClasses[0].count; i++) {
+    blocks.push_back(allocator.malloc(8));
+  }
+  EXPECT_EQ(binClasses[0].count, allocator.getStats(0).used);
+  EXPECT_EQ(0u, allocator.getStats(0).spilled);
+
+  // the next one is taken from the next class
+  void * ptr = allocator.malloc(8);
+  EXPECT_EQ(1, allocator.getStats(1).used);
+  EXPECT_EQ(1u, allocator.getStats(0).spilled);
+
+  // and the slots are used again once freed, last freed first
+  allocator.free(blocks[3], 8);
+  EXPECT_EQ(blocks[3], allocator.malloc(8));
+
+  allocator.free(ptr, 8);
+  for (auto block: blocks) {
+    allocator.free(block, 8);
+  }
+  EXPECT_EQ(0u, getUsedSlots());
+  EXPECT_EQ(binClasses[0].count, allocator.getStats(0).peak);
+}
+
+TEST(BinAllocator, realloc)
+{
+  allocator.reset();
+
+  char * ptr = (char *)allocator.realloc(NULL, 0, 10);
+  strcpy(ptr, "123456789");
+
+  // same class, same slot
+  EXPECT_EQ(ptr, allocator.realloc(ptr, 10, 16));
+
+  // bigger, the content is moved
+  char * bigger = (char *)allocator.realloc(ptr, 16, 40);
+  EXPECT_NE(ptr, bigger);
+  EXPECT_STREQ("123456789", bigger);
+  EXPECT_EQ(0, allocator.getStats(0).used);
+  EXPECT_EQ(40u, allocator.getStats(3).requested);
+
+  // smaller, moved to the smaller class
+  char * smaller = (char *)allocator.realloc(bigger, 40, 10);
+  EXPECT_NE(bigger, smaller);
+  EXPECT_STREQ("123456789", smaller);
+  EXPECT_EQ(1, allocator.getStats(0).used);
+  EXPECT_EQ(10u, allocator.getStats(0).requested);
+
+  // too big, the block is left unchanged
+  EXPECT_TRUE(allocator.realloc(smaller, 10, BinAllocator::MAX_SIZE + 1) == NULL);
+  EXPECT_STREQ("123456789", smaller);
+
+  allocator.free(smaller, 10);
+  EXPECT_EQ(0u, getUsedSlots());
+  EXPECT_EQ(0u, allocator.getStats(0).requested);
+}
+
+TEST(BinAllocator, luaState)
+{
+  // the allocator of the firmware Lua states
+  binAllocator.reset();
+  binAllocatorLibcBytes = 0;
+
+  lua_State * L = lua_newstate(bin_l_alloc, NULL);
+  ASSERT_TRUE(L != NULL);
+  luaL_openlibs(L);
+  EXPECT_FALSE(luaL_dostring(L,
+    "local t = {}\n"
+    "for i=1,2000 do t[i] = {name='item'..i, value=i} end\n"
+    "for i=1,2000,2 do t[i] = nil end\n"
+    "collectgarbage()\n"
+    "local sum = 0\n"
+    "for i=2,2000,2 do sum = sum + t[i].value + #t[i].name end\n"
+    "result = sum\n")) << lua_tostring(L, -1);
+  int expected = 0;
+  for (int i=2; i<=2000; i+=2) {
+    expected += i + snprintf(NULL, 0, "item%d", i);
+  }
+  lua_getglobal(L, "result");
+  EXPECT_EQ(expected, lua_tointeger(L, -1));
+
+  uint32_t used = 0;
+  for (uint8_t i=0; i<BinAllocator::CLASSES; i++) {
+    used += binAllocator.getStats(i).used;
+  }
+  EXPECT_LT(0u, used);
+
+  // the blocks bigger than the biggest class are taken from libc
+  uint32_t libcBytes = binAllocatorLibcBytes;
+  EXPECT_FALSE(luaL_dostring(L, "big = string.rep('x', 4000)")) << lua_tostring(L, -1);
+  EXPECT_LE(libcBytes + 4000, binAllocatorLibcBytes);
+  lua_close(L);
+
+  EXPECT_EQ(0u, binAllocatorLibcBytes);
+  for (uint8_t i=0; i<BinAllocator::CLASSES; i++) {
+    EXPECT_EQ(0, binAllocator.getStats(i).used);
+    EXPECT_EQ(0u, binAllocator.getStats(i).requested);
+  }
+}
+#endif
@@ -38,11 +38,31 @@ TEST(Storage, BackupAndRestore)
 
   rambackupWrite();
   Backup::RamBackupUncompressed ramBackupRestored;
-  if (uncompress((uint8_t *)&ramBackupRestored, sizeof(ramBackupRestored), ramBackup->data, ramBackup->size) != sizeof(ramBackupUncompressed))
+  if (lzUncompress((uint8_t *)&ramBackupRestored, sizeof(ramBackupRestored), ramBackup->data, ramBackup->size) != sizeof(ramBackupUncompressed))
     TRACE("ERROR uncompress");
   if (memcmp(&ramBackupUncompressed, &ramBackupRestored, sizeof(ramBackupUncompressed)) != 0)
     TRACE("ERROR restore");
 }
+
+TEST(Storage, IncrementalBackup)
+{
+  rambackupWrite();
+
+  // only the dirty part is encoded again
+  g_eeGeneral.calib[0].mid = 500;
+  rambackupDirtyMsk = EE_GENERAL;
+  rambackupWrite();
+  g_model.mixData[0].weight = 42;
+  rambackupDirtyMsk = EE_MODEL;
+  rambackupWrite();
+  rambackupDirtyMsk = 0;
+
+  g_eeGeneral.calib[0].mid = 0;
+  g_model.mixData[0].weight = 0;
+  EXPECT_TRUE(rambackupRestore());
+  EXPECT_EQ(500, g_eeGeneral.calib[0].mid);
+  EXPECT_EQ(42, g_model.mixData[0].weight);
+}
 #endif
 
 #if defined(EEPROM_RLC)
@@ -171,3 +191,283 @@ TEST(Eeprom, rm)
   EXPECT_EQ(sz, 0);
 }
 #endif
+
+#if defined(HOT_MODEL_SWITCH) && defined(EEPROM_RLC)
+static void writeHotSwitchModel(uint8_t index, uint8_t moduleType)
+{
+  modelDefault(index);
+  g_model.header.name[0] = 'A' + index;
+  g_model.moduleData[EXTERNAL_MODULE].type = moduleType;
+  for (int i=0; i<NUM_MODULES; i++) {
+    g_model.moduleData[i].failsafeMode = FAILSAFE_HOLD;
+  }
+  theFile.writeRlc(FILE_MODEL(index), FILE_TYP_MODEL, (uint8_t*)&g_model, sizeof(g_model), true);
+}
+
+class HotModelSwitchTest : public OpenTxTest
+{
+  protected:
+    virtual void SetUp()
+    {
+      OpenTxTest::SetUp();
+      eepromFile = NULL; // in memory
+      storageFormat();
+      writeHotSwitchModel(0, MODULE_TYPE_XJT);
+      writeHotSwitchModel(1, MODULE_TYPE_XJT);
+      writeHotSwitchModel(2, MODULE_TYPE_PPM);
+      eeLoadModelData(0);
+      s_current_protocol[0] = PROTO_PXX;
+      s_pulses_paused = false;
+      calibratedAnalogs[THR_STICK] = -1024;
+      // the switches positions expected by the default models
+      for (int i=0; i<NUM_SWITCHES; i++) {
+        simuSetSwitch(i, -1);
+      }
+    }
+
+    virtual void TearDown()
+    {
+      s_current_protocol[0] = 255;
+    }
+};
+
+TEST_F(HotModelSwitchTest, sameModules)
+{
+  EXPECT_GE(eeLoadModelData(1, &shadowModel), EEPROM_MIN_MODEL_SIZE);
+  EXPECT_TRUE(modelHotSwitch(false));
+  EXPECT_EQ('B', g_model.header.name[0]);
+  EXPECT_FALSE(s_pulses_paused);
+}
+
+TEST_F(HotModelSwitchTest, differentModules)
+{
+  eeLoadModelData(2, &shadowModel);
+  EXPECT_FALSE(modelHotSwitch(false));
+  EXPECT_EQ('A', g_model.header.name[0]);
+}
+
+TEST_F(HotModelSwitchTest, throttleNotIdle)
+{
+  calibratedAnalogs[THR_STICK] = 1024;
+  eeLoadModelData(1, &shadowModel);
+  EXPECT_FALSE(modelHotSwitch(false));
+  EXPECT_EQ('A', g_model.header.name[0]);
+}
+
+TEST_F(HotModelSwitchTest, pulsesStopped)
+{
+  s_current_protocol[0] = 255;
+  eeLoadModelData(1, &shadowModel);
+  EXPECT_FALSE(modelHotSwitch(false));
+  EXPECT_EQ('A', g_model.header.name[0]);
+}
+
+TEST_F(HotModelSwitchTest, switchWarning)
+{
+  eeLoadModelData(1, &shadowModel);
+  shadowModel.switchWarningState = 0x02; // SA down
+  EXPECT_FALSE(modelHotSwitch(false));
+  EXPECT_EQ('A', g_model.header.name[0]);
+
+  shadowModel.switchWarningState = 0x00; // SA up
+  EXPECT_TRUE(modelHotSwitch(false));
+  EXPECT_EQ('B', g_model.header.name[0]);
+}
+
+TEST_F(HotModelSwitchTest, failsafeNotSet)
+{
+  eeLoadModelData(1, &shadowModel);
+  shadowModel.moduleData[EXTERNAL_MODULE].failsafeMode = FAILSAFE_NOT_SET;
+  EXPECT_FALSE(modelHotSwitch(false));
+  EXPECT_EQ('A', g_model.header.name[0]);
+}
+
+TEST_F(HotModelSwitchTest, outputsBlend)
+{
+  g_tmr10ms = 1000;
+  evalMixes(1);
+  EXPECT_EQ(0, channelOutputs[0]);
+
+  channelOutputs[0] = -1000;
+  startOutputsBlend(100);
+  evalMixes(1);
+  EXPECT_EQ(-1000, channelOutputs[0]);
+  g_tmr10ms += 50;
+  evalMixes(1);
+  EXPECT_EQ(-500, channelOutputs[0]);
+  g_tmr10ms += 50;
+  evalMixes(1);
+  EXPECT_EQ(0, channelOutputs[0]);
+}
+#endif
+
+// every slot used, with the usual values, the names are not in the RAM backup
+static void fillLargestModel()
+{
+  modelDefault(0);
+  for (int i=0; i<MAX_MIXERS; i++) {
+    MixData & md = g_model.mixData[i];
+    md.destCh = i % MAX_OUTPUT_CHANNELS;
+    md.srcRaw = MIXSRC_FIRST_INPUT + i % NUM_STICKS;
+    md.weight = 100 - i;
+    md.offset = i % 5;
+    md.swtch = 1 + i % 12;
+    md.flightModes = i % 3;
+    md.speedUp = i % 4;
+    md.speedDown = i % 4;
+  }
+  for (int i=0; i<MAX_EXPOS; i++) {
+    ExpoData & ed = g_model.expoData[i];
+    ed.srcRaw = MIXSRC_FIRST_STICK + i % NUM_STICKS;
+    ed.chn = i % NUM_STICKS;
+    ed.mode = 3;
+    ed.weight = 100 - i;
+    ed.swtch = i % 12;
+    ed.curve.type = CURVE_REF_EXPO;
+    ed.curve.value = 20 + i;
+  }
+  for (int i=0; i<MAX_OUTPUT_CHANNELS; i++) {
+    g_model.limitData[i].min = -100 - i;
+    g_model.limitData[i].max = 100 + i;
+    g_model.limitData[i].ppmCenter = i;
+  }
+  for (int i=0; i<MAX_CURVE_POINTS; i++) {
+    g_model.points[i] = i % 200 - 100;
+  }
+  for (int i=0; i<MAX_LOGICAL_SWITCHES; i++) {
+    g_model.logicalSw[i].func = 1 + i % 10;
+    g_model.logicalSw[i].v1 = i;
+    g_model.logicalSw[i].v2 = 10 * i;
+  }
+  for (int i=0; i<MAX_SPECIAL_FUNCTIONS; i++) {
+    g_model.customFn[i].swtch = 1 + i;
+    g_model.customFn[i].func = i % 16;
+    g_model.customFn[i].all.val = i;
+    g_model.customFn[i].active = 1;
+  }
+  for (int fm=0; fm<MAX_FLIGHT_MODES; fm++) {
+    for (int i=0; i<NUM_TRIMS; i++) {
+      g_model.flightModeData[fm].trim[i].value = fm * 10 - i;
+    }
+    g_model.flightModeData[fm].swtch = fm;
+    g_model.flightModeData[fm].fadeIn = 10;
+    g_model.flightModeData[fm].fadeOut = 10;
+  }
+}
+
+static void checkCodecs(const uint8_t * data, unsigned int size, unsigned int maxSize)
+{
+  static uint8_t encoded[16384];
+  static uint8_t decoded[16384];
+  unsigned int rlcSize = compress(encoded, sizeof(encoded), data, size);
+  unsigned int lzSize = lzCompress(encoded, maxSize, data, size);
+  ASSERT_NE(0U, lzSize);
+  EXPECT_LE(lzSize, rlcSize);
+  ASSERT_EQ(size, lzUncompress(decoded, sizeof(decoded), encoded, lzSize));
+  EXPECT_EQ(0, memcmp(data, decoded, size));
+}
+
+TEST(Storage, lzCodec)
+{
+  static uint8_t data[8192];
+
+  for (int test=0; test<100; test++) {
+    unsigned int size = 1 + rand() % sizeof(data);
+    for (unsigned int i=0; i<size; i++) {
+      // runs of zeroes, random bytes and repeated sequences
+      switch (rand() % 3) {
+        case 0:
+          data[i] = 0;
+          break;
+        case 1:
+          data[i] = rand();
+          break;
+        default:
+          data[i] = (i > 10 ? data[i - 1 - rand() % 10] : 1);
+          break;
+      }
+    }
+    static uint8_t encoded[16384];
+    static uint8_t decoded[8192];
+    unsigned int encodedSize = lzCompress(encoded, sizeof(encoded), data, size);
+    ASSERT_NE(0U, encodedSize);
+    ASSERT_EQ(size, lzUncompress(decoded, sizeof(decoded), encoded, encodedSize));
+    ASSERT_EQ(0, memcmp(data, decoded, size));
+  }
+}
+
+TEST(Storage, lzConcatenatedBlocks)
+{
+  // the RAM backup is the model and the radio settings encoded one after the other
+  modelDefault(0);
+  generalDefault();
+  static uint8_t encoded[16384];
+  static uint8_t decoded[sizeof(ModelData) + sizeof(RadioData)];
+  unsigned int modelSize = lzCompress(encoded, sizeof(encoded), (const uint8_t *)&g_model, sizeof(g_model));
+  unsigned int radioSize = lzCompress(encoded + modelSize, sizeof(encoded) - modelSize, (const uint8_t *)&g_eeGeneral, sizeof(g_eeGeneral));
+  ASSERT_EQ(sizeof(decoded), lzUncompress(decoded, sizeof(decoded), encoded, modelSize + radioSize));
+  EXPECT_EQ(0, memcmp(&g_model, decoded, sizeof(g_model)));
+  EXPECT_EQ(0, memcmp(&g_eeGeneral, decoded + sizeof(g_model), sizeof(g_eeGeneral)));
+}
+
+TEST(Storage, lzInvalidData)
+{
+  uint8_t decoded[64];
+  const uint8_t truncatedLiterals[] = { 0x05, 1, 2 };
+  EXPECT_EQ(0U, lzUncompress(decoded, sizeof(decoded), truncatedLiterals, sizeof(truncatedLiterals)));
+  const uint8_t matchBeforeStart[] = { 0x00, 1, 0x80, 0x04 };
+  EXPECT_EQ(0U, lzUncompress(decoded, sizeof(decoded), matchBeforeStart, sizeof(matchBeforeStart)));
+  const uint8_t tooManyZeroes[] = { 0x7F, 0x10 };
+  EXPECT_EQ(0U, lzUncompress(decoded, sizeof(decoded), tooManyZeroes, sizeof(tooManyZeroes)));
+  uint8_t encoded[4];
+  EXPECT_EQ(0U, lzCompress(encoded, sizeof(encoded), (const uint8_t *)"ABCDEFGH", 8));
+}
+
+TEST(Storage, largestModelBackup)
+{
+  // the RAM backup has 4094 bytes
+  generalDefault();
+  checkCodecs((const uint8_t *)&g_eeGeneral, sizeof(g_eeGeneral), 4094);
+  modelDefault(0);
+  checkCodecs((const uint8_t *)&g_model, sizeof(g_model), 4094);
+  fillLargestModel();
+  checkCodecs((const uint8_t *)&g_model, sizeof(g_model), 4094 - sizeof(g_eeGeneral));
+}
+
+#if !defined(EEPROM) && defined(SDCARD)
+TEST(Storage, largestModelRamBackup)
+{
+  // the layout written in the RAM backup, without the NOBACKUP fields
+  generalDefault();
+  fillLargestModel();
+  rambackupDirtyMsk = EE_GENERAL | EE_MODEL;
+  rambackupWrite();
+  rambackupDirtyMsk = 0;
+  ASSERT_NE(0, ramBackup->size);
+  EXPECT_TRUE(rambackupRestore());
+  EXPECT_EQ(100 - (MAX_MIXERS - 1), g_model.mixData[MAX_MIXERS - 1].weight);
+}
+
+TEST(Storage, ramBackupOverflow)
+{
+  generalDefault();
+  modelDefault(0);
+  rambackupDirtyMsk = EE_GENERAL | EE_MODEL;
+  rambackupWrite();
+  uint16_t size = ramBackup->size;
+  ASSERT_NE(0, size);
+  int16_t weight = g_model.mixData[0].weight;
+
+  // random data can't be encoded in the backup, the previous one is kept
+  uint8_t * data = (uint8_t *)&g_model;
+  for (unsigned int i=0; i<sizeof(g_model); i++) {
+    data[i] = rand();
+  }
+  rambackupDirtyMsk = EE_MODEL;
+  rambackupWrite();
+  rambackupDirtyMsk = 0;
+  EXPECT_EQ(size, ramBackup->size);
+  EXPECT_TRUE(rambackupRestore());
+  EXPECT_EQ(weight, g_model.mixData[0].weight);
+}
+#endif
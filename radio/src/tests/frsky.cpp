@@ -553,4 +553,206 @@ TEST(FrSkySPORT, frskyCurrent)
   EXPECT_EQ(telemetryItems[0].valueMax, 505);
 }
 
+TEST(FrSkySPORT, sensorsTableIsSorted)
+{
+  const FrSkySportSensor * sensor = sportSensors;
+  for (sensor++; sensor->firstId; sensor++) {
+    const FrSkySportSensor * previous = sensor - 1;
+    EXPECT_LE(sensor->firstId, sensor->lastId);
+    if (sensor->firstId == previous->firstId) {
+      EXPECT_EQ(sensor->lastId, previous->lastId);
+      EXPECT_LT(previous->subId, sensor->subId);
+    }
+    else {
+      EXPECT_LT(previous->lastId, sensor->firstId);
+    }
+  }
+}
+
+TEST(FrSkySPORT, getFrSkySportSensor)
+{
+  for (uint32_t id=0; id<=0xFFFF; id++) {
+    for (uint8_t subId=0; subId<=2; subId++) {
+      // the former linear search
+      const FrSkySportSensor * expected = NULL;
+      for (const FrSkySportSensor * sensor = sportSensors; sensor->firstId; sensor++) {
+        if (id >= sensor->firstId && id <= sensor->lastId && subId == sensor->subId) {
+          expected = sensor;
+          break;
+        }
+      }
+      EXPECT_EQ(expected, getFrSkySportSensor(id, subId)) << "id " << id << " subId " << (int)subId;
+    }
+  }
+}
+
+TEST(FrSkySPORT, sensorsIndex)
+{
+  uint8_t packet[FRSKY_SPORT_PACKET_SIZE];
+
+  MODEL_RESET();
+  TELEMETRY_RESET();
+  allowNewSensors = true;
+
+  // 2 FAS sensors, the second one is discovered after the first one
+  generateSportFasVoltagePacket(packet, 5000); sportProcessTelemetryPacket(packet);
+  packet[0] = 0x23; setSportPacketCrc(packet); sportProcessTelemetryPacket(packet);
+  EXPECT_EQ(telemetryItems[0].value, 5000);
+  EXPECT_EQ(telemetryItems[1].value, 5000);
+  EXPECT_EQ(g_model.telemetrySensors[0].instance + 1, g_model.telemetrySensors[1].instance);
+
+  // a copy of the first sensor gets the same values
+  g_model.telemetrySensors[2] = g_model.telemetrySensors[0];
+  storageDirty(EE_MODEL);
+  allowNewSensors = false;
+  generateSportFasVoltagePacket(packet, 6000); sportProcessTelemetryPacket(packet);
+  EXPECT_EQ(telemetryItems[0].value, 6000);
+  EXPECT_EQ(telemetryItems[1].value, 5000);
+  EXPECT_EQ(telemetryItems[2].value, 6000);
+
+  // all the instances when the ids are ignored
+  g_model.ignoreSensorIds = true;
+  storageDirty(EE_MODEL);
+  generateSportFasVoltagePacket(packet, 7000); sportProcessTelemetryPacket(packet);
+  EXPECT_EQ(telemetryItems[0].value, 7000);
+  EXPECT_EQ(telemetryItems[1].value, 7000);
+  EXPECT_EQ(telemetryItems[2].value, 7000);
+  g_model.ignoreSensorIds = false;
+
+  // a deleted sensor isn't updated any more
+  delTelemetryIndex(0);
+  generateSportFasVoltagePacket(packet, 8000); sportProcessTelemetryPacket(packet);
+  EXPECT_EQ(telemetryItems[1].value, 7000);
+  EXPECT_EQ(telemetryItems[2].value, 8000);
+
+  // a sensor changed without storageDirty() is found by the scan before a sensor creation
+  allowNewSensors = true;
+  g_model.telemetrySensors[1].instance = 0x06;
+  packet[0] = 0x25; setSportPacketCrc(packet); sportProcessTelemetryPacket(packet);
+  EXPECT_EQ(telemetryItems[1].value, 8000);
+  EXPECT_FALSE(g_model.telemetrySensors[0].isAvailable());
+
+  // a sensor without label is updated as well
+  allowNewSensors = false;
+  memclear(g_model.telemetrySensors[2].label, sizeof(g_model.telemetrySensors[2].label));
+  storageDirty(EE_MODEL);
+  generateSportFasVoltagePacket(packet, 9000); sportProcessTelemetryPacket(packet);
+  EXPECT_EQ(telemetryItems[2].value, 9000);
+}
+
+TEST(FrSkySPORT, valuesPublishedToMixer)
+{
+  uint8_t packet[FRSKY_SPORT_PACKET_SIZE];
+
+  MODEL_RESET();
+  TELEMETRY_RESET();
+  allowNewSensors = true;
+  telemetryWakeup();
+
+  // the mixer sees the values of the last telemetryWakeup() only
+  generateSportFasVoltagePacket(packet, 5000); sportProcessTelemetryPacket(packet);
+  EXPECT_EQ(telemetryItems[0].value, 5000);
+  EXPECT_EQ(getValue(MIXSRC_FIRST_TELEM), 0);
+
+  telemetryWakeup();
+  EXPECT_EQ(getValue(MIXSRC_FIRST_TELEM), 5000);
+  EXPECT_EQ(getValue(MIXSRC_FIRST_TELEM+1), 5000);
+  EXPECT_EQ(getValue(MIXSRC_FIRST_TELEM+2), 5000);
+  EXPECT_TRUE(getSwitch(SWSRC_FIRST_SENSOR));
+
+  generateSportFasVoltagePacket(packet, 6000); sportProcessTelemetryPacket(packet);
+  telemetryItems[0].setOld();
+  EXPECT_EQ(getValue(MIXSRC_FIRST_TELEM), 5000);
+  EXPECT_TRUE(getSwitch(SWSRC_FIRST_SENSOR));
+
+  telemetryWakeup();
+  EXPECT_EQ(getValue(MIXSRC_FIRST_TELEM), 6000);
+  EXPECT_EQ(getValue(MIXSRC_FIRST_TELEM+2), 6000);
+  EXPECT_FALSE(getSwitch(SWSRC_FIRST_SENSOR));
+}
+
+TEST(FrSkySPORT, calculatedSensorsOrder)
+{
+  uint8_t packet[FRSKY_SPORT_PACKET_SIZE];
+
+  MODEL_RESET();
+  TELEMETRY_RESET();
+  allowNewSensors = true;
+
+  // sensor 0 is the FAS voltage
+  generateSportFasVoltagePacket(packet, 5000); sportProcessTelemetryPacket(packet);
+
+  // sensor 1 depends on sensor 2, which depends on sensor 0
+  g_model.telemetrySensors[1].type = TELEM_TYPE_CALCULATED;
+  g_model.telemetrySensors[1].formula = TELEM_FORMULA_ADD;
+  g_model.telemetrySensors[1].unit = UNIT_VOLTS;
+  g_model.telemetrySensors[1].prec = 2;
+  g_model.telemetrySensors[1].calc.sources[0] = 3;
+  g_model.telemetrySensors[1].calc.sources[1] = 1;
+  g_model.telemetrySensors[2].type = TELEM_TYPE_CALCULATED;
+  g_model.telemetrySensors[2].formula = TELEM_FORMULA_MAX;
+  g_model.telemetrySensors[2].unit = UNIT_VOLTS;
+  g_model.telemetrySensors[2].prec = 2;
+  g_model.telemetrySensors[2].calc.sources[0] = 1;
+  storageDirty(EE_MODEL);
+
+  // the whole chain in one telemetryWakeup()
+  telemetryWakeup();
+  EXPECT_EQ(telemetryItems[2].value, 5000);
+  EXPECT_EQ(telemetryItems[1].value, 10000);
+
+  // not evaluated again while the sources don't change
+  telemetryItems[1].value = 0;
+  telemetryWakeup();
+  EXPECT_EQ(telemetryItems[1].value, 0);
+
+  generateSportFasVoltagePacket(packet, 4000); sportProcessTelemetryPacket(packet);
+  telemetryWakeup();
+  EXPECT_EQ(telemetryItems[2].value, 4000);
+  EXPECT_EQ(telemetryItems[1].value, 8000);
+
+  // and old as soon as the source is old
+  telemetryItems[0].setOld();
+  telemetryWakeup();
+  EXPECT_TRUE(telemetryItems[2].isOld());
+  EXPECT_TRUE(telemetryItems[1].isOld());
+}
+
+TEST(FrSkySPORT, consumptionKeepsDependentsFresh)
+{
+  uint8_t packet[FRSKY_SPORT_PACKET_SIZE];
+
+  MODEL_RESET();
+  TELEMETRY_RESET();
+  allowNewSensors = true;
+
+  // sensor 0 is the FAS current, sensor 1 its consumption, sensor 2 depends on sensor 1
+  generateSportFasCurrentPacket(packet, 500); sportProcessTelemetryPacket(packet);
+  g_model.telemetrySensors[1].type = TELEM_TYPE_CALCULATED;
+  g_model.telemetrySensors[1].formula = TELEM_FORMULA_CONSUMPTION;
+  g_model.telemetrySensors[1].unit = UNIT_MAH;
+  g_model.telemetrySensors[1].consumption.source = 1;
+  g_model.telemetrySensors[2].type = TELEM_TYPE_CALCULATED;
+  g_model.telemetrySensors[2].formula = TELEM_FORMULA_MAX;
+  g_model.telemetrySensors[2].unit = UNIT_MAH;
+  g_model.telemetrySensors[2].calc.sources[0] = 2;
+  storageDirty(EE_MODEL);
+
+  for (int i=0; i<8; i++) {
+    telemetryItems[1].per10ms(g_model.telemetrySensors[1]);
+  }
+  telemetryWakeup();
+  EXPECT_EQ(telemetryItems[1].value, 1);
+  EXPECT_EQ(telemetryItems[2].value, 1);
+
+  // no current, the consumption doesn't change but is still fresh, and so is its dependent
+  generateSportFasCurrentPacket(packet, 0); sportProcessTelemetryPacket(packet);
+  telemetryWakeup();
+  telemetryItems[2].value = 0;
+  telemetryItems[1].per10ms(g_model.telemetrySensors[1]);
+  telemetryWakeup();
+  EXPECT_EQ(telemetryItems[1].value, 1);
+  EXPECT_EQ(telemetryItems[2].value, 1);
+}
+
 #endif  //#if defined(TELEMETRY_FRSKY_SPORT)
@@ -58,6 +58,25 @@ TEST_F(SpecialFunctionsTest, FlightReset)
   EXPECT_EQ((bool)(mainRequestFlags & (1 << REQUEST_FLIGHT_RESET)), false);
 }
 
+TEST_F(SpecialFunctionsTest, SensorReset)
+{
+  g_model.customFn[0].swtch = SWSRC_SA0;
+  g_model.customFn[0].func = FUNC_RESET;
+  g_model.customFn[0].all.val = FUNC_RESET_PARAM_FIRST_TELEM;
+  g_model.customFn[0].active = true;
+
+  telemetryItems[0].value = 1000;
+  telemetryItems[0].lastReceived = 0;
+  simuSetSwitch(0, -1);
+
+  // requested by the mixer task, applied by the telemetry task
+  evalFunctions(g_model.customFn, modelFunctionsContext);
+  EXPECT_EQ(1000, telemetryItems[0].value);
+  telemetryWakeup();
+  EXPECT_EQ(0, telemetryItems[0].value);
+  EXPECT_FALSE(telemetryItems[0].isAvailable());
+}
+
 #if defined(GVARS)
 TEST_F(SpecialFunctionsTest, GvarsInc)
 {
@@ -165,4 +165,239 @@ TEST(Lua, testModelInputs)
 
 }
 
+TEST(Lua, gcIdle)
+{
+  luaInit();
+  for (int i=0; i<1000 && luaDoGcIdle(); i++) {
+  }
+  // nothing allocated, nothing to collect
+  EXPECT_EQ(0, luaDoGcIdle());
+
+  uint32_t memUsed = luaGetMemUsed(lsScripts);
+  luaExecStr("local t = {} for i=1,2000 do t[i] = {i} end");
+  EXPECT_GT(luaGetMemUsed(lsScripts), memUsed);
+  EXPECT_GT(luaDoGcIdle(), 0);
+  for (int i=0; i<1000 && luaDoGcIdle(); i++) {
+  }
+  EXPECT_LT(luaGetMemUsed(lsScripts), memUsed + 1024);
+  EXPECT_EQ(0, luaDoGcIdle());
+}
+
+#if defined(LUA_PROFILER)
+static int reportLines;
+static void countReportLines(const char * line)
+{
+  reportLines++;
+}
+
+TEST(Lua, profiler)
+{
+  const char script[] =
+    "local function square(x) return x*x end\n"
+    "local function countdown(n) if n == 0 then return 0 end return countdown(n-1) end\n"
+    "local t = {}\n"
+    "for i=1,1000 do t[i] = square(i) end\n"
+    "countdown(20)\n"
+    "return #t\n";
+
+  luaInit();
+  luaProfilerReset();
+  luaProfileFunctions = true;
+
+  ASSERT_EQ(0, luaL_loadbuffer(lsScripts, script, sizeof(script)-1, "=profiled"));
+  luaSetInstructionsLimit(lsScripts, 100);
+  luaProfilerStart(LUA_PROFILE_STANDALONE, "/SCRIPTS/TOOLS/profiled.lua");
+  EXPECT_EQ(0, lua_pcall(lsScripts, 0, 1, 0));
+  luaProfilerStop();
+  EXPECT_EQ(1000, lua_tointeger(lsScripts, -1));
+  lua_pop(lsScripts, 1);
+  luaProfileFunctions = false;
+
+  ASSERT_EQ(1, luaScriptProfilesCount);
+  const LuaScriptProfile & profile = luaScriptProfiles[0];
+  EXPECT_EQ(LUA_PROFILE_STANDALONE, profile.kind);
+  EXPECT_STREQ("profiled.", profile.name);
+  EXPECT_EQ(1u, profile.runs);
+  EXPECT_GT(profile.instructions, 5000u);
+  EXPECT_GT(profile.allocated, 1000*sizeof(lua_Number));
+
+  // main chunk, square() and countdown(), tail calls are counted as calls
+  ASSERT_EQ(3, luaFunctionProfilesCount);
+  uint32_t instructions = 0;
+  for (int i=0; i<luaFunctionProfilesCount; i++) {
+    const LuaFunctionProfile & function = luaFunctionProfiles[i];
+    EXPECT_EQ(0, function.script);
+    EXPECT_STREQ("profiled", function.source);
+    if (function.line == 0)
+      EXPECT_EQ(1u, function.calls);
+    else if (function.line == 1)
+      EXPECT_EQ(1000u, function.calls);
+    else if (function.line == 2)
+      EXPECT_EQ(21u, function.calls);
+    else
+      ADD_FAILURE() << "unexpected function at line " << function.line;
+    instructions += function.instructions;
+  }
+  EXPECT_EQ(profile.instructions, instructions);
+
+  reportLines = 0;
+  luaProfilerReport(countReportLines);
+  EXPECT_EQ(2 + 1 + 3, reportLines);
+}
+#endif
+
+#if defined(LUA_COMPILER)
+extern std::string simuSdDirectory;
+
+static void writeFile(const char * filename, const char * content, WORD time)
+{
+  FIL file;
+  UINT written;
+  FILINFO fno;
+  ASSERT_EQ(FR_OK, f_open(&file, filename, FA_CREATE_ALWAYS | FA_WRITE));
+  f_write(&file, content, strlen(content), &written);
+  f_close(&file);
+  fno.fdate = (38 << 9) | (1 << 5) | 1;  // 2018/01/01
+  fno.ftime = time;
+  f_utime(filename, &fno);
+}
+
+static int loadAndRun(const char * filename)
+{
+  int result = -1;
+  if (luaLoadScriptFileToState(lsScripts, filename, "bt") == SCRIPT_OK && lua_pcall(lsScripts, 0, 1, 0) == LUA_OK) {
+    result = lua_tointeger(lsScripts, -1);
+  }
+  lua_settop(lsScripts, 0);
+  return result;
+}
+
+TEST(Lua, bytecodeCache)
+{
+  std::string previousSdDirectory = simuSdDirectory;
+  char directory[] = "/tmp/luacacheXXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(directory));
+  simuSdDirectory = directory;
+  f_mkdir(SCRIPTS_PATH);
+  f_mkdir(SCRIPTS_TELEM_PATH);
+  writeFile(SCRIPTS_TELEM_PATH "/one.lua", "return 1", 1);
+  writeFile(SCRIPTS_TELEM_PATH "/two.lua", "return 2", 1);
+
+  luaInit();
+  luaCacheReset();
+  EXPECT_FALSE(luaCacheLoad());
+  EXPECT_EQ(2, luaCacheCompileAll(lsScripts));
+  EXPECT_EQ(0, luaCacheCompileAll(lsScripts));
+  EXPECT_TRUE(isFileAvailable(SCRIPTS_TELEM_PATH "/one.luac"));
+
+  // next boot
+  luaCacheReset();
+  EXPECT_TRUE(luaCacheLoad());
+  FILINFO fno;
+  ASSERT_EQ(FR_OK, f_stat(SCRIPTS_TELEM_PATH "/one.lua", &fno));
+  EXPECT_TRUE(luaCacheCheck(SCRIPTS_TELEM_PATH "/one.lua", &fno, true));
+  EXPECT_EQ(1, loadAndRun(SCRIPTS_TELEM_PATH "/one"));
+
+  // same content with a new timestamp, no compilation needed
+  writeFile(SCRIPTS_TELEM_PATH "/one.lua", "return 1", 2);
+  ASSERT_EQ(FR_OK, f_stat(SCRIPTS_TELEM_PATH "/one.lua", &fno));
+  EXPECT_TRUE(luaCacheCheck(SCRIPTS_TELEM_PATH "/one.lua", &fno, true));
+
+  // same size, another content
+  writeFile(SCRIPTS_TELEM_PATH "/one.lua", "return 3", 1);
+  ASSERT_EQ(FR_OK, f_stat(SCRIPTS_TELEM_PATH "/one.lua", &fno));
+  EXPECT_FALSE(luaCacheCheck(SCRIPTS_TELEM_PATH "/one.lua", &fno, true));
+  EXPECT_EQ(3, loadAndRun(SCRIPTS_TELEM_PATH "/one"));
+  EXPECT_TRUE(luaCacheCheck(SCRIPTS_TELEM_PATH "/one.lua", &fno, true));
+  EXPECT_EQ(3, loadAndRun(SCRIPTS_TELEM_PATH "/one"));
+
+  // compiled again with the debug info
+  EXPECT_FALSE(luaCacheCheck(SCRIPTS_TELEM_PATH "/one.lua", &fno, false));
+  ASSERT_EQ(SCRIPT_OK, luaLoadScriptFileToState(lsScripts, SCRIPTS_TELEM_PATH "/one", "btd"));
+  lua_settop(lsScripts, 0);
+  EXPECT_TRUE(luaCacheCheck(SCRIPTS_TELEM_PATH "/one.lua", &fno, false));
+  EXPECT_FALSE(luaCacheCheck(SCRIPTS_TELEM_PATH "/one.lua", &fno, true));
+  EXPECT_EQ(3, loadAndRun(SCRIPTS_TELEM_PATH "/one"));
+
+  // bytecode deleted behind the cache back
+  f_unlink(SCRIPTS_TELEM_PATH "/two.luac");
+  EXPECT_EQ(2, loadAndRun(SCRIPTS_TELEM_PATH "/two"));
+  EXPECT_TRUE(isFileAvailable(SCRIPTS_TELEM_PATH "/two.luac"));
+
+  // index written by another firmware
+  FIL file;
+  UINT size;
+  uint8_t index[256];
+  ASSERT_EQ(FR_OK, f_open(&file, LUA_CACHE_PATH, FA_OPEN_EXISTING | FA_READ));
+  f_read(&file, index, sizeof(index), &size);
+  f_close(&file);
+  *(uint32_t *)&index[sizeof(uint32_t)] += 1;  // header abi field
+  ASSERT_EQ(FR_OK, f_open(&file, LUA_CACHE_PATH, FA_CREATE_ALWAYS | FA_WRITE));
+  f_write(&file, index, size, &size);
+  f_close(&file);
+  luaCacheReset();
+  EXPECT_FALSE(luaCacheLoad());
+  EXPECT_FALSE(luaCacheCheck(SCRIPTS_TELEM_PATH "/two.lua", &fno, true));
+
+  f_unlink(SCRIPTS_TELEM_PATH "/one.lua");
+  f_unlink(SCRIPTS_TELEM_PATH "/one.luac");
+  f_unlink(SCRIPTS_TELEM_PATH "/two.lua");
+  f_unlink(SCRIPTS_TELEM_PATH "/two.luac");
+  f_unlink(LUA_CACHE_PATH);
+  rmdir((simuSdDirectory + SCRIPTS_TELEM_PATH).c_str());
+  rmdir((simuSdDirectory + SCRIPTS_PATH).c_str());
+  rmdir(directory);
+  simuSdDirectory = previousSdDirectory;
+  luaCacheReset();
+}
+
+TEST(Lua, bytecodeCacheEviction)
+{
+  std::string previousSdDirectory = simuSdDirectory;
+  char directory[] = "/tmp/luacacheXXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(directory));
+  simuSdDirectory = directory;
+  f_mkdir(SCRIPTS_PATH);
+
+  char filename[64];
+  FILINFO fno;
+  luaCacheReset();
+  for (int i=0; i<=LUA_CACHE_MAX_ENTRIES; i++) {
+    sprintf(filename, SCRIPTS_PATH "/s%d.lua", i);
+    writeFile(filename, "return 0", 1);
+    if (i < LUA_CACHE_MAX_ENTRIES) {
+      ASSERT_EQ(FR_OK, f_stat(filename, &fno));
+      luaCacheRecord(filename, &fno, true);
+    }
+  }
+
+  // s0 is used again, s1 becomes the least recently used one
+  ASSERT_EQ(FR_OK, f_stat(SCRIPTS_PATH "/s0.lua", &fno));
+  EXPECT_TRUE(luaCacheCheck(SCRIPTS_PATH "/s0.lua", &fno, true));
+  sprintf(filename, SCRIPTS_PATH "/s%d.lua", LUA_CACHE_MAX_ENTRIES);
+  ASSERT_EQ(FR_OK, f_stat(filename, &fno));
+  luaCacheRecord(filename, &fno, true);
+  EXPECT_TRUE(luaCacheCheck(filename, &fno, true));
+  EXPECT_TRUE(luaCacheCheck(SCRIPTS_PATH "/s0.lua", &fno, true));
+  EXPECT_FALSE(luaCacheCheck(SCRIPTS_PATH "/s1.lua", &fno, true));
+  EXPECT_TRUE(luaCacheCheck(SCRIPTS_PATH "/s2.lua", &fno, true));
+
+  // the order is saved with the index
+  luaCacheReset();
+  EXPECT_TRUE(luaCacheLoad());
+  EXPECT_TRUE(luaCacheCheck(SCRIPTS_PATH "/s0.lua", &fno, true));
+  EXPECT_FALSE(luaCacheCheck(SCRIPTS_PATH "/s1.lua", &fno, true));
+
+  for (int i=0; i<=LUA_CACHE_MAX_ENTRIES; i++) {
+    sprintf(filename, SCRIPTS_PATH "/s%d.lua", i);
+    f_unlink(filename);
+  }
+  f_unlink(LUA_CACHE_PATH);
+  rmdir((simuSdDirectory + SCRIPTS_PATH).c_str());
+  rmdir(directory);
+  simuSdDirectory = previousSdDirectory;
+  luaCacheReset();
+}
+#endif
+
 #endif   // #if defined(LUA)
@@ -19,6 +19,9 @@
  */
 
 #include "gtests.h"
+#if defined(CPUARM)
+#include "mixer_plan.h"
+#endif
 
 class TrimsTest : public OpenTxTest {};
 class MixerTest : public OpenTxTest {};
@@ -967,6 +970,97 @@ TEST(Heli, SimpleTest)
 }
 #endif
 
+#if defined(CPUARM)
+// Fades from FM0 to FM1 and returns the outputs of each mixer run. The model
+// first fades completely from FM1 to FM0, so that the fade weights always
+// start from the same state. With fullEvaluation all the channels are handled
+// as depending on the flight mode, i.e. each fading flight mode is fully
+// evaluated and the results blended, as before the mixer plan.
+static void runFlightModesFade(int16_t outputs[][3], int count, bool fullEvaluation)
+{
+  simuSetSwitch(0, -1);
+  lastFlightMode = 255;
+  evalMixes(1);
+  simuSetSwitch(0, 1);
+  for (int i=0; i<count; i++) {
+    evalMixes(1);
+  }
+  EXPECT_EQ(0, getFlightMode());
+
+  if (fullEvaluation) {
+    mixerPlan.flightModeChannels = (bitfield_channels_t)-1;
+  }
+
+  simuSetSwitch(0, -1);
+  EXPECT_EQ(1, getFlightMode());
+  for (int i=0; i<count; i++) {
+    evalMixes(1);
+    for (int ch=0; ch<3; ch++) {
+      outputs[i][ch] = ex_chans[ch];
+    }
+  }
+}
+
+TEST_F(MixerTest, FlightModesFadeSharedChannel)
+{
+  g_model.flightModeData[1].swtch = TR(SWSRC_THR, SWSRC_SA0);
+  g_model.flightModeData[1].fadeIn = 10;
+  g_model.flightModeData[1].fadeOut = 10;
+  g_model.mixData[0].destCh = 0;
+  g_model.mixData[0].mltpx = MLTPX_ADD;
+  g_model.mixData[0].srcRaw = MIXSRC_MAX;
+  g_model.mixData[0].weight = 50;
+  g_model.mixData[1].destCh = 1;
+  g_model.mixData[1].mltpx = MLTPX_ADD;
+  g_model.mixData[1].srcRaw = MIXSRC_MAX;
+  g_model.mixData[1].weight = 100;
+  g_model.mixData[1].flightModes = 0x2; // disabled in FM1
+  g_model.mixData[2].destCh = 1;
+  g_model.mixData[2].mltpx = MLTPX_ADD;
+  g_model.mixData[2].srcRaw = MIXSRC_MAX;
+  g_model.mixData[2].weight = -100;
+  g_model.mixData[2].flightModes = 0x1FD; // only enabled in FM1
+  g_model.mixData[3].destCh = 2;
+  g_model.mixData[3].mltpx = MLTPX_ADD;
+  g_model.mixData[3].srcRaw = MIXSRC_Ail;
+  g_model.mixData[3].weight = -GV1_LARGE; // GV1
+  g_model.flightModeData[0].gvars[0] = 100;
+  g_model.flightModeData[1].gvars[0] = 30;
+  anaInValues[AIL_STICK] = 700;
+  simuSetSwitch(0, 1);
+  lastFlightMode = 255;
+  evalMixes(1);
+  EXPECT_EQ(0, getFlightMode());
+  EXPECT_EQ(ex_chans[0], 512);
+  EXPECT_EQ(ex_chans[1], 1024);
+
+  const int count = 200;
+  int16_t outputs[count][3];
+  runFlightModesFade(outputs, count, false);
+  int16_t last = 1024;
+  for (int i=0; i<count; i++) {
+    EXPECT_EQ(outputs[i][0], 512);
+    EXPECT_LE(outputs[i][1], last);
+    last = outputs[i][1];
+    if (i == 10) {
+      EXPECT_GT(outputs[i][1], -1024);
+      EXPECT_LT(outputs[i][1], 1024);
+    }
+  }
+  EXPECT_EQ(outputs[count-1][1], -1024);
+
+  // the same outputs as the full evaluation of each flight mode, at each step of the fade
+  int16_t reference[count][3];
+  runFlightModesFade(reference, count, true);
+  for (int i=0; i<count; i++) {
+    for (int ch=0; ch<3; ch++) {
+      EXPECT_EQ(reference[i][ch], outputs[i][ch]) << "step " << i << " channel " << ch;
+    }
+  }
+  EXPECT_NE(reference[0][2], reference[count-1][2]);
+}
+#endif
+
 TEST(Trainer, UnpluggedTest)
 {
   SYSTEM_RESET();
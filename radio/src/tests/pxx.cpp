@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <string>
+#include "gtests.h"
+
+#if defined(PXX) && defined(EXTMODULE_PULSES)
+
+#define PXX_FRAME_LEN                  18   // rx number, 2 flags, 8 channels, ext. flags, crc
+#define PXX_PERIOD                     18000
+
+// the frame as a string of '0' and '1' symbols, the pause is not included
+static std::string getPxxSymbols(uint8_t port)
+{
+  std::string result;
+  const PxxTimerPulsesData & pxx = modulePulsesData[port].pxx;
+  for (const pulse_duration_t * p = pxx.pulses; p < pxx.ptr; p++) {
+    result += (*p == 47 ? '1' : '0');
+  }
+  return result;
+}
+
+static int getPxxDuration(uint8_t port)
+{
+  int result = 0;
+  const PxxTimerPulsesData & pxx = modulePulsesData[port].pxx;
+  for (const pulse_duration_t * p = pxx.pulses; p < pxx.ptr; p++) {
+    result += *p + 1;
+  }
+  return result;
+}
+
+static void setupPxxModel()
+{
+  MODEL_RESET();
+  g_model.header.modelId[EXTERNAL_MODULE] = 3;
+  g_model.moduleData[EXTERNAL_MODULE].type = MODULE_TYPE_XJT;
+  g_model.moduleData[EXTERNAL_MODULE].channelsCount = 0;
+  g_model.moduleData[EXTERNAL_MODULE].failsafeMode = FAILSAFE_NOT_SET;
+  moduleFlag[EXTERNAL_MODULE] = MODULE_NORMAL_MODE;
+  // full scale values are long runs of 1 bits
+  const int16_t outputs[] = { -1024, 1024, 0, 1023, -512, 512, 700, -700 };
+  for (int i=0; i<MAX_OUTPUT_CHANNELS; i++) {
+    channelOutputs[i] = outputs[i % DIM(outputs)];
+  }
+}
+
+TEST(Pxx, stuffingTable)
+{
+  for (int ones=0; ones<5; ones++) {
+    for (int byte=0; byte<256; byte++) {
+      // bit by bit reference
+      std::string expected;
+      int count = ones;
+      for (int bit=7; bit>=0; bit--) {
+        if (byte & (1 << bit)) {
+          expected += '1';
+          if (++count == 5) {
+            count = 0;
+            expected += '0';
+          }
+        }
+        else {
+          expected += '0';
+          count = 0;
+        }
+      }
+
+      std::string result;
+      uint16_t code = pxxStuffingTable[ones][byte >> 4];
+      for (int i=0; i<((code >> 5) & 0x07); i++) {
+        result += (code & (1 << i)) ? '1' : '0';
+      }
+      code = pxxStuffingTable[code >> 8][byte & 0x0F];
+      for (int i=0; i<((code >> 5) & 0x07); i++) {
+        result += (code & (1 << i)) ? '1' : '0';
+      }
+
+      EXPECT_EQ(expected, result) << "byte " << byte << ", ones " << ones;
+      EXPECT_EQ(count, code >> 8) << "byte " << byte << ", ones " << ones;
+    }
+  }
+}
+
+// frames from the bit by bit encoder
+TEST(Pxx, goldenFrame)
+{
+  setupPxxModel();
+  setupPulsesPXX(EXTERNAL_MODULE);
+  EXPECT_EQ("01111110000000110000000000000000000000000000000101110000000000000000010001110000100000000000001001011000000011010011011000011111000000000010100111101001101111110", getPxxSymbols(EXTERNAL_MODULE));
+  EXPECT_EQ(PXX_PERIOD, getPxxDuration(EXTERNAL_MODULE));
+
+  moduleFlag[EXTERNAL_MODULE] = MODULE_BIND;
+  setupPulsesPXX(EXTERNAL_MODULE);
+  EXPECT_EQ("01111110000000110000000100000000000000000000000101110000000000000000010001110000100000000000001001011000000011010011011000011111000000000110110111101101101111110", getPxxSymbols(EXTERNAL_MODULE));
+  EXPECT_EQ(PXX_PERIOD, getPxxDuration(EXTERNAL_MODULE));
+  moduleFlag[EXTERNAL_MODULE] = MODULE_NORMAL_MODE;
+}
+
+TEST(Pxx, frameCrc)
+{
+  setupPxxModel();
+  g_model.moduleData[EXTERNAL_MODULE].channelsCount = 8;
+
+  for (int frame=0; frame<100; frame++) {
+    for (int i=0; i<MAX_OUTPUT_CHANNELS; i++) {
+      channelOutputs[i] = (rand() % 2049) - 1024;
+    }
+    setupPulsesPXX(EXTERNAL_MODULE);
+    EXPECT_EQ(PXX_PERIOD, getPxxDuration(EXTERNAL_MODULE));
+
+    std::string symbols = getPxxSymbols(EXTERNAL_MODULE);
+    ASSERT_EQ("01111110", symbols.substr(0, 8));
+    ASSERT_EQ("01111110", symbols.substr(symbols.size() - 8));
+
+    // remove the stuffed bits
+    uint8_t bytes[PXX_FRAME_LEN];
+    int len = 0, bits = 0, ones = 0;
+    for (unsigned int i=8; i<symbols.size()-8; i++) {
+      if (ones == 5) {
+        ASSERT_EQ('0', symbols[i]);
+        ones = 0;
+        continue;
+      }
+      ones = (symbols[i] == '1' ? ones + 1 : 0);
+      bits = (bits << 1) + (symbols[i] == '1');
+      if (++len % 8 == 0) {
+        ASSERT_LE(len / 8, PXX_FRAME_LEN);
+        bytes[len / 8 - 1] = bits;
+        bits = 0;
+      }
+    }
+    ASSERT_EQ(PXX_FRAME_LEN * 8, len);
+
+    uint16_t crc = 0;
+    for (int i=0; i<PXX_FRAME_LEN-2; i++) {
+      crc = (crc << 8) ^ CRCTable[((crc >> 8) ^ bytes[i]) & 0xFF];
+    }
+    EXPECT_EQ(crc, (bytes[PXX_FRAME_LEN-2] << 8) + bytes[PXX_FRAME_LEN-1]);
+  }
+}
+
+#endif // defined(PXX) && defined(EXTMODULE_PULSES)
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "gtests.h"
+
+#if defined(SBUS)
+
+static void packSbusFrame(uint8_t * frame, const uint16_t * channels, uint8_t flags)
+{
+  memset(frame, 0, SBUS_FRAME_SIZE);
+  frame[0] = 0x0F;
+  for (int i=0; i<16*11; i++) {
+    if (channels[i / 11] & (1 << (i % 11))) {
+      frame[1 + i / 8] |= 1 << (i % 8);
+    }
+  }
+  frame[23] = flags;
+}
+
+TEST(Sbus, unpack)
+{
+  uint8_t frame[SBUS_FRAME_SIZE];
+  uint16_t channels[16];
+  int16_t pulses[MAX_TRAINER_CHANNELS];
+
+  for (int loop=0; loop<100; loop++) {
+    for (int i=0; i<16; i++) {
+      channels[i] = rand() & 0x7FF;
+    }
+    packSbusFrame(frame, channels, 0);
+    ppmInputValidityTimer = 0;
+    processSbusFrame(frame, pulses, SBUS_FRAME_SIZE);
+    EXPECT_EQ(PPM_IN_VALID_TIMEOUT, ppmInputValidityTimer);
+    for (int i=0; i<MAX_TRAINER_CHANNELS; i++) {
+      EXPECT_EQ(((int32_t)channels[i] - 0x3E0) * 5 / 8, pulses[i]) << "channel " << i;
+    }
+  }
+}
+
+TEST(Sbus, invalidFrames)
+{
+  uint8_t frame[SBUS_FRAME_SIZE];
+  uint16_t channels[16];
+  int16_t pulses[MAX_TRAINER_CHANNELS];
+
+  for (int i=0; i<16; i++) {
+    channels[i] = 0x7FF;
+  }
+
+  ppmInputValidityTimer = 0;
+  memset(pulses, 0, sizeof(pulses));
+
+  packSbusFrame(frame, channels, 0);
+  processSbusFrame(frame, pulses, SBUS_FRAME_SIZE - 1);
+  packSbusFrame(frame, channels, 1 << 2); // frame lost
+  processSbusFrame(frame, pulses, SBUS_FRAME_SIZE);
+  packSbusFrame(frame, channels, 1 << 3); // failsafe
+  processSbusFrame(frame, pulses, SBUS_FRAME_SIZE);
+  packSbusFrame(frame, channels, 0);
+  frame[SBUS_FRAME_SIZE-1] = 0x04;
+  processSbusFrame(frame, pulses, SBUS_FRAME_SIZE);
+
+  EXPECT_EQ(0, ppmInputValidityTimer);
+  for (int i=0; i<MAX_TRAINER_CHANNELS; i++) {
+    EXPECT_EQ(0, pulses[i]);
+  }
+}
+
+#endif // defined(SBUS)
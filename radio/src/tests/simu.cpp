@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "gtests.h"
+
+#if defined(CPUARM)
+struct VirtualTimeWakeup {
+  uint32_t time;
+  int task;
+};
+
+// the tasks run one at a time, no need to lock
+static std::vector<VirtualTimeWakeup> virtualTimeWakeups;
+
+static void virtualTimeTask(void * pdata)
+{
+  int period = (intptr_t)pdata;
+  while (1) {
+    CoTickDelay(period);
+    if (!main_thread_running)
+      break;
+    virtualTimeWakeups.push_back({ (uint32_t)CoGetOSTime(), period });
+  }
+}
+
+TEST(Simu, VirtualTime)
+{
+  virtualTimeWakeups.clear();
+  simuSetVirtualTime(true);
+  main_thread_running = 1;
+
+  uint32_t start = CoGetOSTime();
+  OS_TID fast = CoCreateTask(virtualTimeTask, (void *)5, MIXER_TASK_PRIO, NULL, 0);
+  OS_TID slow = CoCreateTask(virtualTimeTask, (void *)25, MENUS_TASK_PRIO, NULL, 0);
+
+  uint64_t before = simuTimerMicros();
+  simuAdvanceTime(100 * 1000);
+  EXPECT_EQ(before + 100 * 1000, simuTimerMicros());
+  simuAdvanceTime(60 * 1000 * 1000 - 100 * 1000);
+  EXPECT_EQ(before + 60 * 1000 * 1000, simuTimerMicros());
+
+  main_thread_running = 0;
+  simuSetVirtualTime(false);
+  pthread_join(fast, NULL);
+  pthread_join(slow, NULL);
+
+  // the tasks wake up in time order, then in priority order
+  std::vector<VirtualTimeWakeup> expected;
+  for (uint32_t tick=5; tick<=50; tick+=5) {
+    expected.push_back({ start + tick, 5 });
+    if (tick % 25 == 0) {
+      expected.push_back({ start + tick, 25 });
+    }
+  }
+  ASSERT_LE(expected.size(), virtualTimeWakeups.size());
+  for (unsigned i=0; i<expected.size(); i++) {
+    EXPECT_EQ(expected[i].time, virtualTimeWakeups[i].time) << "wakeup " << i;
+    EXPECT_EQ(expected[i].task, virtualTimeWakeups[i].task) << "wakeup " << i;
+  }
+  EXPECT_EQ(60 * 1000 / 2 / 5 + 60 * 1000 / 2 / 25, virtualTimeWakeups.size());
+}
+#endif
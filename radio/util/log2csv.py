@@ -0,0 +1,153 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+"""
+    This script converts the binary logs (.otl files, radio/src/logs.h)
+    written by the firmwares built with LOGS_BINARY into the CSV logs
+    written by the other firmwares.
+
+    Usage:
+
+        ./log2csv.py MODEL-2017-10-17.otl [MODEL-2017-10-17.csv]
+"""
+
+from __future__ import print_function
+
+import datetime
+import struct
+import sys
+
+MAGIC = b"OTXL"
+SECTOR_SIZE = 512
+LOG_FLAG_RTC = 0x01
+LOG_RECORD_PADDING = 0xFFFFFFFF
+
+LOG_COLUMN_VALUE = 0
+LOG_COLUMN_GPS = 1
+LOG_COLUMN_DATETIME = 2
+LOG_COLUMN_LOGICAL_SWITCHES = 3
+
+HEADER_FORMAT = "<4sBBBBHHHHI"
+COLUMN_FORMAT = "<BBBBHBB8s4s"
+RECORD_HEADER_FORMAT = "<IHH"
+
+
+def cstring(s):
+    return s.split(b"\0")[0].decode("latin-1")
+
+
+def align(pos, size):
+    return (pos + size - 1) // size * size
+
+
+def columnLabel(column):
+    name = column["name"]
+    if column["unitName"]:
+        name += "(%s)" % column["unitName"]
+    return name
+
+
+def formatValue(column, values):
+    if column["type"] == LOG_COLUMN_GPS:
+        latitude, longitude = values
+        if latitude and longitude:
+            return "%s %s" % (formatDegrees(latitude), formatDegrees(longitude))
+        return ""
+    elif column["type"] == LOG_COLUMN_DATETIME:
+        date, time = values
+        return "%4d-%02d-%02d %02d:%02d:%02d" % (date >> 16, (date >> 8) & 0xFF, date & 0xFF, time >> 16, (time >> 8) & 0xFF, time & 0xFF)
+    elif column["type"] == LOG_COLUMN_LOGICAL_SWITCHES:
+        return "0x%08X%08X" % (values[0] & 0xFFFFFFFF, values[1] & 0xFFFFFFFF)
+    else:
+        value = values[0]
+        prec = column["prec"]
+        if prec == 0:
+            return "%d" % value
+        sign = "-" if value < 0 else ""
+        value = abs(value)
+        return "%s%d.%0*d" % (sign, value // 10 ** prec, prec, value % 10 ** prec)
+
+
+def formatDegrees(value):
+    # same as the firmware div(): the sign is lost between -1 and 0 degree
+    sign = "-" if value <= -1000000 else ""
+    value = abs(value)
+    return "%s%d.%06d" % (sign, value // 1000000, value % 1000000)
+
+
+def formatTime(flags, time, ms):
+    if flags & LOG_FLAG_RTC:
+        t = datetime.datetime(1970, 1, 1) + datetime.timedelta(seconds=time)
+        return "%4d-%02d-%02d,%02d:%02d:%02d.%03d" % (t.year, t.month, t.day, t.hour, t.minute, t.second, ms)
+    return "%d" % time
+
+
+def readSessions(data):
+    pos = 0
+    while pos + struct.calcsize(HEADER_FORMAT) <= len(data) and data[pos:pos+4] == MAGIC:
+        magic, version, flags, columnsCount, spare, headerSize, recordSize, bufferSize, interval, startTime = struct.unpack_from(HEADER_FORMAT, data, pos)
+        if recordSize < struct.calcsize(RECORD_HEADER_FORMAT) or bufferSize < recordSize:
+            break
+        columns = []
+        columnPos = pos + struct.calcsize(HEADER_FORMAT)
+        for i in range(columnsCount):
+            type, source, index, prec, id, instance, unit, name, unitName = struct.unpack_from(COLUMN_FORMAT, data, columnPos)
+            columns.append({"type": type, "prec": prec, "name": cstring(name), "unitName": cstring(unitName)})
+            columnPos += struct.calcsize(COLUMN_FORMAT)
+        valuesCount = sum(1 if column["type"] == LOG_COLUMN_VALUE else 2 for column in columns)
+        valuesFormat = "<%di" % valuesCount
+
+        records = []
+        pos += headerSize
+        while pos < len(data) and data[pos:pos+4] != MAGIC:
+            # a buffer of records, padded with 0xFF
+            bufferEnd = min(pos + bufferSize, len(data))
+            while pos + recordSize <= bufferEnd:
+                time, ms, spare = struct.unpack_from(RECORD_HEADER_FORMAT, data, pos)
+                if time == LOG_RECORD_PADDING:
+                    # end of the session
+                    bufferEnd = align(pos + struct.calcsize(RECORD_HEADER_FORMAT), SECTOR_SIZE)
+                    break
+                values = struct.unpack_from(valuesFormat, data, pos + struct.calcsize(RECORD_HEADER_FORMAT))
+                records.append((time, ms, values))
+                pos += recordSize
+            pos = bufferEnd
+
+        yield flags, columns, records
+
+
+def convert(data, out):
+    headerWritten = False
+    for flags, columns, records in readSessions(data):
+        if not headerWritten:
+            # the CSV files have only one header, the columns of the first session are kept
+            out.write("Date,Time," if flags & LOG_FLAG_RTC else "Time,")
+            out.write(",".join(columnLabel(column) for column in columns) + "\n")
+            headerWritten = True
+        for time, ms, values in records:
+            fields = [formatTime(flags, time, ms)]
+            index = 0
+            for column in columns:
+                count = 1 if column["type"] == LOG_COLUMN_VALUE else 2
+                fields.append(formatValue(column, values[index:index+count]))
+                index += count
+            out.write(",".join(fields) + "\n")
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        sys.exit(1)
+
+    with open(sys.argv[1], "rb") as f:
+        data = f.read()
+
+    if len(sys.argv) > 2:
+        with open(sys.argv[2], "w") as out:
+            convert(data, out)
+    else:
+        convert(data, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()